@@ -0,0 +1,31 @@
+// position ballistic particles from their spawn state (see AnalyticParticleSystem)
+//
+//   gl_Vertex:           spawn position
+//   gl_Normal:           launch velocity
+//   gl_MultiTexCoord0.x: birth time (ms)
+//   gl_MultiTexCoord0.y: lifespan (sec)
+
+uniform float time;
+uniform vec3 gravity;
+uniform float drag;
+uniform float size;
+
+void main() {
+
+	float t = (time - gl_MultiTexCoord0.x) / 1000.0;
+	float s, g;
+	if (drag > 0.000001) {
+		s = (1.0 - exp(-drag * t)) / drag;
+		g = (t - s) / drag;
+	}
+	else {
+		s = t;
+		g = 0.5 * t * t;
+	}
+	vec3 p = gl_Vertex.xyz + s * gl_Normal + g * gravity;
+
+    gl_Position   = gl_ModelViewProjectionMatrix * vec4(p, 1.0);
+    gl_PointSize  = (t <= gl_MultiTexCoord0.y) ? size : 0.0;
+    gl_FrontColor = gl_Color;
+
+}
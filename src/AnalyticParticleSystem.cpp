@@ -0,0 +1,136 @@
+#include "AnalyticParticleSystem.h"
+
+AnalyticParticleSystem::AnalyticParticleSystem() {
+	gravity.set(0, 0, 0);
+	impulse = 0;
+	height = .2;
+	lastDeath = 0;
+	bDirty = false;
+	setDamping(.99);
+}
+
+// convert per step velocity damping at "rate" Hz into continuous drag
+// so trajectories match the stepped Particle::integrate() at that rate
+//
+void AnalyticParticleSystem::setDamping(float d, float rate) {
+	drag = -log(d) * rate;
+}
+
+void AnalyticParticleSystem::add(const ofVec3f &position, const ofVec3f &velocity, float birthtime, float lifespan) {
+	ofVec3f v = velocity;
+	if (impulse > 0) {
+		ofVec3f dir = ofVec3f(ofRandom(-1, 1), ofRandom(-height / 2.0, height / 2.0), ofRandom(-1, 1));
+		v += dir.getNormalized() * impulse;
+	}
+	px.push_back(position.x);
+	py.push_back(position.y);
+	pz.push_back(position.z);
+	vx.push_back(v.x);
+	vy.push_back(v.y);
+	vz.push_back(v.z);
+	birth.push_back(birthtime);
+	life.push_back(lifespan);
+	lastDeath = max(lastDeath, birthtime + lifespan * 1000);
+	bDirty = true;
+}
+
+void AnalyticParticleSystem::clear() {
+	px.clear(); py.clear(); pz.clear();
+	vx.clear(); vy.clear(); vz.clear();
+	birth.clear();
+	life.clear();
+	lastDeath = 0;
+	bDirty = true;
+}
+
+// nothing is simulated; the store is only dropped once every particle
+// in it has expired (expired particles are skipped when evaluated)
+//
+void AnalyticParticleSystem::update(float time) {
+	if (size() > 0 && time > lastDeath) clear();
+}
+
+// evaluate the positions of all live particles at "time" (ms) into points.
+// return the number of live particles.
+//
+//  with drag k:   p(t) = p0 + g/k t + (v0 - g/k) (1 - e^-kt) / k
+//  without drag:  p(t) = p0 + v0 t + 1/2 g t^2
+//
+int AnalyticParticleSystem::evaluate(float time, vector<ofVec3f> &points) const {
+	int n = size();
+	points.resize(n);
+	if (n == 0) return 0;
+
+	const float k = drag;
+	const float gx = gravity.x, gy = gravity.y, gz = gravity.z;
+	const bool bDrag = k > 1e-6;
+	const float invK = bDrag ? 1 / k : 0;
+
+	// straight line arithmetic over the arrays so the compiler can vectorize it
+	//
+	float *out = &points[0].x;
+	int count = 0;
+	for (int i = 0; i < n; i++) {
+		float t = (time - birth[i]) / 1000.0f;
+		float a, b;      // p = p0 + a * v0 + b * g
+		if (bDrag) {
+			a = (1 - expf(-k * t)) * invK;
+			b = (t - a) * invK;
+		}
+		else {
+			a = t;
+			b = .5f * t * t;
+		}
+		float *p = out + 3 * count;
+		p[0] = px[i] + a * vx[i] + b * gx;
+		p[1] = py[i] + a * vy[i] + b * gy;
+		p[2] = pz[i] + a * vz[i] + b * gz;
+		count += (t <= life[i]) ? 1 : 0;
+	}
+	points.resize(count);
+	return count;
+}
+
+// CPU path, for use without the analytic shader
+//
+void AnalyticParticleSystem::draw(float time, float radius) const {
+	vector<ofVec3f> points;
+	evaluate(time, points);
+	for (int i = 0; i < points.size(); i++) {
+		ofDrawSphere(points[i], radius);
+	}
+}
+
+// upload spawn state for the analytic vertex shader.  The buffer only
+// changes when particles are added, so this is free on most frames.
+//
+//   vertex:   spawn position
+//   normal:   launch velocity
+//   texcoord: (birth time in ms, lifespan in sec)
+//
+void AnalyticParticleSystem::loadVbo(ofVbo &vbo) {
+	if (!bDirty) return;
+	bDirty = false;
+
+	int n = size();
+	vbo.clear();
+	if (n == 0) return;
+
+	vector<ofVec3f> positions(n), velocities(n);
+	vector<ofVec2f> times(n);
+	for (int i = 0; i < n; i++) {
+		positions[i].set(px[i], py[i], pz[i]);
+		velocities[i].set(vx[i], vy[i], vz[i]);
+		times[i] = ofVec2f(birth[i], life[i]);
+	}
+	vbo.setVertexData(&positions[0], n, GL_STATIC_DRAW);
+	vbo.setNormalData(&velocities[0], n, GL_STATIC_DRAW);
+	vbo.setTexCoordData(&times[0].x, n, GL_STATIC_DRAW);
+}
+
+void AnalyticParticleSystem::setUniforms(ofShader &shader, float time, float size) const {
+	shader.setUniform1f("time", time);
+	shader.setUniform3f("gravity", gravity.x, gravity.y, gravity.z);
+	shader.setUniform1f("drag", drag);
+	shader.setUniform1f("size", size);
+}
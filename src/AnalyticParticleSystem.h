@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Particles with a closed form trajectory: launch velocity, constant gravity
+//  and linear drag.  Only the spawn state is stored (structure of arrays) and
+//  positions are evaluated from age, so there is no per frame simulation.
+//  Positions can be evaluated on the CPU with evaluate(), or in the vertex
+//  shader (shaders/analytic.vert) from the spawn data uploaded by loadVbo().
+//
+class AnalyticParticleSystem {
+public:
+	AnalyticParticleSystem();
+	void add(const ofVec3f &position, const ofVec3f &velocity, float birthtime, float lifespan);
+	void clear();
+	void update(float time);
+	int evaluate(float time, vector<ofVec3f> &points) const;
+	void draw(float time, float radius) const;
+	void loadVbo(ofVbo &vbo);
+	void setUniforms(ofShader &shader, float time, float size) const;
+	void setGravity(const ofVec3f &g) { gravity = g; }
+	void setDamping(float d, float rate = 60);
+	void setImpulse(float speed, float h = .2) { impulse = speed; height = h; }
+	int size() const { return (int)birth.size(); }
+
+	ofVec3f gravity;
+	float drag;         // 1/sec
+	float impulse;      // radial launch speed added to every particle
+	float height;       // vertical spread of the radial impulse
+
+	// spawn state
+	//
+	vector<float> px, py, pz;
+	vector<float> vx, vy, vz;
+	vector<float> birth;    // ms
+	vector<float> life;     // sec
+	float lastDeath;        // ms, when the longest lived particle expires
+	bool bDirty;            // spawn data changed since the last loadVbo()
+};
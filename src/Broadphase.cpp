@@ -0,0 +1,74 @@
+#include "Broadphase.h"
+#include <algorithm>
+
+using namespace std;
+
+int Broadphase::add(const Box &box, int userData) {
+	int id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = (int)proxies.size();
+		proxies.push_back(Proxy());
+	}
+	proxies[id].box = box;
+	proxies[id].userData = userData;
+	proxies[id].bAlive = true;
+	order.push_back(id);            // sorted into place by the next findPairs()
+	return id;
+}
+
+void Broadphase::remove(int id) {
+	if (id < 0 || id >= proxies.size() || !proxies[id].bAlive) return;
+	proxies[id].bAlive = false;
+	freeIds.push_back(id);
+	for (int i = 0; i < order.size(); i++) {
+		if (order[i] == id) {
+			order.erase(order.begin() + i);
+			break;
+		}
+	}
+}
+
+void Broadphase::clear() {
+	proxies.clear();
+	freeIds.clear();
+	order.clear();
+	pairList.clear();
+}
+
+void Broadphase::findPairs() {
+
+	//insertion sort by min x; nearly sorted from the last tick
+	//
+	for (int i = 1; i < order.size(); i++) {
+		int id = order[i];
+		float x = proxies[id].box.parameters[0].x();
+		int j = i - 1;
+		while (j >= 0 && proxies[order[j]].box.parameters[0].x() > x) {
+			order[j + 1] = order[j];
+			j--;
+		}
+		order[j + 1] = id;
+	}
+
+	//sweep: each box against the following boxes that start before it ends
+	//
+	pairList.clear();
+	for (int i = 0; i < order.size(); i++) {
+		const Box &a = proxies[order[i]].box;
+		float maxX = a.parameters[1].x();
+		for (int j = i + 1; j < order.size(); j++) {
+			const Box &b = proxies[order[j]].box;
+			if (b.parameters[0].x() > maxX) break;
+			if (a.overlap(b)) {
+				BroadphasePair p;
+				p.a = min(order[i], order[j]);
+				p.b = max(order[i], order[j]);
+				pairList.push_back(p);
+			}
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+//  Dynamic broadphase for moving bodies (landers, debris, pickups), beside
+//  the static terrain Octree.  Sweep and prune on x over Box proxies: the
+//  proxies stay sorted by min x between ticks, so after small moves the
+//  insertion sort does little work, and the sweep only tests boxes whose x
+//  intervals overlap.  The pair list is reused, so a tick allocates nothing
+//  once it has grown to its working size.
+//
+#include <vector>
+#include "box.h"
+
+class BroadphasePair {
+public:
+	int a, b;                       // proxy ids, a < b
+};
+
+class Broadphase {
+public:
+	int add(const Box &box, int userData = -1);
+	void remove(int id);
+	void update(int id, const Box &box) { proxies[id].box = box; }
+	void clear();
+
+	// re-sort and collect the overlapping pairs into pairs()
+	//
+	void findPairs();
+	const std::vector<BroadphasePair> &pairs() const { return pairList; }
+
+	const Box &box(int id) const { return proxies[id].box; }
+	int userData(int id) const { return proxies[id].userData; }
+	int size() const { return (int)order.size(); }
+
+private:
+	class Proxy {
+	public:
+		Box box = Box(Vector3(0, 0, 0), Vector3(0, 0, 0));
+		int userData = -1;
+		bool bAlive = false;
+	};
+
+	std::vector<Proxy> proxies;     // by id; removed ids are reused
+	std::vector<int> freeIds;
+	std::vector<int> order;         // live ids sorted by box min x
+	std::vector<BroadphasePair> pairList;
+};
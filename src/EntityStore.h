@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+//  Entities are ids; what an entity is comes from the components it has.
+//  Ids of destroyed entities are reused.
+//
+typedef int Entity;
+const Entity NoEntity = -1;
+
+class ComponentArrayBase {
+public:
+	virtual ~ComponentArrayBase() { }
+	virtual void remove(Entity e) = 0;
+};
+
+//  The components of one type, packed in a dense array (a sparse set):
+//  systems loop over [0, size()) front to back, and get(entity) is an
+//  index lookup.  Removing moves the last component into the hole, so the
+//  order changes and references don't survive an add() or remove().
+//
+template <typename T>
+class ComponentArray : public ComponentArrayBase {
+public:
+	T &add(Entity e, T c = T()) {
+		if (e >= (int)sparse.size()) sparse.resize(e + 1, -1);
+		if (sparse[e] >= 0) {
+			dense[sparse[e]] = std::move(c);
+			return dense[sparse[e]];
+		}
+		sparse[e] = (int)dense.size();
+		dense.push_back(std::move(c));
+		owners.push_back(e);
+		return dense.back();
+	}
+
+	void remove(Entity e) override {
+		if (!has(e)) return;
+		int i = sparse[e], last = (int)dense.size() - 1;
+		if (i != last) {
+			dense[i] = std::move(dense[last]);
+			owners[i] = owners[last];
+			sparse[owners[i]] = i;
+		}
+		dense.pop_back();
+		owners.pop_back();
+		sparse[e] = -1;
+	}
+
+	bool has(Entity e) const { return e >= 0 && e < (int)sparse.size() && sparse[e] >= 0; }
+	T *get(Entity e) { return has(e) ? &dense[sparse[e]] : nullptr; }
+	const T *get(Entity e) const { return has(e) ? &dense[sparse[e]] : nullptr; }
+
+	// dense order
+	//
+	int size() const { return (int)dense.size(); }
+	T &operator[](int i) { return dense[i]; }
+	const T &operator[](int i) const { return dense[i]; }
+	Entity entity(int i) const { return owners[i]; }
+
+private:
+	std::vector<T> dense;
+	std::vector<Entity> owners;     // entity of each dense component
+	std::vector<int> sparse;        // entity -> dense index, -1 if none
+};
+
+//  Hands out entity ids and, on destroy(), removes the entity's components
+//  from every array registered with attach()
+//
+class EntityStore {
+public:
+	Entity create() {
+		Entity e;
+		if (!freeIds.empty()) {
+			e = freeIds.back();
+			freeIds.pop_back();
+		}
+		else {
+			e = (int)live.size();
+			live.push_back(false);
+		}
+		live[e] = true;
+		return e;
+	}
+
+	void destroy(Entity e) {
+		if (!alive(e)) return;
+		for (int i = 0; i < arrays.size(); i++)
+			arrays[i]->remove(e);
+		live[e] = false;
+		freeIds.push_back(e);
+	}
+
+	bool alive(Entity e) const { return e >= 0 && e < (int)live.size() && live[e]; }
+	void attach(ComponentArrayBase *a) { arrays.push_back(a); }
+
+private:
+	std::vector<char> live;
+	std::vector<Entity> freeIds;
+	std::vector<ComponentArrayBase *> arrays;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "box.h"
+
+//  The camera's view volume as six planes, for skipping geometry that is
+//  off screen before it is drawn.  Planes point inward and are in the space
+//  of whatever the matrix maps from (world space for a camera's model view
+//  projection matrix).
+//
+class Frustum {
+public:
+	Frustum() { }
+	Frustum(const glm::mat4 &viewProjection) { set(viewProjection); }
+
+	// planes from the rows of the matrix (Gribb and Hartmann)
+	//
+	void set(const glm::mat4 &m) {
+		glm::mat4 r = glm::transpose(m);
+		planes[0] = r[3] + r[0];    // left
+		planes[1] = r[3] - r[0];    // right
+		planes[2] = r[3] + r[1];    // bottom
+		planes[3] = r[3] - r[1];    // top
+		planes[4] = r[3] + r[2];    // near
+		planes[5] = r[3] - r[2];    // far
+	}
+
+	// false only when the box is entirely behind one of the planes, so a few
+	// boxes near the corners pass without being visible
+	//
+	bool intersects(const Box &box) const {
+		Vector3 lo = box.min(), hi = box.max();
+		for (int i = 0; i < 6; i++) {
+			const glm::vec4 &p = planes[i];
+			float x = p.x > 0 ? hi.x() : lo.x();
+			float y = p.y > 0 ? hi.y() : lo.y();
+			float z = p.z > 0 ? hi.z() : lo.z();
+			if (p.x * x + p.y * y + p.z * z + p.w < 0) return false;
+		}
+		return true;
+	}
+
+	// true when the whole box is inside, so nothing under it needs testing
+	//
+	bool contains(const Box &box) const {
+		Vector3 lo = box.min(), hi = box.max();
+		for (int i = 0; i < 6; i++) {
+			const glm::vec4 &p = planes[i];
+			float x = p.x > 0 ? lo.x() : hi.x();
+			float y = p.y > 0 ? lo.y() : hi.y();
+			float z = p.z > 0 ? lo.z() : hi.z();
+			if (p.x * x + p.y * y + p.z * z + p.w < 0) return false;
+		}
+		return true;
+	}
+
+	glm::vec4 planes[6];
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+//  Integrators for a body whose applied force is constant over a step
+//  (forces are accumulated once per step in this app) plus the damping,
+//  which is given as the per 1/60 sec factor used everywhere (.99 etc).
+//  The higher order schemes treat the damping as linear drag,
+//  a(v) = f - k v with k = -ln(damping) * 60, which is what repeated
+//  multiplication by damping converges to as the step shrinks.
+//
+//  The scheme is chosen at compile time: Simulation integrates with
+//  LanderIntegrator and Particle with ParticleIntegrator.  V is any vector
+//  type with + - * (scalar) and += (Vector3, ofVec3f), or float.
+//
+//  step(x, v, f, damping, dt): advance position x and velocity v by dt under
+//  acceleration f.
+//
+#include <math.h>
+
+inline float dragCoefficient(float damping) {
+	return -log(damping) * 60;
+}
+
+// the original scheme: position from the old velocity, then velocity, then
+// damping.  first order; needs small steps
+//
+class ExplicitEuler {
+public:
+	template <class V>
+	static void step(V &x, V &v, const V &f, float damping, float dt) {
+		x += v * dt;
+		v += f * dt;
+		v *= pow(damping, dt * 60);
+	}
+};
+
+// velocity first, then position from the new velocity.  first order but
+// stable at larger steps; same cost as ExplicitEuler
+//
+class SemiImplicitEuler {
+public:
+	template <class V>
+	static void step(V &x, V &v, const V &f, float damping, float dt) {
+		v += f * dt;
+		v *= pow(damping, dt * 60);
+		x += v * dt;
+	}
+};
+
+// velocity Verlet with a predicted velocity for the drag.  second order;
+// two acceleration evaluations
+//
+class VelocityVerlet {
+public:
+	template <class V>
+	static void step(V &x, V &v, const V &f, float damping, float dt) {
+		float k = dragCoefficient(damping);
+		V a0 = f - v * k;
+		x += v * dt + a0 * (0.5f * dt * dt);
+		V a1 = f - (v + a0 * dt) * k;
+		v += (a0 + a1) * (0.5f * dt);
+	}
+};
+
+// classic fourth order Runge-Kutta on (x, v).  four acceleration evaluations
+//
+class RK4 {
+public:
+	template <class V>
+	static void step(V &x, V &v, const V &f, float damping, float dt) {
+		float k = dragCoefficient(damping);
+		float h = dt * 0.5f;
+		V v1 = v;
+		V a1 = f - v1 * k;
+		V v2 = v + a1 * h;
+		V a2 = f - v2 * k;
+		V v3 = v + a2 * h;
+		V a3 = f - v3 * k;
+		V v4 = v + a3 * dt;
+		V a4 = f - v4 * k;
+		x += (v1 + (v2 + v3) * 2 + v4) * (dt / 6);
+		v += (a1 + (a2 + a3) * 2 + a4) * (dt / 6);
+	}
+};
+
+// entry point for "--bench-integrators": accuracy against cost for each
+// scheme and step size; returns the process exit code
+//
+int runIntegratorBenchMain(int argc, char *argv[]);
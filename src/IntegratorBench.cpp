@@ -0,0 +1,105 @@
+//  --bench-integrators: accuracy against cost of the Integrator.h schemes.
+//
+//  A lander flies a 30 sec program of thrust and lateral moves (forces
+//  piecewise constant over half second windows, as the controls are) with
+//  the game's gravity, forces and damping.  Each scheme runs at several step
+//  sizes; the position error is measured at every window boundary against
+//  the exact solution for constant force plus linear drag.
+//
+#include "Integrator.h"
+#include "Simulation.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <math.h>
+
+using namespace std;
+
+static const float window = 0.5;
+static const int numWindows = 60;
+
+// the control program: force for window w
+//
+static Vector3 programForce(const LanderParams &p, int w) {
+	unsigned int h = (w + 1) * 2654435761u;
+	h ^= h >> 15;
+	Vector3 f = Vector3(0, p.gravity, 0);
+	if (h & 1) f += p.thrustForce;
+	if (h & 2) f += Simulation::header(float(h % 360)) * p.moveForce;
+	return f;
+}
+
+// exact positions at the window boundaries, in double
+//
+static vector<Vector3> exactPath(const LanderParams &p) {
+	double k = -log((double)p.damping) * 60;
+	double x[3] = { 0, 0, 0 }, v[3] = { 0, 0, 0 };
+	vector<Vector3> path;
+	for (int w = 0; w < numWindows; w++) {
+		Vector3 f = programForce(p, w);
+		double e = exp(-k * window);
+		for (int i = 0; i < 3; i++) {
+			double vt = f[i] / k;
+			x[i] += vt * window + (v[i] - vt) * (1 - e) / k;
+			v[i] = vt + (v[i] - vt) * e;
+		}
+		path.push_back(Vector3(x[0], x[1], x[2]));
+	}
+	return path;
+}
+
+// fly the program with integrator I at step dt; return the largest position
+// error at the window boundaries (infinite if it blew up)
+//
+template <class I>
+static float flyProgram(const LanderParams &p, float dt, const vector<Vector3> &exact) {
+	Vector3 x = Vector3(0, 0, 0), v = Vector3(0, 0, 0);
+	int stepsPerWindow = (int)(window / dt + 0.5f);
+	float err = 0;
+	for (int w = 0; w < numWindows; w++) {
+		Vector3 f = programForce(p, w);
+		for (int s = 0; s < stepsPerWindow; s++)
+			I::step(x, v, f, p.damping, dt);
+		float e = (x - exact[w]).length();
+		if (!(e == e) || e > 1e6) return INFINITY;
+		err = max(err, e);
+	}
+	return err;
+}
+
+template <class I>
+static void benchIntegrator(const char *name, const LanderParams &p, const vector<Vector3> &exact) {
+	float rates[] = { 480, 240, 120, 60, 30, 10, 4 };
+	for (int r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+		float dt = 1 / rates[r];
+		float err = flyProgram<I>(p, dt, exact);
+
+		//time it: repeat the whole flight until it has run for a while
+		//
+		int repeats = 0;
+		volatile float sink = 0;
+		auto t0 = chrono::steady_clock::now();
+		double seconds = 0;
+		do {
+			sink = sink + flyProgram<I>(p, dt, exact);
+			repeats++;
+			seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		} while (seconds < 0.05);
+		double steps = (double)repeats * numWindows * (int)(window / dt + 0.5f);
+		double simSeconds = (double)repeats * numWindows * window;
+
+		printf("  %-20s %5.0f Hz   max error %10.6f   %6.2f ns/step   %8.1f ns per simulated sec\n",
+			name, rates[r], err, seconds / steps * 1e9, seconds / simSeconds * 1e9);
+	}
+}
+
+int runIntegratorBenchMain(int argc, char *argv[]) {
+	LanderParams p;
+	vector<Vector3> exact = exactPath(p);
+	printf("%g sec flight, damping %g, position error against the exact path\n", numWindows * window, p.damping);
+	benchIntegrator<ExplicitEuler>("explicit Euler", p, exact);
+	benchIntegrator<SemiImplicitEuler>("semi-implicit Euler", p, exact);
+	benchIntegrator<VelocityVerlet>("velocity Verlet", p, exact);
+	benchIntegrator<RK4>("RK4", p, exact);
+	return 0;
+}
@@ -0,0 +1,283 @@
+#include "JobGraph.h"
+#include "Profiler.h"
+#include <algorithm>
+
+using namespace std;
+
+static thread_local int threadSlot = 0;
+
+JobScheduler::JobScheduler(int numWorkers) : signal(0) {
+	if (numWorkers < 0)
+		numWorkers = max(0, (int)thread::hardware_concurrency() - 1);
+	for (int i = 0; i <= numWorkers; i++)
+		queues.push_back(new Queue());
+	for (int i = 1; i <= numWorkers; i++)
+		workers.emplace_back(&JobScheduler::workerLoop, this, i);
+}
+
+JobScheduler::~JobScheduler() {
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		bStop = true;
+	}
+	wake.notify_all();
+	for (int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	for (int i = 0; i < queues.size(); i++)
+		delete queues[i];
+}
+
+JobScheduler &JobScheduler::shared() {
+	static JobScheduler scheduler;
+	return scheduler;
+}
+
+int JobScheduler::currentThread() {
+	return threadSlot;
+}
+
+// the task goes to the back of this thread's deque
+//
+void JobScheduler::push(Task *task) {
+	Queue *q = queues[min(threadSlot, numThreads() - 1)];
+	lock_guard<mutex> lock(q->mutex);
+	q->tasks.push_back(task);
+}
+
+// newest task of this thread, else the oldest task of the next thread that
+// has one; of owner only, unless owner is nullptr
+//
+Task *JobScheduler::take(const void *owner) {
+	int self = min(threadSlot, numThreads() - 1);
+	for (int i = 0; i < numThreads(); i++) {
+		Queue *q = queues[(self + i) % numThreads()];
+		lock_guard<mutex> lock(q->mutex);
+		deque<Task *> &tasks = q->tasks;
+		if (i == 0) {
+			for (auto it = tasks.rbegin(); it != tasks.rend(); ++it) {
+				if (owner && (*it)->owner != owner) continue;
+				Task *task = *it;
+				tasks.erase(next(it).base());
+				return task;
+			}
+		}
+		else {
+			for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+				if (owner && (*it)->owner != owner) continue;
+				Task *task = *it;
+				tasks.erase(it);
+				return task;
+			}
+		}
+	}
+	return nullptr;
+}
+
+int JobScheduler::retract(const void *owner) {
+	int n = 0;
+	for (Queue *q : queues) {
+		lock_guard<mutex> lock(q->mutex);
+		deque<Task *> &tasks = q->tasks;
+		for (auto it = tasks.begin(); it != tasks.end();) {
+			if ((*it)->owner == owner) {
+				it = tasks.erase(it);
+				n++;
+			}
+			else ++it;
+		}
+	}
+	return n;
+}
+
+// the chunks of a parallelFor, claimed in order by whichever threads run it.
+// the caller pushes one copy per helper thread and runs it too; copies still
+// queued when the chunks are all claimed are retracted
+//
+class ParallelTask : public Task {
+public:
+	void execute() override {
+		run();
+		JobScheduler &s = *scheduler;
+		finished++;         //the caller may return from here on
+		s.notify();
+	}
+	void run() {
+		for (int c = next++; c < numChunks; c = next++)
+			(*fn)(c);
+	}
+
+	const function<void(int)> *fn = nullptr;
+	int numChunks = 0;
+	JobScheduler *scheduler = nullptr;
+	atomic<int> next{0};
+	atomic<int> finished{0};
+};
+
+void JobScheduler::parallelFor(int numChunks, const function<void(int)> &fn) {
+	int helpers = min(numThreads(), numChunks) - 1;
+	if (helpers <= 0) {
+		for (int c = 0; c < numChunks; c++) fn(c);
+		return;
+	}
+
+	ParallelTask task;
+	task.owner = &task;
+	task.fn = &fn;
+	task.numChunks = numChunks;
+	task.scheduler = this;
+	for (int i = 0; i < helpers; i++)
+		push(&task);
+	notify();
+
+	task.run();
+	int retracted = retract(&task);
+	while (true) {
+		unsigned int seen = epoch();
+		if (task.finished + retracted == helpers) break;
+		wait(seen);
+	}
+}
+
+void JobScheduler::notify() {
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		signal++;
+	}
+	wake.notify_all();
+}
+
+// sleep until something was pushed or finished after epoch() returned seen
+//
+void JobScheduler::wait(unsigned int seen) {
+	unique_lock<mutex> lock(sleepMutex);
+	wake.wait(lock, [&] { return bStop || signal.load() != seen; });
+}
+
+void JobScheduler::workerLoop(int slot) {
+	threadSlot = slot;
+	Profiler::shared().setThreadName("worker " + to_string(slot));
+	while (true) {
+		unsigned int seen = epoch();
+		Task *task = take();
+		if (task) {
+			task->execute();
+			continue;
+		}
+		unique_lock<mutex> lock(sleepMutex);
+		wake.wait(lock, [&] { return bStop || signal.load() != seen; });
+		if (bStop) return;
+	}
+}
+
+//--------------------------------------------------------------
+
+int JobGraph::add(const string &name, function<void()> fn, initializer_list<int> deps) {
+	int id = (int)jobs.size();
+	jobs.emplace_back();
+	Job &job = jobs.back();
+	job.name = name;
+	job.profileName = Profiler::shared().intern(name);
+	job.fn = fn;
+	job.graph = this;
+	job.owner = this;
+	for (int d : deps) {
+		if (d < 0 || d >= id) {
+			printf("JobGraph: \"%s\" depends on job %d, which isn't added yet (ignored)\n", name.c_str(), d);
+			continue;
+		}
+		job.deps.push_back(d);
+		jobs[d].dependents.push_back(id);
+	}
+	return id;
+}
+
+int JobGraph::addMainThread(const string &name, function<void()> fn, initializer_list<int> deps) {
+	int id = add(name, fn, deps);
+	jobs[id].bMainThread = true;
+	return id;
+}
+
+void JobGraph::clear() {
+	jobs.clear();
+	mainReady.clear();
+}
+
+// the calling thread works on jobs of this graph too (its own main thread
+// jobs first) until the last one is done
+//
+void JobGraph::run() {
+	if (jobs.empty()) return;
+	startTime = chrono::steady_clock::now();
+	remaining = (int)jobs.size();
+	for (Job &job : jobs) {
+		job.waiting = (int)job.deps.size();
+		job.thread = -1;
+	}
+	for (Job &job : jobs) {
+		if (!job.deps.empty()) continue;
+		if (job.bMainThread) mainReady.push_back(&job);
+		else scheduler.push(&job);
+	}
+	scheduler.notify();
+
+	while (remaining > 0) {
+		unsigned int seen = scheduler.epoch();
+		Job *job = takeMain();
+		if (!job) job = (Job *)scheduler.take(this);
+		if (job) {
+			execute(job);
+			continue;
+		}
+		if (remaining > 0) scheduler.wait(seen);
+	}
+	elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+}
+
+Job *JobGraph::takeMain() {
+	lock_guard<mutex> lock(mainMutex);
+	if (mainReady.empty()) return nullptr;
+	Job *job = mainReady.back();
+	mainReady.pop_back();
+	return job;
+}
+
+void Job::execute() {
+	graph->execute(this);
+}
+
+// run the job, then hand the jobs that were only waiting on it to this
+// thread.  nothing of the graph is touched after remaining drops, since
+// run() may return as soon as it reaches zero
+//
+void JobGraph::execute(Job *job) {
+	job->thread = JobScheduler::currentThread();
+	job->start = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+	{
+		ProfileScope scope(job->profileName);
+		job->fn();
+	}
+	job->end = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+
+	for (int d : job->dependents) {
+		Job &next = jobs[d];
+		if (--next.waiting > 0) continue;
+		if (next.bMainThread) {
+			lock_guard<mutex> lock(mainMutex);
+			mainReady.push_back(&next);
+		}
+		else scheduler.push(&next);
+	}
+	JobScheduler &s = scheduler;
+	remaining--;
+	s.notify();
+}
+
+void JobGraph::dump(FILE *out) const {
+	fprintf(out, "%d jobs, %d threads, %.0f us\n", size(), scheduler.numThreads(), elapsed);
+	for (const Job &job : jobs) {
+		fprintf(out, "  %-12s thread %2d  %8.1f - %8.1f us", job.name.c_str(), job.thread, job.start, job.end);
+		for (int i = 0; i < job.deps.size(); i++)
+			fprintf(out, "%s%s", i == 0 ? "  after " : ", ", jobs[job.deps[i]].name.c_str());
+		fprintf(out, "\n");
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <cstdio>
+
+class JobGraph;
+
+//  What the scheduler's threads run.  owner is what the task belongs to (a
+//  graph, a parallelFor); a thread waiting for its own work only helps
+//  with tasks of the same owner
+//
+class Task {
+public:
+	virtual ~Task() { }
+	virtual void execute() = 0;
+	const void *owner = nullptr;
+};
+
+//  One unit of work in a JobGraph, with the jobs waiting on it and, after
+//  a run, where and when it ran (for JobGraph::dump)
+//
+class Job : public Task {
+public:
+	void execute() override;
+
+	std::string name;
+	const char *profileName = nullptr;  // the name its runs are profiled under (Profiler.h)
+	std::function<void()> fn;
+	std::vector<int> deps;
+	std::vector<int> dependents;
+	bool bMainThread = false;       // only the thread that called run() takes it
+	std::atomic<int> waiting{0};    // deps not finished yet in this run
+	JobGraph *graph = nullptr;
+
+	int thread = -1;                // 0 is the thread that called run()
+	double start = 0, end = 0;      // usec from the start of the run
+};
+
+//  Worker threads that run the jobs of JobGraphs.  Every thread has a deque
+//  of ready jobs (slot 0 is shared by threads outside the pool, which help
+//  while they wait in JobGraph::run, but only with their own graph's jobs:
+//  the main thread and the sim thread never run each other's work).  A
+//  thread takes its newest job first, and when it has none steals the
+//  oldest job of another thread, so chains of dependent jobs tend to stay
+//  on one core.  The deques are locked; jobs here are microseconds or
+//  longer, so the locks are not the bottleneck.  parallelFor() splits a
+//  loop over the same threads.
+//
+class JobScheduler {
+public:
+	JobScheduler(int numWorkers = -1);     // -1: one per hardware thread but one
+	~JobScheduler();
+	static JobScheduler &shared();
+
+	int numThreads() const { return (int)queues.size(); }
+	static int currentThread();
+
+	void push(Task *task);
+	Task *take(const void *owner = nullptr);    // nullptr: any task
+	int retract(const void *owner);             // drop the queued tasks of owner, how many
+	void notify();
+	void wait(unsigned int seen);
+	unsigned int epoch() const { return signal.load(); }
+
+	// fn(chunk) for every chunk in [0, numChunks), on up to numThreads()
+	// threads, the calling thread included; returns when all are done
+	//
+	void parallelFor(int numChunks, const std::function<void(int)> &fn);
+
+private:
+	class Queue {
+	public:
+		std::mutex mutex;
+		std::deque<Task *> tasks;
+	};
+	void workerLoop(int slot);
+
+	std::vector<Queue *> queues;
+	std::vector<std::thread> workers;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<unsigned int> signal;   // bumped on every push and finished job
+	bool bStop = false;
+};
+
+//  Work for one frame (or step) as named jobs and the jobs each depends on.
+//  Declare the jobs with add() (a dependency has to be added before the job
+//  that needs it, so the graph can't have a cycle), then run() executes them
+//  on the scheduler's threads and returns when all are done.  Jobs with no
+//  path between them may run at the same time, so they must not write the
+//  same data.  clear() and add() again for the next frame.  Every job is
+//  timed as a ProfileScope under its name, on the thread it ran on.
+//
+//      graph.clear();
+//      int a = graph.add("altitude", [&] { ... });
+//      int b = graph.add("collide", [&] { ... });
+//      graph.add("integrate", [&] { ... }, { a, b });
+//      graph.run();
+//
+class JobGraph {
+public:
+	JobGraph(JobScheduler &scheduler = JobScheduler::shared()) : scheduler(scheduler) { }
+
+	int add(const std::string &name, std::function<void()> fn, std::initializer_list<int> deps = {});
+	int addMainThread(const std::string &name, std::function<void()> fn, std::initializer_list<int> deps = {});
+	void clear();
+	void run();
+	int size() const { return (int)jobs.size(); }
+
+	// one line per job: the thread it ran on and when, and what it waited for
+	//
+	void dump(FILE *out = stdout) const;
+
+private:
+	friend class JobScheduler;
+	friend class Job;
+	void execute(Job *job);
+	Job *takeMain();
+
+	JobScheduler &scheduler;
+	std::deque<Job> jobs;               // deque: jobs don't move as more are added
+	std::vector<Job *> mainReady;
+	std::mutex mainMutex;
+	std::atomic<int> remaining{0};
+	std::chrono::steady_clock::time_point startTime;
+	double elapsed = 0;                 // usec, of the last run
+};
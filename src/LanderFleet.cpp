@@ -0,0 +1,327 @@
+#include "LanderFleet.h"
+#include "ObjMesh.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <math.h>
+#include <type_traits>
+
+using namespace std;
+
+static_assert(is_same<LanderIntegrator, ExplicitEuler>::value,
+	"LanderFleet::step integrates with explicit Euler; keep it in step with Simulation");
+
+int LanderFleet::add(const Vector3 &start, float rot, unsigned int seed) {
+	px.push_back(start.x()); py.push_back(start.y()); pz.push_back(start.z());
+	vx.push_back(0); vy.push_back(0); vz.push_back(0);
+	rotation.push_back(rot);
+	angularVelocity.push_back(0);
+	fuel.push_back(params.fuel);
+	controls.push_back(0);
+	altitude.push_back(-1);
+	score.push_back(0);
+	landedPad.push_back(-1);
+	steps.push_back(0);
+	thrusting.push_back(0); bAltitude.push_back(0); bCollide.push_back(0); clipped.push_back(0);
+	bCrash.push_back(0); bLanding.push_back(0); bFuelOut.push_back(0); bContact.push_back(0);
+	rng.push_back(mt19937(seed));
+	broadphase.add(bounds(size() - 1), size() - 1);
+	if (padIndex.size() != pads.size())
+		padIndex.build(pads, params.landingAreaRadius);
+	return size() - 1;
+}
+
+void LanderFleet::clear() {
+	px.clear(); py.clear(); pz.clear();
+	vx.clear(); vy.clear(); vz.clear();
+	rotation.clear(); angularVelocity.clear(); fuel.clear(); controls.clear();
+	altitude.clear(); score.clear(); landedPad.clear(); steps.clear();
+	thrusting.clear(); bAltitude.clear(); bCollide.clear(); clipped.clear();
+	bCrash.clear(); bLanding.clear(); bFuelOut.clear(); bContact.clear();
+	rng.clear();
+	broadphase.clear();
+}
+
+SimOutcome LanderFleet::outcome(int i) const {
+	if (bCrash[i]) return SimCrashed;
+	if (bLanding[i]) return SimLanded;
+	if (bCollide[i] && bFuelOut[i]) return SimFuelOut;
+	return SimRunning;
+}
+
+int LanderFleet::numRunning() const {
+	int n = 0;
+	for (int i = 0; i < size(); i++)
+		if (!finished(i)) n++;
+	return n;
+}
+
+Box LanderFleet::bounds(int i) const {
+	Vector3 p = Vector3(px[i], py[i], pz[i]);
+	return Box(landerBounds.min() + p, landerBounds.max() + p);
+}
+
+void LanderFleet::getState(int i, LanderState &s) const {
+	s.position = Vector3(px[i], py[i], pz[i]);
+	s.velocity = Vector3(vx[i], vy[i], vz[i]);
+	s.rotation = rotation[i];
+	s.angularVelocity = angularVelocity[i];
+	s.fuel = fuel[i];
+	s.controls = controls[i];
+	s.thrusting = thrusting[i];
+}
+
+// one fixed step for every running lander.  the per lander work (controls,
+// turbulence, contact response) runs over the running list; the terrain
+// queries are batched; the integration is a select-only loop over the arrays.
+// the arithmetic is done in the same order as Simulation::step.
+//
+void LanderFleet::step(float dt) {
+	int n = size();
+	running.clear();
+	live.resize(n);
+	for (int i = 0; i < n; i++) {
+		live[i] = !finished(i);
+		if (live[i]) running.push_back(i);
+	}
+
+	ax.resize(n); ay.resize(n); az.resize(n);
+	tx.resize(n); ty.resize(n); tz.resize(n);
+	aa.resize(n);
+
+	//thrust only while there is fuel left; gravity and turbulence
+	//
+	for (int k = 0; k < running.size(); k++) {
+		int i = running[k];
+		steps[i]++;
+		thrusting[i] = 0;
+		if (controls[i] & ThrustUp) {
+			if (fuel[i] > 0) {
+				thrusting[i] = 1;
+			}
+			else {
+				fuel[i] = 0;
+				bFuelOut[i] = 1;
+			}
+		}
+		ax[i] = 0;
+		ay[i] = params.gravity;
+		az[i] = 0;
+		tx[i] = uniformRandom(rng[i], -0.13, 0.13);
+		ty[i] = uniformRandom(rng[i], -0.01, 0.01);
+		tz[i] = uniformRandom(rng[i], -0.13, 0.13);
+	}
+
+	//altitude rays and collision boxes for the whole fleet, one traversal each
+	//
+	if (terrain) {
+		rays.resize(running.size());
+		boxes.resize(running.size());
+		for (int k = 0; k < running.size(); k++) {
+			int i = running[k];
+			Vector3 p = Vector3(px[i], py[i], pz[i]);
+			rays[k] = Ray(p, Vector3(0, -1, 0));
+			boxes[k] = Box(landerBounds.min() + p, landerBounds.max() + p);
+		}
+		terrain->intersect(rays, altitudeNodes);
+		terrain->intersect(boxes, hits);
+	}
+	for (int k = 0; k < running.size(); k++) {
+		int i = running[k];
+		bAltitude[i] = terrain && altitudeNodes[k];
+		if (bAltitude[i])
+			altitude[i] = py[i] - terrain->vertices[altitudeNodes[k]->points[0]].y();
+		bCollide[i] = terrain && hits[k];
+		applyCollide(i, ax[i], ay[i], az[i]);
+	}
+
+	//total acceleration from the controls.  the headers need trig, so this
+	//pass stays over the running landers
+	//
+	for (int k = 0; k < running.size(); k++) {
+		int i = running[k];
+		int c = controls[i];
+		Vector3 accel = Vector3(ax[i], ay[i], az[i]);
+
+		if (thrusting[i])
+			accel += params.thrustForce;
+		if (c & MoveDown)
+			accel += params.downwardForce;
+
+		if (c & MoveForward)
+			accel += Simulation::header(rotation[i]) * params.moveForce;
+		else if (c & MoveBackward)
+			accel -= Simulation::header(rotation[i]) * params.moveForce;
+		else if (c & MoveLeft)
+			accel += Simulation::leftRightHeader(rotation[i]) * params.moveForce;
+		else if (c & MoveRight)
+			accel -= Simulation::leftRightHeader(rotation[i]) * params.moveForce;
+
+		accel += Vector3(tx[i], ty[i], tz[i]);
+		ax[i] = accel.x();
+		ay[i] = accel.y();
+		az[i] = accel.z();
+
+		float a = 0;
+		if (c & RotateLeft)
+			a += params.angularForces;
+		if (c & RotateRight)
+			a -= params.angularForces;
+		aa[i] = a;
+	}
+
+	//integrate.  finished landers keep their state through the selects, so
+	//the loop has no branches and runs over contiguous arrays
+	//
+	float d = pow(params.damping, dt * 60);
+	for (int i = 0; i < n; i++) {
+		bool m = live[i];
+		px[i] = m ? px[i] + vx[i] * dt : px[i];
+		py[i] = m ? py[i] + vy[i] * dt : py[i];
+		pz[i] = m ? pz[i] + vz[i] * dt : pz[i];
+		vx[i] = m ? (vx[i] + ax[i] * dt) * d : vx[i];
+		vy[i] = m ? (vy[i] + ay[i] * dt) * d : vy[i];
+		vz[i] = m ? (vz[i] + az[i] * dt) * d : vz[i];
+		rotation[i] = m ? rotation[i] + angularVelocity[i] * dt : rotation[i];
+		angularVelocity[i] = m ? (angularVelocity[i] + aa[i] * dt) * d : angularVelocity[i];
+		fuel[i] = m && thrusting[i] ? fuel[i] - dt : fuel[i];
+	}
+
+	//lander vs lander overlaps
+	//
+	for (int k = 0; k < running.size(); k++)
+		broadphase.update(running[k], bounds(running[k]));
+	broadphase.findPairs();
+}
+
+// contact response, as Simulation::applyCollide
+//
+void LanderFleet::applyCollide(int i, float &accelX, float &accelY, float &accelZ) {
+	bContact[i] = 0;
+	if (!bCollide[i]) {
+		clipped[i] = 0;
+		return;
+	}
+
+	if (!clipped[i]) {
+		bContact[i] = 1;
+
+		//check if the velocity during the collision is too large
+		float c = params.crashSpeed;
+		if (fabs(vx[i]) > c || fabs(vy[i]) > c || fabs(vz[i]) > c) {
+			bCrash[i] = 1;
+			score[i] = 0;
+		}
+
+		//reverse velocity (bounce)
+		vx[i] = vx[i] * -0.5f;
+		vy[i] = vy[i] * -0.5f;
+		vz[i] = vz[i] * -0.5f;
+		accelX = accelX * -6.0f;
+		accelY = accelY * -6.0f;
+		accelZ = accelZ * -6.0f;
+
+		//anti clipping
+		if (vx[i] <= 0) {
+			vx[i] = 0.1;
+		}
+
+		checkLanding(i);
+	}
+	clipped[i] = 1;
+}
+
+void LanderFleet::checkLanding(int i) {
+	if (bCrash[i]) return;
+	float distance;
+	int p = padIndex.padAt(px[i], pz[i], &distance);
+	if (p >= 0) {
+		if (distance <= padIndex.radius(p) - params.landerHalfLength)
+			score[i] = pads[p].score;
+		else
+			score[i] = pads[p].score / 2;
+		landedPad[i] = p;
+		bLanding[i] = 1;
+	}
+}
+
+// --fleet <terrain.obj> [landers] [seconds] [rate]
+//
+// steps a fleet under random scripted controls and reports the cost per
+// step; lander 0 is checked against a Simulation given the same inputs.
+//
+int runFleetMain(int argc, char *argv[]) {
+	if (argc < 3) {
+		cout << "usage: " << argv[0] << " --fleet <terrain.obj> [landers] [seconds] [rate]" << endl;
+		return 1;
+	}
+
+	ObjMesh terrainMesh;
+	if (!terrainMesh.load(argv[2])) return 1;
+	Octree octree;
+	octree.create(terrainMesh.vertices, 20);
+
+	int count = argc > 3 ? max(1, atoi(argv[3])) : 1000;
+	float seconds = argc > 4 ? atof(argv[4]) : 60;
+	float rate = argc > 5 ? atof(argv[5]) : 60;
+	float dt = 1 / rate;
+
+	LanderFleet fleet;
+	fleet.setTerrain(&octree);
+	Box tb = octree.root.box;
+	mt19937 layout(1);
+	for (int i = 0; i < count; i++) {
+		Vector3 start = Vector3(uniformRandom(layout, tb.min().x(), tb.max().x()), tb.max().y() + uniformRandom(layout, 5, 30),
+			uniformRandom(layout, tb.min().z(), tb.max().z()));
+		fleet.add(start, uniformRandom(layout, 0, 360), 1000 + i);
+	}
+
+	Simulation check;
+	check.setTerrain(&octree);
+	check.seed(1000);
+	check.reset(Vector3(fleet.px[0], fleet.py[0], fleet.pz[0]), fleet.rotation[0]);
+
+	//controls change every half second or so, from a cheap per lander hash
+	//
+	int numSteps = (int)(seconds * rate);
+	double total = 0, worst = 0, contacts = 0;
+	for (int s = 0; s < numSteps; s++) {
+		for (int i = 0; i < count; i++) {
+			unsigned int h = (unsigned int)((s / 32 + 1) * 2654435761u) ^ (i * 40503u);
+			h ^= h >> 13; h *= 0x5bd1e995; h ^= h >> 15;
+			fleet.controls[i] = h & (MoveForward | MoveLeft | RotateLeft | RotateRight);
+			if ((h >> 8) % 8 == 0) //thrust an eighth of the time, so they sink slowly
+				fleet.controls[i] |= ThrustUp;
+		}
+		check.lander.controls = fleet.controls[0];
+		check.step(dt);
+
+		auto t0 = chrono::steady_clock::now();
+		fleet.step(dt);
+		double t = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		total += t;
+		worst = max(worst, t);
+		contacts += fleet.contacts().size();
+	}
+
+	int outcomes[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < count; i++)
+		outcomes[fleet.outcome(i)]++;
+	double avg = total / max(1, numSteps);
+	printf("%d landers, %d steps at %g Hz: avg %.3f ms, worst %.3f ms per step (budget %.3f ms)\n",
+		count, numSteps, rate, avg * 1000, worst * 1000, dt * 1000);
+	printf("  about %.0f landers fit in real time\n", count * dt / max(avg, 1e-9));
+	printf("  running %d  crashed %d  landed %d  fuel out %d  avg lander contacts %.1f\n",
+		outcomes[SimRunning], outcomes[SimCrashed], outcomes[SimLanded], outcomes[SimFuelOut], contacts / max(1, numSteps));
+
+	LanderState s;
+	fleet.getState(0, s);
+	bool match = memcmp(&s.position, &check.lander.position, sizeof(Vector3)) == 0 &&
+		memcmp(&s.velocity, &check.lander.velocity, sizeof(Vector3)) == 0 &&
+		s.rotation == check.lander.rotation && s.fuel == check.lander.fuel &&
+		fleet.steps[0] == check.steps && fleet.outcome(0) == check.outcome();
+	printf("  lander 0 %s the single lander simulation\n", match ? "matches" : "DIFFERS FROM");
+	return match ? 0 : 2;
+}
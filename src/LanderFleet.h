@@ -0,0 +1,85 @@
+#pragma once
+
+//  Many landers simulated at once (AI traffic, ghost replays, multiplayer).
+//  Same physics and rules as Simulation, but the lander state is stored as
+//  structure of arrays: the integration is one branch-free loop over all
+//  landers, and the altitude rays and collision boxes of the whole fleet go
+//  to the terrain octree as one batched query per step.
+//
+//  Lander vs lander overlaps are found by a sweep and prune Broadphase
+//  refreshed every step (reported only; landers pass through each other).
+//
+//  A lander added with the seed and start of a Simulation, and given the
+//  same controls, follows it bit for bit.
+//
+#include <vector>
+#include <random>
+#include "Simulation.h"
+#include "Broadphase.h"
+
+class LanderFleet {
+public:
+	void setTerrain(const Octree *t) { terrain = t; }
+	int add(const Vector3 &start, float rotation, unsigned int seed);
+	void clear();
+	int size() const { return (int)px.size(); }
+
+	// step every lander that is still running; set controls[i] first
+	//
+	void step(float dt);
+
+	SimOutcome outcome(int i) const;
+	bool finished(int i) const { return outcome(i) != SimRunning; }
+	int numRunning() const;
+	void getState(int i, LanderState &s) const;
+	Box bounds(int i) const;
+
+	// pairs of landers whose bounds overlap after the last step; the ids are
+	// lander indices
+	//
+	const std::vector<BroadphasePair> &contacts() const { return broadphase.pairs(); }
+
+	LanderParams params;
+	std::vector<LandingPad> pads;   // set before adding landers; indexed by add()
+	PadIndex padIndex;
+	Box landerBounds = Box(Vector3(-1, 0, -1), Vector3(1, 2, 1));
+
+	// lander state, one entry per lander
+	//
+	std::vector<float> px, py, pz;
+	std::vector<float> vx, vy, vz;
+	std::vector<float> rotation, angularVelocity;
+	std::vector<float> fuel;
+	std::vector<unsigned char> controls;    // LanderControl bits
+	std::vector<float> altitude;
+	std::vector<float> score;
+	std::vector<int> landedPad;
+	std::vector<int> steps;
+
+	// flags (0 or 1)
+	//
+	std::vector<unsigned char> thrusting, bAltitude, bCollide, clipped, bCrash, bLanding, bFuelOut, bContact;
+
+private:
+	void applyCollide(int i, float &ax, float &ay, float &az);
+	void checkLanding(int i);
+
+	const Octree *terrain = nullptr;
+	std::vector<std::mt19937> rng;
+	Broadphase broadphase;          // proxy id == lander index
+
+	// per step scratch
+	//
+	std::vector<int> running;
+	std::vector<unsigned char> live;        // running at the start of the step
+	std::vector<float> ax, ay, az, tx, ty, tz, aa;
+	std::vector<Ray> rays;
+	std::vector<Box> boxes;
+	std::vector<const TreeNode *> altitudeNodes;
+	std::vector<unsigned char> hits;
+};
+
+// entry point for "--fleet <terrain.obj> [landers] [seconds] [rate]", a
+// benchmark; returns the process exit code
+//
+int runFleetMain(int argc, char *argv[]);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+//  A file mapped read only into memory, so large files can be parsed (or
+//  used in place) without reading them through a stream.  Unmapped when
+//  closed or destroyed.
+//
+class MappedFile {
+public:
+	MappedFile() { }
+	~MappedFile() { close(); }
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool open(const std::string &path);
+	void close();
+
+	const char *data() const { return bytes; }
+	size_t size() const { return length; }
+	bool isOpen() const { return bytes != NULL; }
+
+	// size and modification time of a file, for checking caches against
+	// their source.  false if it doesn't exist
+	//
+	static bool stamp(const std::string &path, long long &size, long long &time);
+
+private:
+	const char *bytes = NULL;
+	size_t length = 0;
+#ifdef _WIN32
+	void *file = NULL;
+	void *mapping = NULL;
+#else
+	int fd = -1;
+#endif
+};
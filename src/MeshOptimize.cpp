@@ -0,0 +1,272 @@
+#include "MeshOptimize.h"
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// drop triangles with a repeated corner, keeping the ranges in step
+//
+static void removeDegenerates(ObjMesh &mesh) {
+	vector<int> &idx = mesh.indices;
+	if (mesh.ranges.empty() && !idx.empty()) {
+		mesh.ranges.push_back(ObjMaterialRange());
+		mesh.ranges.back().numIndices = (int)idx.size();
+	}
+	int out = 0;
+	for (int r = 0; r < mesh.ranges.size(); r++) {
+		ObjMaterialRange &range = mesh.ranges[r];
+		int first = out;
+		for (int i = range.firstIndex; i < range.firstIndex + range.numIndices; i += 3) {
+			int a = idx[i], b = idx[i + 1], c = idx[i + 2];
+			if (a == b || b == c || a == c) continue;
+			idx[out++] = a;
+			idx[out++] = b;
+			idx[out++] = c;
+		}
+		range.firstIndex = first;
+		range.numIndices = out - first;
+	}
+	idx.resize(out);
+	mesh.ranges.erase(remove_if(mesh.ranges.begin(), mesh.ranges.end(),
+		[](const ObjMaterialRange &r) { return r.numIndices == 0; }), mesh.ranges.end());
+}
+
+//--------------------------------------------------------------
+// welding.  vertices go into a hash of cells tolerance wide; a vertex
+// merges into the first earlier one within tolerance in the 27 cells
+// around it, so the result doesn't depend on anything but the mesh
+//
+int weldVertices(ObjMesh &mesh, float tolerance, float normalCos) {
+	int n = (int)mesh.vertices.size();
+	if (n == 0 || tolerance <= 0) return 0;
+	bool bNormals = mesh.normals.size() == n;
+	float t2 = tolerance * tolerance;
+
+	auto cell = [&](float v) { return (long long)floor(v / tolerance); };
+	auto key = [](long long x, long long y, long long z) {
+		return (unsigned long long)x * 73856093ull ^ (unsigned long long)y * 19349663ull ^ (unsigned long long)z * 83492791ull;
+	};
+	unordered_map<unsigned long long, int> head;    // cell key -> last kept vertex in it
+	head.reserve(n);
+	vector<int> next;                               // kept vertex -> previous in the same cell
+	vector<int> remap(n);
+	vector<Vector3> kept, keptNormals;
+	kept.reserve(n);
+
+	for (int i = 0; i < n; i++) {
+		const Vector3 &p = mesh.vertices[i];
+		long long cx = cell(p.x()), cy = cell(p.y()), cz = cell(p.z());
+		int found = -1;
+		for (long long x = cx - 1; x <= cx + 1; x++) {
+			for (long long y = cy - 1; y <= cy + 1; y++) {
+				for (long long z = cz - 1; z <= cz + 1; z++) {
+					auto h = head.find(key(x, y, z));
+					if (h == head.end()) continue;
+					for (int j = h->second; j >= 0; j = next[j]) {
+						Vector3 d = kept[j] - p;
+						if (d * d > t2) continue;
+						if (bNormals && keptNormals[j] * mesh.normals[i] < normalCos) continue;
+						if (found < 0 || j < found) found = j;
+					}
+				}
+			}
+		}
+		if (found >= 0) {
+			remap[i] = found;
+			continue;
+		}
+		int id = (int)kept.size();
+		kept.push_back(p);
+		if (bNormals) keptNormals.push_back(mesh.normals[i]);
+		auto h = head.emplace(key(cx, cy, cz), -1).first;
+		next.push_back(h->second);
+		h->second = id;
+		remap[i] = id;
+	}
+
+	int welded = n - (int)kept.size();
+	if (welded == 0) return 0;
+	mesh.vertices.swap(kept);
+	if (bNormals) mesh.normals.swap(keptNormals);
+	for (int i = 0; i < mesh.indices.size(); i++)
+		mesh.indices[i] = remap[mesh.indices[i]];
+	removeDegenerates(mesh);
+	return welded;
+}
+
+//--------------------------------------------------------------
+// vertex cache order (Forsyth).  a vertex scores higher the more recently
+// it entered the cache and the fewer triangles it has left; triangles are
+// emitted greedily by the sum of their vertices' scores, looking only at
+// the triangles of vertices in the cache
+//
+static const int cacheSize = 32;
+static const int maxValence = 64;
+
+class CacheScores {
+public:
+	CacheScores() {
+		for (int i = 0; i < cacheSize; i++)
+			cache[i] = i < 3 ? 0.75f : powf(1 - (i - 3) / (float)(cacheSize - 3), 1.5f);
+		for (int i = 1; i < maxValence; i++)
+			valence[i] = 2.0f / sqrtf((float)i);
+		valence[0] = 0;
+	}
+	float score(int cachePosition, int remaining) const {
+		if (remaining == 0) return -1;
+		float s = cachePosition >= 0 ? cache[cachePosition] : 0;
+		return s + (remaining < maxValence ? valence[remaining] : 2.0f / sqrtf((float)remaining));
+	}
+	float cache[cacheSize];
+	float valence[maxValence];
+};
+
+static void optimizeRange(int *idx, int numTriangles, int numVertices) {
+	static const CacheScores scores;
+	if (numTriangles == 0) return;
+
+	// triangles of each vertex
+	//
+	vector<int> start(numVertices + 1, 0), remaining(numVertices, 0);
+	for (int i = 0; i < 3 * numTriangles; i++)
+		remaining[idx[i]]++;
+	for (int v = 0; v < numVertices; v++)
+		start[v + 1] = start[v] + remaining[v];
+	vector<int> triangles(3 * numTriangles);
+	vector<int> fill(start.begin(), start.end() - 1);
+	for (int t = 0; t < numTriangles; t++)
+		for (int k = 0; k < 3; k++)
+			triangles[fill[idx[3 * t + k]]++] = t;
+
+	vector<int> position(numVertices, -1);
+	vector<float> vertexScore(numVertices);
+	for (int v = 0; v < numVertices; v++)
+		vertexScore[v] = scores.score(-1, remaining[v]);
+	vector<float> triangleScore(numTriangles);
+	vector<char> emitted(numTriangles, 0);
+	int best = 0;
+	for (int t = 0; t < numTriangles; t++) {
+		triangleScore[t] = vertexScore[idx[3 * t]] + vertexScore[idx[3 * t + 1]] + vertexScore[idx[3 * t + 2]];
+		if (triangleScore[t] > triangleScore[best]) best = t;
+	}
+
+	vector<int> out;
+	out.reserve(3 * numTriangles);
+	int cache[cacheSize + 3], cacheCount = 0;
+	int nextUnemitted = 0;
+	for (int count = 0; count < numTriangles; count++) {
+		if (best < 0) {
+			while (emitted[nextUnemitted]) nextUnemitted++;
+			best = nextUnemitted;
+		}
+		emitted[best] = 1;
+		const int *tri = &idx[3 * best];
+		out.insert(out.end(), tri, tri + 3);
+
+		// the triangle's vertices go to the front of the cache
+		//
+		int newCache[cacheSize + 3], newCount = 0;
+		for (int k = 0; k < 3; k++) {
+			int v = tri[k];
+			int *list = &triangles[start[v]];
+			int n = remaining[v];
+			for (int i = 0; i < n; i++) {
+				if (list[i] == best) {
+					list[i] = list[n - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+			newCache[newCount++] = v;
+		}
+		for (int i = 0; i < cacheCount; i++) {
+			int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+		}
+
+		// rescore the cache (vertices falling out get position -1) and the
+		// triangles it touches, and find the next best among them
+		//
+		best = -1;
+		float bestScore = -1;
+		for (int i = 0; i < newCount; i++) {
+			int v = newCache[i];
+			position[v] = i < cacheSize ? i : -1;
+			vertexScore[v] = scores.score(position[v], remaining[v]);
+		}
+		for (int i = 0; i < newCount; i++) {
+			int v = newCache[i];
+			for (int j = 0; j < remaining[v]; j++) {
+				int t = triangles[start[v] + j];
+				const int *w = &idx[3 * t];
+				triangleScore[t] = vertexScore[w[0]] + vertexScore[w[1]] + vertexScore[w[2]];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+		cacheCount = min(newCount, cacheSize);
+		copy(newCache, newCache + cacheCount, cache);
+	}
+	copy(out.begin(), out.end(), idx);
+}
+
+void optimizeVertexCache(ObjMesh &mesh) {
+	int numVertices = (int)mesh.vertices.size();
+	if (mesh.ranges.empty()) {
+		optimizeRange(mesh.indices.data(), (int)mesh.indices.size() / 3, numVertices);
+		return;
+	}
+	for (int r = 0; r < mesh.ranges.size(); r++)
+		optimizeRange(&mesh.indices[mesh.ranges[r].firstIndex], mesh.ranges[r].numIndices / 3, numVertices);
+}
+
+//--------------------------------------------------------------
+
+void optimizeVertexFetch(ObjMesh &mesh) {
+	int n = (int)mesh.vertices.size();
+	bool bNormals = mesh.normals.size() == n;
+	vector<int> remap(n, -1);
+	vector<Vector3> vertices, normals;
+	vertices.reserve(n);
+	if (bNormals) normals.reserve(n);
+	for (int i = 0; i < mesh.indices.size(); i++) {
+		int &v = mesh.indices[i];
+		if (remap[v] < 0) {
+			remap[v] = (int)vertices.size();
+			vertices.push_back(mesh.vertices[v]);
+			if (bNormals) normals.push_back(mesh.normals[v]);
+		}
+		v = remap[v];
+	}
+	mesh.vertices.swap(vertices);
+	if (bNormals) mesh.normals.swap(normals);
+}
+
+void optimizeMesh(ObjMesh &mesh, float relativeTolerance) {
+	if (mesh.vertices.empty()) return;
+	Vector3 lo = mesh.vertices[0], hi = mesh.vertices[0];
+	for (int i = 1; i < mesh.vertices.size(); i++) {
+		for (int k = 0; k < 3; k++) {
+			lo[k] = min(lo[k], mesh.vertices[i][k]);
+			hi[k] = max(hi[k], mesh.vertices[i][k]);
+		}
+	}
+	weldVertices(mesh, relativeTolerance * (hi - lo).length());
+	optimizeVertexCache(mesh);
+	optimizeVertexFetch(mesh);
+}
+
+float vertexCacheMissRatio(const vector<int> &indices, int size) {
+	if (indices.size() < 3) return 0;
+	int maxIndex = *max_element(indices.begin(), indices.end());
+	vector<int> entered(maxIndex + 1, -size - 1);   // miss count when the vertex entered
+	int misses = 0;
+	for (int i = 0; i < indices.size(); i++) {
+		int v = indices[i];
+		if (misses - entered[v] >= size) entered[v] = misses++;
+	}
+	return misses / (indices.size() / 3.0f);
+}
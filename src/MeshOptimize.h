@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include "ObjMesh.h"
+
+//  Preprocessing for loaded meshes, run by ObjMesh::load (and so stored in
+//  its cache):
+//
+//  weldVertices merges vertices closer than tolerance (and, when the mesh
+//  has normals, whose normals agree), so duplicates at seams don't each get
+//  indexed by the octree and uploaded.  Triangles that collapse are dropped.
+//
+//  optimizeVertexCache reorders the triangles of each material range so
+//  vertices are reused while still in the GPU's post-transform cache (Tom
+//  Forsyth's linear-speed vertex cache optimisation).
+//
+//  optimizeVertexFetch renumbers the vertices in the order the triangles
+//  first use them, so vertex reads walk memory forward.  Unused vertices
+//  are dropped.
+//
+int weldVertices(ObjMesh &mesh, float tolerance, float normalCos = 0.99f);
+void optimizeVertexCache(ObjMesh &mesh);
+void optimizeVertexFetch(ObjMesh &mesh);
+
+// all three, with the weld tolerance relative to the size of the mesh
+//
+void optimizeMesh(ObjMesh &mesh, float relativeTolerance = 1e-6f);
+
+// average vertices transformed per triangle through a FIFO cache of
+// cacheSize entries (0.5 is ideal for a regular grid, 3 the worst)
+//
+float vertexCacheMissRatio(const std::vector<int> &indices, int cacheSize = 16);
@@ -0,0 +1,284 @@
+#include "MonteCarlo.h"
+#include "ObjMesh.h"
+#include "Parallel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+const char *policyName(LanderPolicy p) {
+	switch (p) {
+	case PolicyIdle: return "idle";
+	case PolicyRandom: return "random";
+	case PolicyDescend: return "descend";
+	default: return "?";
+	}
+}
+
+void OutcomeStats::add(const EpisodeResult &r) {
+	episodes++;
+	outcomes[r.outcome]++;
+	totalScore += r.score;
+	totalTime += r.time;
+	totalFuel += r.fuelUsed;
+}
+
+float PadStats::scorePercentile(float p) const {
+	if (scores.empty()) return 0;
+	vector<float> v = scores;
+	int k = min((int)v.size() - 1, (int)(p * v.size()));
+	nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+// controls the scripted pilot holds for the next step.  hold is per episode
+// state for policies that keep an input for several steps.
+//
+int MonteCarlo::policyControls(LanderPolicy p, const MonteCarloConfig &config, Simulation &sim, int &hold) {
+	const LanderState &s = sim.lander;
+
+	if (p == PolicyRandom) {
+		if (--hold > 0) return s.controls;
+		hold = (int)sim.random(10, 240);
+
+		//thrust about half the time, plus at most one move and one rotate key
+		int c = 0;
+		if (sim.random(0, 1) < .5) c |= ThrustUp;
+		int move = (int)sim.random(0, 6);
+		if (move < 4) c |= MoveForward << move;
+		int rot = (int)sim.random(0, 4);
+		if (rot < 2) c |= RotateLeft << rot;
+		return c;
+	}
+
+	if (p == PolicyDescend) {
+
+		//nearest pad on the ground plane
+		//
+		Vector3 target = s.position;
+		float best = -1;
+		thread_local vector<int> nearest;
+		thread_local vector<pair<float, int>> scratch;
+		if (sim.padIndex.nearest(s.position.x(), s.position.z(), 1, nearest, scratch)) {
+			target = sim.pads[nearest[0]].position;
+			Vector3 d = target - s.position;
+			d[1] = 0;
+			best = d.length();
+		}
+
+		//steer horizontally: desired velocity toward the pad, capped so a
+		//touchdown never exceeds the crash speed.  only one move key works
+		//at a time, so correct the larger error component
+		//
+		int c = 0;
+		Vector3 toPad = target - s.position;
+		toPad[1] = 0;
+		Vector3 want = toPad * .5;
+		float speed = want.length();
+		if (speed > 1.5) want = want * (1.5 / speed);
+		Vector3 err = want - s.velocity;
+		err[1] = 0;
+		float f = err * sim.header();
+		float r = err * sim.leftRightHeader();
+		if (fabs(f) > .05 || fabs(r) > .05) {
+			if (fabs(f) >= fabs(r)) c |= f > 0 ? MoveForward : MoveBackward;
+			else c |= r > 0 ? MoveLeft : MoveRight;
+		}
+
+		//sink at descendSpeed over the pad, hover low until over it
+		//
+		float sink = -config.descendSpeed;
+		if (best >= 0 && best > sim.padIndex.radius(nearest[0]) && sim.bAltitude && sim.altitude < 8)
+			sink = 0;
+		if (s.velocity.y() < sink) c |= ThrustUp;
+		return c;
+	}
+
+	return 0;
+}
+
+// run one episode to its end (or maxTime) on the given simulation
+//
+EpisodeResult MonteCarlo::runEpisode(const MonteCarloConfig &config, int episode, Simulation &sim) const {
+
+	//every episode has its own seed, so results don't depend on which
+	//thread ran it or in which order
+	//
+	sim.params = config.params;
+	sim.pads = config.pads;
+	sim.landerBounds = config.landerBounds;
+	sim.setTerrain(terrain);
+	sim.seed(config.seed * 2654435761u + episode * 40503u + 1);
+
+	Vector3 lo = config.startMin, hi = config.startMax;
+	Vector3 start = Vector3(sim.random(lo.x(), hi.x()), sim.random(lo.y(), hi.y()), sim.random(lo.z(), hi.z()));
+	sim.reset(start, sim.random(0, 360));
+
+	EpisodeResult r;
+	r.policy = config.policies[episode % config.policies.size()];
+
+	int hold = 0;
+	int maxSteps = (int)(config.maxTime / config.dt);
+	while (!sim.finished() && sim.steps < maxSteps) {
+		sim.lander.controls = policyControls(r.policy, config, sim, hold);
+		sim.step(config.dt);
+	}
+
+	r.outcome = sim.outcome();
+	r.pad = sim.landedPad;
+	if (r.pad < 0) {
+		thread_local vector<int> nearest;
+		thread_local vector<pair<float, int>> scratch;
+		if (sim.padIndex.nearest(sim.lander.position.x(), sim.lander.position.z(), 1, nearest, scratch))
+			r.pad = nearest[0];
+	}
+	r.score = sim.score;
+	r.time = sim.steps * config.dt;
+	r.fuelUsed = config.params.fuel - sim.lander.fuel;
+	return r;
+}
+
+// run all episodes across the cores and aggregate the results
+//
+MonteCarloReport MonteCarlo::run(const MonteCarloConfig &config) const {
+	auto t0 = chrono::steady_clock::now();
+
+	MonteCarloReport report;
+	report.results.resize(config.episodes);
+	parallelFor(config.episodes, [&](int begin, int end) {
+		Simulation sim;
+		for (int i = begin; i < end; i++)
+			report.results[i] = runEpisode(config, i, sim);
+	}, 16);
+
+	report.byPolicy.resize(NumPolicies);
+	report.byPad.resize(config.pads.size());
+	for (int i = 0; i < report.results.size(); i++) {
+		const EpisodeResult &r = report.results[i];
+		report.all.add(r);
+		report.byPolicy[r.policy].add(r);
+		if (r.pad >= 0) {
+			PadStats &pad = report.byPad[r.pad];
+			pad.outcomes.add(r);
+			pad.scores.push_back(r.score);
+			if (r.outcome == SimLanded && r.score >= config.pads[r.pad].score) pad.fullScore++;
+		}
+	}
+
+	report.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+	return report;
+}
+
+static void printOutcomes(const char *name, const OutcomeStats &s) {
+	if (s.episodes == 0) return;
+	double n = s.episodes;
+	printf("  %-20s %8d  crash %5.1f%%  land %5.1f%%  fuel out %5.1f%%  timeout %5.1f%%  avg score %6.1f  avg time %6.1fs  avg fuel %6.1fs\n",
+		name, s.episodes,
+		100 * s.outcomes[SimCrashed] / n, 100 * s.outcomes[SimLanded] / n,
+		100 * s.outcomes[SimFuelOut] / n, 100 * s.outcomes[SimRunning] / n,
+		s.totalScore / n, s.totalTime / n, s.totalFuel / n);
+}
+
+void MonteCarloReport::print(const MonteCarloConfig &config) const {
+	printf("%d episodes in %.2fs (%.0f episodes/s), seed %u\n",
+		all.episodes, seconds, all.episodes / max(seconds, 1e-9), config.seed);
+	printOutcomes("all", all);
+	for (int p = 0; p < byPolicy.size(); p++)
+		printOutcomes(policyName((LanderPolicy)p), byPolicy[p]);
+
+	//per pad: the outcomes of the episodes that ended there, and their score
+	//distribution (10th, 50th and 90th percentile, max)
+	//
+	for (int i = 0; i < byPad.size(); i++) {
+		const PadStats &pad = byPad[i];
+		if (byPad.size() > 20 && pad.outcomes.outcomes[SimLanded] == 0) continue;  // large maps: only pads that were reached
+		char name[64];
+		snprintf(name, sizeof(name), "pad %d (%.1f, %.1f)", i, config.pads[i].position.x(), config.pads[i].position.z());
+		printOutcomes(name, pad.outcomes);
+		if (pad.outcomes.episodes)
+			printf("  %-20s %8s  full score %6d  score p10 %6.1f  p50 %6.1f  p90 %6.1f  max %6.1f\n", "", "", pad.fullScore,
+				pad.scorePercentile(0.1), pad.scorePercentile(0.5), pad.scorePercentile(0.9), pad.scorePercentile(1));
+	}
+}
+
+// --montecarlo <terrain.obj> [episodes] [seed] [extra pads] [options]
+//
+// options override the game's LanderParams for tuning sweeps:
+//   --gravity <g>  --thrust <up force>  --radius <landing area radius>  --fuel <sec>
+//
+// the lander bounds come from geo/ship3.obj next to the terrain when it is
+// there, unscaled like the ones ofApp gives the Simulation (only the drawn
+// model is scaled, see ObjModel.h); the pads and scores are the game's, plus any
+// number of extra pads of random size and score scattered over the terrain.
+//
+int runMonteCarloMain(int argc, char *argv[]) {
+	MonteCarloConfig config;
+	vector<string> args;
+	bool ok = true;
+	for (int i = 2; i < argc; i++) {
+		string a = argv[i];
+		bool option = a == "--gravity" || a == "--thrust" || a == "--radius" || a == "--fuel";
+		if (!option) {
+			args.push_back(a);
+			continue;
+		}
+		if (i + 1 >= argc) {
+			ok = false;
+			break;
+		}
+		float v = (float)atof(argv[++i]);
+		if (a == "--gravity") config.params.gravity = v;
+		else if (a == "--thrust") config.params.thrustForce = Vector3(0, v, 0);
+		else if (a == "--radius") config.params.landingAreaRadius = v;
+		else config.params.fuel = v;
+	}
+	if (!ok || args.empty()) {
+		cout << "usage: " << argv[0] << " --montecarlo <terrain.obj> [episodes] [seed] [extra pads]"
+			" [--gravity g] [--thrust up] [--radius r] [--fuel sec]" << endl;
+		return 1;
+	}
+
+	ObjMesh terrainMesh;
+	if (!terrainMesh.load(args[0])) return 1;
+	Octree octree;
+	octree.create(terrainMesh.vertices, 20);
+
+	if (args.size() > 1) config.episodes = atoi(args[1].c_str());
+	if (args.size() > 2) config.seed = (unsigned int)strtoul(args[2].c_str(), NULL, 10);
+	config.pads.push_back(LandingPad(Vector3(0.129794, 0, 17.3758), 100));
+	config.pads.push_back(LandingPad(Vector3(2.80003, 0, -76.8603), 200));
+	config.pads.push_back(LandingPad(Vector3(-43.1438, 0, 96.1508), 300));
+
+	int extraPads = args.size() > 3 ? atoi(args[3].c_str()) : 0;
+	mt19937 padRng(config.seed);
+	Box tb = octree.root.box;
+	for (int i = 0; i < extraPads; i++) {
+		Vector3 p = Vector3(uniformRandom(padRng, tb.min().x(), tb.max().x()), 0, uniformRandom(padRng, tb.min().z(), tb.max().z()));
+		config.pads.push_back(LandingPad(p, 50 * (1 + (int)uniformRandom(padRng, 0, 6)), uniformRandom(padRng, 1.5, 4)));
+	}
+
+	string dir = args[0];
+	size_t slash = dir.find_last_of("/\\");
+	dir = slash == string::npos ? "" : dir.substr(0, slash + 1);
+	ObjMesh ship;
+	if (ship.load(dir + "ship3.obj")) {
+		Vector3 lo = ship.vertices[0], hi = ship.vertices[0];
+		for (int i = 1; i < ship.vertices.size(); i++) {
+			for (int k = 0; k < 3; k++) {
+				lo[k] = min(lo[k], ship.vertices[i][k]);
+				hi[k] = max(hi[k], ship.vertices[i][k]);
+			}
+		}
+		config.landerBounds = Box(lo, hi);
+	}
+
+	printf("gravity %g  thrust %g  landing radius %g  fuel %gs\n", config.params.gravity,
+		config.params.thrustForce.y(), config.params.landingAreaRadius, config.params.fuel);
+	MonteCarlo(&octree).run(config).print(config);
+	return 0;
+}
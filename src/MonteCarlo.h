@@ -0,0 +1,99 @@
+#pragma once
+
+//  Batch runner for landing episodes.  Runs many independent headless
+//  Simulations across all cores, each with a randomized start, its own
+//  turbulence seed and a scripted control policy, and aggregates the
+//  outcomes and scores per policy and per landing pad (each episode counts
+//  for the pad it landed on, or else the one nearest where it ended).  Used
+//  to tune difficulty (LanderParams: gravity, thrust, landingAreaRadius,
+//  fuel, which --montecarlo takes as options).
+//
+#include <vector>
+#include <string>
+#include "Simulation.h"
+
+// scripted pilots for the episodes
+//
+enum LanderPolicy {
+	PolicyIdle,                     // no input, free fall
+	PolicyRandom,                   // random keys held for random durations
+	PolicyDescend,                  // steer to the nearest pad and descend at a capped speed
+	NumPolicies
+};
+
+const char *policyName(LanderPolicy p);
+
+class MonteCarloConfig {
+public:
+	int episodes = 10000;
+	unsigned int seed = 1;
+	float dt = 1.0 / 240;
+	float maxTime = 300;            // sec; episodes still running then count as timeouts
+	Vector3 startMin = Vector3(-60, 25, -60);
+	Vector3 startMax = Vector3(60, 40, 60);
+	std::vector<LanderPolicy> policies = { PolicyIdle, PolicyRandom, PolicyDescend };
+	float descendSpeed = 1;         // PolicyDescend target sink rate
+
+	LanderParams params;
+	std::vector<LandingPad> pads;
+	Box landerBounds = Box(Vector3(-1, 0, -1), Vector3(1, 2, 1));
+};
+
+class EpisodeResult {
+public:
+	SimOutcome outcome = SimRunning;
+	LanderPolicy policy = PolicyIdle;
+	int pad = -1;                   // landed on, or else nearest where it ended (-1 without pads)
+	float score = 0;
+	float time = 0;
+	float fuelUsed = 0;
+};
+
+class OutcomeStats {
+public:
+	void add(const EpisodeResult &r);
+
+	int episodes = 0;
+	int outcomes[4] = { 0, 0, 0, 0 };   // by SimOutcome; SimRunning counts timeouts
+	double totalScore = 0;
+	double totalTime = 0;
+	double totalFuel = 0;
+};
+
+// the episodes that ended at a pad (EpisodeResult::pad)
+//
+class PadStats {
+public:
+	OutcomeStats outcomes;
+	int fullScore = 0;              // landed within the pad radius - landerHalfLength
+	std::vector<float> scores;      // one per episode, crashes and misses as 0
+	float scorePercentile(float p) const;
+};
+
+class MonteCarloReport {
+public:
+	void print(const MonteCarloConfig &config) const;
+
+	std::vector<EpisodeResult> results;     // one per episode, in episode order
+	OutcomeStats all;
+	std::vector<OutcomeStats> byPolicy;
+	std::vector<PadStats> byPad;
+	double seconds = 0;
+};
+
+class MonteCarlo {
+public:
+	MonteCarlo(const Octree *t) : terrain(t) { }
+	MonteCarloReport run(const MonteCarloConfig &config) const;
+	EpisodeResult runEpisode(const MonteCarloConfig &config, int episode, Simulation &sim) const;
+
+	static int policyControls(LanderPolicy p, const MonteCarloConfig &config, Simulation &sim, int &hold);
+
+private:
+	const Octree *terrain;
+};
+
+// entry point for "--montecarlo <terrain.obj> [episodes] [seed] [extra pads] [--gravity g]
+// [--thrust up] [--radius r] [--fuel sec]"; returns the process exit code
+//
+int runMonteCarloMain(int argc, char *argv[]);
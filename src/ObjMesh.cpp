@@ -0,0 +1,510 @@
+#include "ObjMesh.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "MeshOptimize.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <thread>
+#include <type_traits>
+
+using namespace std;
+
+void ObjMesh::clear() {
+	vertices.clear();
+	indices.clear();
+	normals.clear();
+	materials.clear();
+	ranges.clear();
+}
+
+void ObjMesh::computeNormals() {
+	normals.assign(vertices.size(), Vector3(0, 0, 0));
+	for (int i = 0; i + 2 < indices.size(); i += 3) {
+		const Vector3 &a = vertices[indices[i]];
+		Vector3 n = (vertices[indices[i + 1]] - a) ^ (vertices[indices[i + 2]] - a);
+		normals[indices[i]] += n;
+		normals[indices[i + 1]] += n;
+		normals[indices[i + 2]] += n;
+	}
+	for (int i = 0; i < normals.size(); i++)
+		normals[i].normalize();
+}
+
+// load the mesh, from the cache when it is up to date.  a parsed mesh is
+// welded and reordered (see MeshOptimize.h) whether or not it is cached,
+// so every tool indexes the same vertices.  return false if it can't be
+// read
+//
+bool ObjMesh::load(const string &path, bool bCache) {
+	clear();
+	if (bCache && loadCache(path)) return true;
+	if (!parse(path)) return false;
+	optimizeMesh(*this);
+	if (bCache && !saveCache(path))
+		cout << "ObjMesh: can't write cache for " << path << endl;
+	return true;
+}
+
+//--------------------------------------------------------------
+// the text parser.  the file is cut into chunks at line breaks and each
+// chunk is parsed on its own; the results are then joined in file order.
+//
+
+static inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static const char *skipSpace(const char *p, const char *end) {
+	while (p < end && isSpace(*p)) p++;
+	return p;
+}
+
+static const char *parseInt(const char *p, const char *end, int &value) {
+	bool bNegative = false;
+	if (p < end && (*p == '-' || *p == '+')) bNegative = *p++ == '-';
+	const char *digits = p;
+	int v = 0;
+	while (p < end && isDigit(*p)) v = v * 10 + (*p++ - '0');
+	value = bNegative ? -v : v;
+	return p == digits ? NULL : p;
+}
+
+// decimal float.  up to 15 significant digits and powers of ten up to 22
+// the result is exact before it is rounded to float (a double holds both
+// exactly); anything longer goes to strtof.  returns NULL if there is no
+// number
+//
+static const char *parseFloat(const char *p, const char *end, float &value) {
+	static const double powers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const char *start = p;
+	bool bNegative = false;
+	if (p < end && (*p == '-' || *p == '+')) bNegative = *p++ == '-';
+
+	unsigned long long mantissa = 0;
+	int significant = 0, exponent = 0;
+	bool bDigits = false;
+	for (; p < end && isDigit(*p); p++) {
+		bDigits = true;
+		if (significant < 19) mantissa = mantissa * 10 + (*p - '0');
+		else exponent++;
+		if (mantissa) significant++;
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && isDigit(*p); p++) {
+			bDigits = true;
+			if (significant < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+			if (mantissa) significant++;
+		}
+	}
+	if (!bDigits) return NULL;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		int e;
+		const char *q = parseInt(p + 1, end, e);
+		if (q) {
+			exponent += e;
+			p = q;
+		}
+	}
+
+	if (significant > 15 || exponent < -22 || exponent > 22) {
+		char text[64];
+		size_t n = min((size_t)(p - start), sizeof(text) - 1);
+		memcpy(text, start, n);
+		text[n] = 0;
+		value = strtof(text, NULL);
+		return p;
+	}
+	double d = (double)mantissa;
+	d = exponent < 0 ? d / powers[-exponent] : d * powers[exponent];
+	value = (float)(bNegative ? -d : d);
+	return p;
+}
+
+static bool startsWith(const char *p, const char *end, const char *word) {
+	size_t n = strlen(word);
+	return (size_t)(end - p) > n && memcmp(p, word, n) == 0 && isSpace(p[n]);
+}
+
+static string restOfLine(const char *p, const char *end) {
+	p = skipSpace(p, end);
+	while (end > p && isSpace(end[-1])) end--;
+	return string(p, end);
+}
+
+// what one chunk of the file holds.  face corners refer to positions and
+// normals by 0 based index; a negative OBJ index counts back from the
+// chunk's own end, so it is stored relative to the chunk's first position
+// (or normal) and listed in relativeV (relativeN) to be fixed up once the
+// chunks before are counted.  n is -1 for a corner without a normal
+//
+class ObjChunk {
+public:
+	vector<Vector3> positions, normals;
+	vector<int> v, n;                           // three corners per triangle
+	vector<int> relativeV, relativeN;           // corners whose index is relative
+	vector<pair<int, string>> useMaterial;      // corner, material name
+	vector<string> materialFiles;
+	int badFaces = 0;
+};
+
+static void parseFace(const char *p, const char *end, ObjChunk &c) {
+	int faceV[64], faceN[64];
+	bool relV[64], relN[64];
+	int count = 0;
+	while (count < 64) {
+		p = skipSpace(p, end);
+		if (p >= end) break;
+		int v, vt, n = 0;
+		const char *q = parseInt(p, end, v);
+		if (!q || v == 0) {
+			c.badFaces++;
+			return;
+		}
+		p = q;
+		if (p < end && *p == '/') {
+			p++;
+			if (p < end && *p != '/') {
+				q = parseInt(p, end, vt);
+				if (q) p = q;
+			}
+			if (p < end && *p == '/') {
+				q = parseInt(p + 1, end, n);
+				p = q ? q : p + 1;
+			}
+		}
+		while (p < end && !isSpace(*p)) p++;
+
+		relV[count] = v < 0;
+		faceV[count] = v < 0 ? (int)c.positions.size() + v : v - 1;
+		relN[count] = n < 0;
+		faceN[count] = n < 0 ? (int)c.normals.size() + n : n - 1;
+		count++;
+	}
+
+	for (int i = 2; i < count; i++) {
+		int corners[3] = { 0, i - 1, i };
+		for (int k = 0; k < 3; k++) {
+			int j = corners[k];
+			if (relV[j]) c.relativeV.push_back((int)c.v.size());
+			if (relN[j]) c.relativeN.push_back((int)c.n.size());
+			c.v.push_back(faceV[j]);
+			c.n.push_back(faceN[j]);
+		}
+	}
+}
+
+static void parseChunk(const char *p, const char *end, ObjChunk &c) {
+	while (p < end) {
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+		if (!eol) eol = end;
+		const char *s = skipSpace(p, eol);
+		if (eol - s > 2) {
+			if (s[0] == 'v' && isSpace(s[1])) {
+				float x = 0, y = 0, z = 0;
+				const char *q = parseFloat(skipSpace(s + 1, eol), eol, x);
+				if (q) q = parseFloat(skipSpace(q, eol), eol, y);
+				if (q) q = parseFloat(skipSpace(q, eol), eol, z);
+				c.positions.push_back(Vector3(x, y, z));
+			}
+			else if (s[0] == 'v' && s[1] == 'n' && isSpace(s[2])) {
+				float x = 0, y = 0, z = 0;
+				const char *q = parseFloat(skipSpace(s + 2, eol), eol, x);
+				if (q) q = parseFloat(skipSpace(q, eol), eol, y);
+				if (q) q = parseFloat(skipSpace(q, eol), eol, z);
+				c.normals.push_back(Vector3(x, y, z));
+			}
+			else if (s[0] == 'f' && isSpace(s[1]))
+				parseFace(s + 1, eol, c);
+			else if (startsWith(s, eol, "usemtl"))
+				c.useMaterial.push_back(make_pair((int)c.v.size(), restOfLine(s + 6, eol)));
+			else if (startsWith(s, eol, "mtllib"))
+				c.materialFiles.push_back(restOfLine(s + 6, eol));
+		}
+		p = eol + 1;
+	}
+}
+
+bool ObjMesh::parse(const string &path) {
+	MappedFile file;
+	if (!file.open(path)) {
+		cout << "ObjMesh: can't open " << path << endl;
+		return false;
+	}
+
+	// chunks of at least 256k, ending after a line break
+	//
+	const char *data = file.data();
+	size_t size = file.size();
+	int numChunks = (int)max((size_t)1, min((size_t)thread::hardware_concurrency() * 2, size / (256 * 1024)));
+	vector<const char *> cuts(numChunks + 1);
+	cuts[0] = data;
+	cuts[numChunks] = data + size;
+	for (int i = 1; i < numChunks; i++) {
+		const char *p = max(cuts[i - 1], data + size * i / numChunks);
+		const char *eol = (const char *)memchr(p, '\n', data + size - p);
+		cuts[i] = eol ? eol + 1 : data + size;
+	}
+	vector<ObjChunk> chunks(numChunks);
+	parallelFor(numChunks, [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+			parseChunk(cuts[i], cuts[i + 1], chunks[i]);
+	}, 1);
+
+	// join: make chunk indices absolute and check them
+	//
+	int numPositions = 0, numNormals = 0, numCorners = 0, badFaces = 0;
+	for (int i = 0; i < numChunks; i++) {
+		ObjChunk &c = chunks[i];
+		for (int k = 0; k < c.relativeV.size(); k++)
+			c.v[c.relativeV[k]] += numPositions;
+		for (int k = 0; k < c.relativeN.size(); k++)
+			c.n[c.relativeN[k]] += numNormals;
+		numPositions += (int)c.positions.size();
+		numNormals += (int)c.normals.size();
+		numCorners += (int)c.v.size();
+		badFaces += c.badFaces;
+	}
+	vector<Vector3> positions, fileNormals;
+	positions.reserve(numPositions);
+	fileNormals.reserve(numNormals);
+	vector<int> cornerV, cornerN;
+	cornerV.reserve(numCorners);
+	cornerN.reserve(numCorners);
+	vector<pair<int, string>> useMaterial;
+	vector<string> materialFiles;
+	for (int i = 0; i < numChunks; i++) {
+		ObjChunk &c = chunks[i];
+		for (int k = 0; k < c.useMaterial.size(); k++)
+			useMaterial.push_back(make_pair((int)cornerV.size() + c.useMaterial[k].first, c.useMaterial[k].second));
+		materialFiles.insert(materialFiles.end(), c.materialFiles.begin(), c.materialFiles.end());
+		positions.insert(positions.end(), c.positions.begin(), c.positions.end());
+		fileNormals.insert(fileNormals.end(), c.normals.begin(), c.normals.end());
+		cornerV.insert(cornerV.end(), c.v.begin(), c.v.end());
+		cornerN.insert(cornerN.end(), c.n.begin(), c.n.end());
+		c = ObjChunk();
+	}
+	bool bNormals = false;
+	for (int k = 0; k < numCorners; k++) {
+		if (cornerV[k] < 0 || cornerV[k] >= numPositions) {
+			cornerV[k] = 0;
+			badFaces++;
+		}
+		if (cornerN[k] < 0 || cornerN[k] >= numNormals) cornerN[k] = -1;
+		if (cornerN[k] >= 0) bNormals = true;
+	}
+	if (badFaces > 0) cout << "ObjMesh: " << badFaces << " bad faces in " << path << endl;
+
+	// without normals the positions are the vertices.  with them, each
+	// distinct position and normal pair is a vertex
+	//
+	if (!bNormals) {
+		vertices.swap(positions);
+		indices.swap(cornerV);
+	}
+	else {
+		unordered_map<long long, int> vertexOf;
+		vertexOf.reserve(numPositions * 2);
+		vertices.reserve(numPositions);
+		normals.reserve(numPositions);
+		indices.resize(numCorners);
+		for (int k = 0; k < numCorners; k++) {
+			long long key = (long long)cornerV[k] << 32 | (unsigned int)cornerN[k];
+			auto found = vertexOf.emplace(key, (int)vertices.size());
+			if (found.second) {
+				vertices.push_back(positions[cornerV[k]]);
+				normals.push_back(cornerN[k] >= 0 ? fileNormals[cornerN[k]] : Vector3(0, 0, 0));
+			}
+			indices[k] = found.first->second;
+		}
+	}
+
+	// materials.  the triangles are sorted by material (keeping file order
+	// within each), so each material is one range
+	//
+	string dir = path.substr(0, path.find_last_of("/\\") + 1);
+	for (int i = 0; i < materialFiles.size(); i++)
+		loadMaterials(dir + materialFiles[i]);
+	if (useMaterial.empty()) {
+		ObjMaterialRange all;
+		all.numIndices = numCorners;
+		if (numCorners > 0) ranges.push_back(all);
+		return !vertices.empty();
+	}
+	int numTriangles = numCorners / 3;
+	vector<int> triangleMaterial(numTriangles, -1);
+	for (int i = 0; i < useMaterial.size(); i++) {
+		int m = -1;
+		for (int k = 0; k < materials.size(); k++)
+			if (materials[k].name == useMaterial[i].second) m = k;
+		int end = i + 1 < useMaterial.size() ? useMaterial[i + 1].first : numCorners;
+		for (int t = useMaterial[i].first / 3; t < end / 3; t++)
+			triangleMaterial[t] = m;
+	}
+	vector<int> fill(materials.size() + 2, 0);      // by material + 1
+	for (int t = 0; t < numTriangles; t++)
+		fill[triangleMaterial[t] + 2]++;
+	for (int m = 1; m < fill.size(); m++)
+		fill[m] += fill[m - 1];
+	for (int m = -1; m < (int)materials.size(); m++) {
+		ObjMaterialRange range;
+		range.material = m;
+		range.firstIndex = 3 * fill[m + 1];
+		range.numIndices = 3 * (fill[m + 2] - fill[m + 1]);
+		if (range.numIndices > 0) ranges.push_back(range);
+	}
+	vector<int> sorted(numCorners);
+	for (int t = 0; t < numTriangles; t++) {
+		int to = fill[triangleMaterial[t] + 1]++;
+		for (int k = 0; k < 3; k++)
+			sorted[3 * to + k] = indices[3 * t + k];
+	}
+	indices.swap(sorted);
+	return !vertices.empty();
+}
+
+// the colors from an MTL file; other statements are ignored
+//
+void ObjMesh::loadMaterials(const string &path) {
+	ifstream file(path);
+	if (!file) {
+		cout << "ObjMesh: can't open " << path << endl;
+		return;
+	}
+	string line, tag;
+	while (getline(file, line)) {
+		istringstream in(line);
+		if (!(in >> tag)) continue;
+		if (tag == "newmtl") {
+			materials.push_back(ObjMaterial());
+			materials.back().name = restOfLine(line.c_str() + line.find("newmtl") + 6, line.c_str() + line.size());
+			continue;
+		}
+		if (materials.empty()) continue;
+		ObjMaterial &m = materials.back();
+		float r, g, b;
+		if (tag == "Kd" && in >> r >> g >> b) m.diffuse = Vector3(r, g, b);
+		else if (tag == "Ka" && in >> r >> g >> b) m.ambient = Vector3(r, g, b);
+		else if (tag == "Ks" && in >> r >> g >> b) m.specular = Vector3(r, g, b);
+		else if (tag == "Ns") in >> m.shininess;
+	}
+}
+
+//--------------------------------------------------------------
+// the binary cache: a header with the OBJ's size and time and the array
+// sizes, then the arrays as they are in memory, then the materials
+//
+
+static const char cacheMagic[4] = { 'O', 'M', 'S', 'H' };
+static const unsigned int cacheVersion = 2;     // 2: optimized meshes
+
+class ObjCacheHeader {
+public:
+	char magic[4];
+	unsigned int version;
+	long long sourceSize, sourceTime;
+	unsigned int numVertices, numNormals, numIndices, numRanges, numMaterials;
+};
+
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 is written as three floats");
+static_assert(is_trivially_copyable<Vector3>::value, "Vector3 arrays are read back with memcpy");
+
+bool ObjMesh::saveCache(const string &path) const {
+	ObjCacheHeader h;
+	memcpy(h.magic, cacheMagic, 4);
+	h.version = cacheVersion;
+	if (!MappedFile::stamp(path, h.sourceSize, h.sourceTime)) return false;
+	h.numVertices = (unsigned int)vertices.size();
+	h.numNormals = (unsigned int)normals.size();
+	h.numIndices = (unsigned int)indices.size();
+	h.numRanges = (unsigned int)ranges.size();
+	h.numMaterials = (unsigned int)materials.size();
+
+	ofstream out(path + ".mesh", ios::binary);
+	if (!out) return false;
+	out.write((const char *)&h, sizeof(h));
+	out.write((const char *)vertices.data(), vertices.size() * sizeof(Vector3));
+	out.write((const char *)normals.data(), normals.size() * sizeof(Vector3));
+	out.write((const char *)indices.data(), indices.size() * sizeof(int));
+	for (int i = 0; i < ranges.size(); i++) {
+		int r[3] = { ranges[i].material, ranges[i].firstIndex, ranges[i].numIndices };
+		out.write((const char *)r, sizeof(r));
+	}
+	for (int i = 0; i < materials.size(); i++) {
+		const ObjMaterial &m = materials[i];
+		unsigned int length = (unsigned int)m.name.size();
+		out.write((const char *)&length, sizeof(length));
+		out.write(m.name.data(), length);
+		out.write((const char *)&m.diffuse, sizeof(Vector3));
+		out.write((const char *)&m.ambient, sizeof(Vector3));
+		out.write((const char *)&m.specular, sizeof(Vector3));
+		out.write((const char *)&m.shininess, sizeof(float));
+	}
+	return (bool)out;
+}
+
+// read the cache of the OBJ at path, if it is there and up to date.  the
+// arrays are copied straight out of the mapped file
+//
+bool ObjMesh::loadCache(const string &path) {
+	long long size, time;
+	if (!MappedFile::stamp(path, size, time)) return false;
+	MappedFile file;
+	if (!file.open(path + ".mesh")) return false;
+
+	const char *p = file.data(), *end = p + file.size();
+	ObjCacheHeader h;
+	if (file.size() < sizeof(h)) return false;
+	memcpy(&h, p, sizeof(h));
+	p += sizeof(h);
+	if (memcmp(h.magic, cacheMagic, 4) != 0 || h.version != cacheVersion) return false;
+	if (h.sourceSize != size || h.sourceTime != time) return false;
+	size_t arrays = ((size_t)h.numVertices + h.numNormals) * sizeof(Vector3) +
+		((size_t)h.numIndices + 3 * (size_t)h.numRanges) * sizeof(int);
+	if ((size_t)(end - p) < arrays) return false;
+
+	clear();
+	vertices.resize(h.numVertices);
+	memcpy(vertices.data(), p, h.numVertices * sizeof(Vector3));
+	p += h.numVertices * sizeof(Vector3);
+	normals.resize(h.numNormals);
+	memcpy(normals.data(), p, h.numNormals * sizeof(Vector3));
+	p += h.numNormals * sizeof(Vector3);
+	indices.resize(h.numIndices);
+	memcpy(indices.data(), p, h.numIndices * sizeof(int));
+	p += h.numIndices * sizeof(int);
+	ranges.resize(h.numRanges);
+	for (int i = 0; i < ranges.size(); i++) {
+		int r[3];
+		memcpy(r, p, sizeof(r));
+		p += sizeof(r);
+		ranges[i].material = r[0];
+		ranges[i].firstIndex = r[1];
+		ranges[i].numIndices = r[2];
+	}
+	materials.resize(h.numMaterials);
+	for (int i = 0; i < materials.size(); i++) {
+		ObjMaterial &m = materials[i];
+		unsigned int length;
+		if ((size_t)(end - p) < sizeof(length)) break;
+		memcpy(&length, p, sizeof(length));
+		p += sizeof(length);
+		if ((size_t)(end - p) < length + 3 * sizeof(Vector3) + sizeof(float)) break;
+		m.name.assign(p, length);
+		p += length;
+		memcpy(&m.diffuse, p, sizeof(Vector3));
+		memcpy(&m.ambient, p + sizeof(Vector3), sizeof(Vector3));
+		memcpy(&m.specular, p + 2 * sizeof(Vector3), sizeof(Vector3));
+		memcpy(&m.shininess, p + 3 * sizeof(Vector3), sizeof(float));
+		p += 3 * sizeof(Vector3) + sizeof(float);
+	}
+	return !vertices.empty();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "vector3.h"
+
+//  Surface colors of an OBJ material (from its MTL file)
+//
+class ObjMaterial {
+public:
+	std::string name;
+	Vector3 diffuse = Vector3(0.8, 0.8, 0.8);
+	Vector3 ambient = Vector3(0.2, 0.2, 0.2);
+	Vector3 specular = Vector3(0, 0, 0);
+	float shininess = 0;
+};
+
+//  A run of triangles drawn with one material (-1 for none)
+//
+class ObjMaterialRange {
+public:
+	int material = -1;
+	int firstIndex = 0;
+	int numIndices = 0;
+};
+
+//  Wavefront OBJ reader for geometry the simulation needs without
+//  openFrameworks or a GL context (terrain collision), and for drawing.
+//  The file is memory mapped and cut into chunks at line breaks that are
+//  parsed on all cores.  Reads positions, normals, faces and materials;
+//  polygons are triangulated as fans.  Where the file gives normals,
+//  corners that share a position but not a normal become separate vertices,
+//  so hard edges stay hard.  Coincident vertices are then welded and the
+//  triangles and vertices put in cache friendly order (MeshOptimize.h).
+//
+//  With bCache, the parsed mesh is saved next to the OBJ as a binary file
+//  (path + ".mesh") and later loads read that instead, as long as the OBJ's
+//  size and modification time haven't changed.
+//
+class ObjMesh {
+public:
+	bool load(const std::string &path, bool bCache = false);
+	bool saveCache(const std::string &path) const;
+	bool loadCache(const std::string &path);
+	void clear();
+	int numFaces() const { return (int)indices.size() / 3; }
+
+	// area weighted vertex normals from the faces, for drawing
+	//
+	void computeNormals();
+
+	std::vector<Vector3> vertices;
+	std::vector<int> indices;       // three per triangle
+	std::vector<Vector3> normals;   // per vertex; empty if the file has none, until computeNormals()
+	std::vector<ObjMaterial> materials;
+	std::vector<ObjMaterialRange> ranges;   // cover all of indices, in order
+
+private:
+	bool parse(const std::string &path);
+	void loadMaterials(const std::string &path);
+};
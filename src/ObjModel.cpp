@@ -0,0 +1,85 @@
+#include "ObjModel.h"
+#include <cfloat>
+
+bool ObjModel::loadModel(const string &path) {
+	ObjMesh mesh;
+	if (!mesh.load(ofToDataPath(path), true)) return false;
+	setMesh(mesh);
+	return true;
+}
+
+void ObjModel::setMesh(const ObjMesh &mesh) {
+	numVertices = (int)mesh.vertices.size();
+	if (numVertices == 0) return;
+
+	sceneMin = glm::vec3(FLT_MAX);
+	sceneMax = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < numVertices; i++) {
+		const Vector3 &v = mesh.vertices[i];
+		sceneMin = glm::min(sceneMin, glm::vec3(v.x(), v.y(), v.z()));
+		sceneMax = glm::max(sceneMax, glm::vec3(v.x(), v.y(), v.z()));
+	}
+	QuantizedMesh compact;
+	compact.build(mesh);
+	if (compact.normals.empty()) {
+		ObjMesh withNormals;
+		withNormals.vertices = mesh.vertices;
+		withNormals.indices = mesh.indices;
+		withNormals.computeNormals();
+		compact.setNormals(withNormals.normals);
+	}
+	vbo.upload(compact);
+
+	// a material per range, with the colors of the MTL (default gray when
+	// the range has none)
+	//
+	ranges = mesh.ranges;
+	materials.assign(ranges.size(), ofMaterial());
+	for (int i = 0; i < ranges.size(); i++) {
+		if (ranges[i].material < 0) continue;
+		const ObjMaterial &m = mesh.materials[ranges[i].material];
+		materials[i].setDiffuseColor(ofFloatColor(m.diffuse.x(), m.diffuse.y(), m.diffuse.z()));
+		materials[i].setAmbientColor(ofFloatColor(m.ambient.x(), m.ambient.y(), m.ambient.z()));
+		materials[i].setSpecularColor(ofFloatColor(m.specular.x(), m.specular.y(), m.specular.z()));
+		materials[i].setShininess(m.shininess);
+	}
+}
+
+void ObjModel::setRotation(int which, float angle, float x, float y, float z) {
+	if (which != 0) return;
+	rotationAngle = angle;
+	rotationAxis = glm::vec3(x, y, z);
+}
+
+glm::mat4 ObjModel::getModelMatrix() const {
+	glm::mat4 m = glm::translate(glm::mat4(1.0), position);
+	m = glm::rotate(m, glm::radians(rotationAngle), rotationAxis);
+	return glm::scale(m, scale);
+}
+
+void ObjModel::drawFaces() {
+	if (!isLoaded()) return;
+	ofPushMatrix();
+	ofMultMatrix(getModelMatrix());
+	vbo.begin();
+	for (int i = 0; i < ranges.size(); i++) {
+		materials[i].begin();
+		vbo.drawElements(ranges[i].numIndices, ranges[i].firstIndex);
+		materials[i].end();
+	}
+	vbo.end();
+	ofPopMatrix();
+}
+
+void ObjModel::drawWireframe() {
+	if (!isLoaded()) return;
+	ofPushMatrix();
+	ofMultMatrix(getModelMatrix());
+	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	vbo.begin();
+	for (int i = 0; i < ranges.size(); i++)
+		vbo.drawElements(ranges[i].numIndices, ranges[i].firstIndex);
+	vbo.end();
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	ofPopMatrix();
+}
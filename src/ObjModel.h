@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ObjMesh.h"
+#include "QuantizedVbo.h"
+
+//  An ObjMesh drawn with its materials: one compact vertex buffer (see
+//  QuantizedVbo), one draw per material range.  Takes the place of
+//  ofxAssimpModelLoader for the ship, with the same calls the app used (a
+//  position, one rotation and a scale; scene bounds are unscaled, as the
+//  addon's are by default).
+//
+class ObjModel {
+public:
+	// parse (or read the cache) then upload: on the GL thread
+	//
+	bool loadModel(const std::string &path);
+
+	// upload a mesh loaded elsewhere (on a loader thread)
+	//
+	void setMesh(const ObjMesh &mesh);
+	bool isLoaded() const { return numVertices > 0; }
+
+	void setPosition(float x, float y, float z) { position = glm::vec3(x, y, z); }
+	glm::vec3 getPosition() const { return position; }
+	void setScale(float x, float y, float z) { scale = glm::vec3(x, y, z); }
+	void setRotation(int which, float angle, float x, float y, float z);
+	float getRotationAngle(int which) const { return which == 0 ? rotationAngle : 0; }
+	glm::mat4 getModelMatrix() const;
+
+	glm::vec3 getSceneMin(bool bScaled = false) const { return bScaled ? sceneMin * scale : sceneMin; }
+	glm::vec3 getSceneMax(bool bScaled = false) const { return bScaled ? sceneMax * scale : sceneMax; }
+
+	void drawFaces();
+	void drawWireframe();
+
+private:
+	QuantizedVbo vbo;
+	int numVertices = 0;
+	std::vector<ObjMaterialRange> ranges;
+	std::vector<ofMaterial> materials;      // by range
+
+	glm::vec3 position = glm::vec3(0, 0, 0);
+	glm::vec3 scale = glm::vec3(1, 1, 1);
+	glm::vec3 rotationAxis = glm::vec3(0, 1, 0);
+	float rotationAngle = 0;                // degrees
+	glm::vec3 sceneMin = glm::vec3(0, 0, 0), sceneMax = glm::vec3(0, 0, 0);
+};
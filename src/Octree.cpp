@@ -12,57 +12,51 @@
 //  Date: Nov 14, 2022
 
 #include "Octree.h"
- 
+#include <iostream>
+#include <deque>
 
+using namespace std;
+ 
 
-//draw a box from a "Box" class  
-//
-void Octree::drawBox(const Box &box) {
-	Vector3 min = box.parameters[0];
-	Vector3 max = box.parameters[1];
-	Vector3 size = max - min;
-	Vector3 center = size / 2 + min;
-	ofVec3f p = ofVec3f(center.x(), center.y(), center.z());
-	float w = size.x();
-	float h = size.y();
-	float d = size.z();
-	ofDrawBox(p, w, h, d);
-}
 
 // return a Mesh Bounding Box for the entire Mesh
 //
-Box Octree::meshBounds(const ofMesh & mesh) {
-	int n = mesh.getNumVertices();
-	ofVec3f v = mesh.getVertex(0);
-	ofVec3f max = v;
-	ofVec3f min = v;
+Box Octree::meshBounds(const VertexView & verts) {
+	int n = verts.size();
+	Vector3 v = verts[0];
+	Vector3 max = v;
+	Vector3 min = v;
 	for (int i = 1; i < n; i++) {
-		ofVec3f v = mesh.getVertex(i);
+		Vector3 v = verts[i];
 
-		if (v.x > max.x) max.x = v.x;
-		else if (v.x < min.x) min.x = v.x;
+		if (v.x() > max.x()) max[0] = v.x();
+		else if (v.x() < min.x()) min[0] = v.x();
 
-		if (v.y > max.y) max.y = v.y;
-		else if (v.y < min.y) min.y = v.y;
+		if (v.y() > max.y()) max[1] = v.y();
+		else if (v.y() < min.y()) min[1] = v.y();
 
-		if (v.z > max.z) max.z = v.z;
-		else if (v.z < min.z) min.z = v.z;
+		if (v.z() > max.z()) max[2] = v.z();
+		else if (v.z() < min.z()) min[2] = v.z();
 	}
 	cout << "vertices: " << n << endl;
 //	cout << "min: " << min << "max: " << max << endl;
-	return Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
+	return Box(min, max);
 }
 
 // getMeshPointsInBox:  return an array of indices to points in mesh that are contained 
 //                      inside the Box.  Return count of points found;
 //
-int Octree::getMeshPointsInBox(const ofMesh & mesh, const vector<int>& points,
+int Octree::getMeshPointsInBox(const VertexView & verts, const vector<int>& points,
 	Box & box, vector<int> & pointsRtn)
 {
+	// the same test as box.inside(), on floats loaded straight from the view
+	//
+	const Vector3 lo = box.min(), hi = box.max();
+	const float x0 = lo.x(), y0 = lo.y(), z0 = lo.z(), x1 = hi.x(), y1 = hi.y(), z1 = hi.z();
 	int count = 0;
 	for (int i = 0; i < points.size(); i++) {
-		ofVec3f v = mesh.getVertex(points[i]);
-		if (box.inside(Vector3(v.x, v.y, v.z))) {
+		const float *p = verts.at(points[i]);
+		if (p[0] >= x0 && p[0] <= x1 && p[1] >= y0 && p[1] <= y1 && p[2] >= z0 && p[2] <= z1) {
 			count++;
 			pointsRtn.push_back(points[i]);
 		}
@@ -72,21 +66,17 @@ int Octree::getMeshPointsInBox(const ofMesh & mesh, const vector<int>& points,
 
 // getMeshFacesInBox:  return an array of indices to Faces in mesh that are contained 
 //                      inside the Box.  Return count of faces found;
+//                      face i is the triangle indices[3i .. 3i+2]
 //
-int Octree::getMeshFacesInBox(const ofMesh & mesh, const vector<int>& faces,
-	Box & box, vector<int> & facesRtn)
+int Octree::getMeshFacesInBox(const VertexView & verts, const vector<int> & indices,
+	const vector<int>& faces, Box & box, vector<int> & facesRtn)
 {
 	int count = 0;
 	for (int i = 0; i < faces.size(); i++) {
-		ofMeshFace face = mesh.getFace(faces[i]);
-		ofVec3f v[3];
-		v[0] = face.getVertex(0);
-		v[1] = face.getVertex(1);
-		v[2] = face.getVertex(2);
 		Vector3 p[3];
-		p[0] = Vector3(v[0].x, v[0].y, v[0].z);
-		p[1] = Vector3(v[1].x, v[1].y, v[1].z);
-		p[2] = Vector3(v[2].x, v[2].y, v[2].z);
+		p[0] = verts[indices[3 * faces[i]]];
+		p[1] = verts[indices[3 * faces[i] + 1]];
+		p[2] = verts[indices[3 * faces[i] + 2]];
 		if (box.inside(p,3)) {
 			count++;
 			facesRtn.push_back(faces[i]);
@@ -127,15 +117,17 @@ void Octree::subDivideBox8(const Box &box, vector<Box> & boxList) {
 	}
 }
 
-void Octree::create(const ofMesh & geo, int numLevels) {
+void Octree::create(const VertexView & verts, int numLevels) {
 	// initialize octree structure
 	//
-	mesh = geo;
+	vertices.encode(verts);
+	hash = vertices.hash();
 	int level = 0;
-	root.box = meshBounds(mesh);
+	root.box = meshBounds(verts);
 	if (!bUseFaces) {
-		for (int i = 0; i < mesh.getNumVertices(); i++) {
-			root.points.push_back(i);
+		root.points.resize(verts.size());
+		for (int i = 0; i < verts.size(); i++) {
+			root.points[i] = i;
 		}
 	}
 	else {
@@ -146,7 +138,7 @@ void Octree::create(const ofMesh & geo, int numLevels) {
 	// recursively buid octree
 	//
 	level++;
-    subdivide(mesh, root, numLevels, level);
+    subdivide(verts, root, numLevels, level);
 }
 
 
@@ -164,7 +156,7 @@ void Octree::create(const ofMesh & geo, int numLevels) {
 //         
 //      
              
-void Octree::subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int level) {
+void Octree::subdivide(const VertexView & verts, TreeNode & node, int numLevels, int level) {
 	if (level >= numLevels) return;
 	// subdvide algorithm implemented here
 	level++;
@@ -173,14 +165,12 @@ void Octree::subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int
 	for (int i = 0; i < bList.size(); i++) {
 		TreeNode child;
 		child.box = bList[i];
-		vector<int> pointRt;
-		int num = getMeshPointsInBox(mesh, node.points, bList[i], pointRt);
-		child.points = pointRt;
+		int num = getMeshPointsInBox(verts, node.points, bList[i], child.points);
 
 		if (num >= 1) {
-			node.children.push_back(child);
+			node.children.push_back(std::move(child));
 			if (num > 1)
-				subdivide(mesh, node.children[node.children.size()-1], numLevels, level);
+				subdivide(verts, node.children[node.children.size()-1], numLevels, level);
 		}
 	}
 }
@@ -188,12 +178,15 @@ void Octree::subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int
 // Implement functions below for Homework project
 //
 
-bool Octree::intersect(const Ray &ray, const TreeNode & node, TreeNode & nodeRtn) {
+// children lie inside their parent's box, so a subtree is skipped when the
+// ray or box misses its root; the result is the same as visiting every node.
+//
+bool Octree::intersect(const Ray &ray, const TreeNode & node, TreeNode & nodeRtn) const {
+	if (!node.box.intersect(ray, 0, 1000000))
+		return false;
 	if (node.points.size() == 1) {
-		if (node.box.intersect(ray, 0, 1000000)) {
-			nodeRtn = node;
-			return true;
-		}
+		nodeRtn = node;
+		return true;
 	}
 	bool intersects = false;
 	for (int i = 0; i < node.children.size(); i++) {
@@ -205,12 +198,12 @@ bool Octree::intersect(const Ray &ray, const TreeNode & node, TreeNode & nodeRtn
 	return intersects;
 }
 
-bool Octree::intersect(const Box &box, TreeNode & node, vector<Box> & boxListRtn) {
+bool Octree::intersect(const Box &box, const TreeNode & node, vector<Box> & boxListRtn) const {
+	if (!node.box.overlap(box))
+		return false;
 	if (node.points.size() == 1) {
-		if (node.box.overlap(box)) {
-			boxListRtn.push_back(node.box);
-			return true;
-		}
+		boxListRtn.push_back(node.box);
+		return true;
 	}
 	bool intersects = false;
 	for (int i = 0; i < node.children.size(); i++) {
@@ -220,22 +213,68 @@ bool Octree::intersect(const Box &box, TreeNode & node, vector<Box> & boxListRtn
 	return intersects;
 }
 
-void Octree::draw(TreeNode & node, int numLevels, int level) {
-	if (level >= numLevels) return;
-	drawBox(node.box);
-	level++;
-	for (int i = 0; i < node.children.size(); i++) {
-		draw(node.children[i], numLevels, level);
-	}
-}
-
-// Optional
+// batched traversal: the queries still open that reach a node are passed
+// down as a list of indices (one scratch list per depth).  children are
+// visited in order and a query is closed by its first hit, so each result
+// is the one the single query version returns.  (a deque, so growing it
+// keeps the parents' lists in place)
 //
-void Octree::drawLeafNodes(TreeNode & node) {
-
+static void intersectRays(const vector<Ray> & rays, const TreeNode & node, const vector<int> & active,
+	vector<const TreeNode *> & nodesRtn, deque<vector<int>> & scratch, int depth)
+{
+	if (scratch.size() <= depth) scratch.resize(depth + 1);
+	vector<int> & hits = scratch[depth];
+	hits.clear();
+	for (int i = 0; i < active.size(); i++) {
+		int q = active[i];
+		if (!nodesRtn[q] && node.box.intersect(rays[q], 0, 1000000))
+			hits.push_back(q);
+	}
+	if (hits.empty()) return;
 
+	if (node.points.size() == 1) {
+		for (int i = 0; i < hits.size(); i++)
+			nodesRtn[hits[i]] = &node;
+		return;
+	}
+	for (int i = 0; i < node.children.size(); i++)
+		intersectRays(rays, node.children[i], scratch[depth], nodesRtn, scratch, depth + 1);
 }
 
+static void intersectBoxes(const vector<Box> & boxes, const TreeNode & node, const vector<int> & active,
+	vector<unsigned char> & hitRtn, deque<vector<int>> & scratch, int depth)
+{
+	if (scratch.size() <= depth) scratch.resize(depth + 1);
+	vector<int> & hits = scratch[depth];
+	hits.clear();
+	for (int i = 0; i < active.size(); i++) {
+		int q = active[i];
+		if (!hitRtn[q] && node.box.overlap(boxes[q]))
+			hits.push_back(q);
+	}
+	if (hits.empty()) return;
 
+	if (node.points.size() == 1) {
+		for (int i = 0; i < hits.size(); i++)
+			hitRtn[hits[i]] = 1;
+		return;
+	}
+	for (int i = 0; i < node.children.size(); i++)
+		intersectBoxes(boxes, node.children[i], scratch[depth], hitRtn, scratch, depth + 1);
+}
 
+void Octree::intersect(const vector<Ray> & rays, vector<const TreeNode *> & nodesRtn) const {
+	nodesRtn.assign(rays.size(), NULL);
+	vector<int> all(rays.size());
+	for (int i = 0; i < all.size(); i++) all[i] = i;
+	deque<vector<int>> scratch;
+	intersectRays(rays, root, all, nodesRtn, scratch, 0);
+}
 
+void Octree::intersect(const vector<Box> & boxes, vector<unsigned char> & hitRtn) const {
+	hitRtn.assign(boxes.size(), 0);
+	vector<int> all(boxes.size());
+	for (int i = 0; i < all.size(); i++) all[i] = i;
+	deque<vector<int>> scratch;
+	intersectBoxes(boxes, root, all, hitRtn, scratch, 0);
+}
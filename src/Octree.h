@@ -8,39 +8,57 @@
 //  Copyright (c) by Kevin M. Smith
 //  Copying or use without permission is prohibited by law.
 //
+//  The octree only depends on box.h / ray.h so it can be used by the headless
+//  simulation (see Simulation.h).  The draw functions are implemented in
+//  OctreeDraw.cpp, which is the only part that needs openFrameworks.
+//
 #pragma once
-#include "ofMain.h"
+#include <vector>
 #include "box.h"
 #include "ray.h"
+#include "QuantizedMesh.h"
+#include "VertexView.h"
 
 
 
 class TreeNode {
 public:
 	Box box;
-	vector<int> points;
-	vector<TreeNode> children;
+	std::vector<int> points;
+	std::vector<TreeNode> children;
 };
 
 class Octree {
 public:
 	
-	void create(const ofMesh & mesh, int numLevels);
-	void subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int level);
-	bool intersect(const Ray &, const TreeNode & node, TreeNode & nodeRtn);
-	bool intersect(const Box &, TreeNode & node, vector<Box> & boxListRtn);
+	// build over the vertices where they are (see VertexView.h; a
+	// std::vector<Vector3> converts).  the octree keeps its own quantized
+	// copy, so the source can go once create() returns
+	//
+	void create(const VertexView & verts, int numLevels);
+	void subdivide(const VertexView & verts, TreeNode & node, int numLevels, int level);
+	bool intersect(const Ray &, const TreeNode & node, TreeNode & nodeRtn) const;
+	bool intersect(const Box &, const TreeNode & node, std::vector<Box> & boxListRtn) const;
+
+	// batched queries: one traversal of the tree for many rays or boxes.
+	// nodesRtn[i] is the leaf intersect(rays[i], root, ...) finds (NULL on a
+	// miss); hitRtn[i] is 1 if boxes[i] overlaps any leaf
+	//
+	void intersect(const std::vector<Ray> & rays, std::vector<const TreeNode *> & nodesRtn) const;
+	void intersect(const std::vector<Box> & boxes, std::vector<unsigned char> & hitRtn) const;
 	void draw(TreeNode & node, int numLevels, int level);
 	void draw(int numLevels, int level) {
 		draw(root, numLevels, level);
 	}
 	void drawLeafNodes(TreeNode & node);
 	static void drawBox(const Box &box);
-	static Box meshBounds(const ofMesh &);
-	int getMeshPointsInBox(const ofMesh &mesh, const vector<int> & points, Box & box, vector<int> & pointsRtn);
-	int getMeshFacesInBox(const ofMesh &mesh, const vector<int> & faces, Box & box, vector<int> & facesRtn);
-	void subDivideBox8(const Box &b, vector<Box> & boxList);
+	static Box meshBounds(const VertexView &);
+	int getMeshPointsInBox(const VertexView &verts, const std::vector<int> & points, Box & box, std::vector<int> & pointsRtn);
+	int getMeshFacesInBox(const VertexView &verts, const std::vector<int> &indices, const std::vector<int> & faces, Box & box, std::vector<int> & facesRtn);
+	void subDivideBox8(const Box &b, std::vector<Box> & boxList);
 
-	ofMesh mesh;
+	QuantizedPositions vertices;    // the mesh's, 16 bit (see QuantizedMesh.h)
+	unsigned long long hash = 0;    // of vertices, to tell terrains apart (recordings)
 	TreeNode root;
 	bool bUseFaces = false;
 
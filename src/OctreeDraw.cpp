@@ -0,0 +1,46 @@
+//--------------------------------------------------------------
+//
+//  Kevin M. Smith
+//
+//  Simple Octree Implementation 11/10/2020
+// 
+//  Copyright (c) by Kevin M. Smith
+//  Copying or use without permission is prohibited by law. 
+//
+//  Octree drawing, split from Octree.cpp so the octree itself has no
+//  openFrameworks dependency.
+
+#include "Octree.h"
+#include "ofMain.h"
+
+
+
+//draw a box from a "Box" class  
+//
+void Octree::drawBox(const Box &box) {
+	Vector3 min = box.parameters[0];
+	Vector3 max = box.parameters[1];
+	Vector3 size = max - min;
+	Vector3 center = size / 2 + min;
+	ofVec3f p = ofVec3f(center.x(), center.y(), center.z());
+	float w = size.x();
+	float h = size.y();
+	float d = size.z();
+	ofDrawBox(p, w, h, d);
+}
+
+void Octree::draw(TreeNode & node, int numLevels, int level) {
+	if (level >= numLevels) return;
+	drawBox(node.box);
+	level++;
+	for (int i = 0; i < node.children.size(); i++) {
+		draw(node.children[i], numLevels, level);
+	}
+}
+
+// Optional
+//
+void Octree::drawLeafNodes(TreeNode & node) {
+
+
+}
@@ -0,0 +1,131 @@
+#include "PadIndex.h"
+#include <algorithm>
+#include <float.h>
+
+using namespace std;
+
+void PadIndex::build(const vector<LandingPad> &pads, float defaultRadius) {
+	int n = (int)pads.size();
+	px.resize(n);
+	pz.resize(n);
+	radii.resize(n);
+	maxRadius = 0;
+	cellStart.clear();
+	indices.clear();
+	nx = nz = 0;
+	if (n == 0) return;
+
+	minX = pads[0].position.x();
+	minZ = pads[0].position.z();
+	float maxX = minX, maxZ = minZ;
+	for (int i = 0; i < n; i++) {
+		px[i] = pads[i].position.x();
+		pz[i] = pads[i].position.z();
+		radii[i] = pads[i].radius > 0 ? pads[i].radius : defaultRadius;
+		maxRadius = max(maxRadius, radii[i]);
+		minX = min(minX, px[i]); maxX = max(maxX, px[i]);
+		minZ = min(minZ, pz[i]); maxZ = max(maxZ, pz[i]);
+	}
+
+	// cells of about two pads each (if the pads were spread evenly), but no
+	// smaller than a landing circle
+	//
+	float w = max(maxX - minX, 1e-3f), h = max(maxZ - minZ, 1e-3f);
+	cellSize = max(sqrt(w * h * 2 / n), 2 * maxRadius);
+	nx = min((int)(w / cellSize) + 1, 4096);
+	nz = min((int)(h / cellSize) + 1, 4096);
+	cellSize = max(cellSize, max(w / nx, h / nz) * 1.0001f);
+
+	// counting sort of the pads by cell
+	//
+	vector<int> cell(n);
+	cellStart.assign(nx * nz + 1, 0);
+	for (int i = 0; i < n; i++) {
+		cell[i] = cellZ(pz[i]) * nx + cellX(px[i]);
+		cellStart[cell[i] + 1]++;
+	}
+	for (int c = 0; c < nx * nz; c++)
+		cellStart[c + 1] += cellStart[c];
+	indices.resize(n);
+	vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	for (int i = 0; i < n; i++)
+		indices[fill[cell[i]]++] = i;
+}
+
+int PadIndex::padAt(float x, float z, float *distance) const {
+	int best = -1;
+	float bestDist = 0;
+	forEachWithin(x, z, maxRadius, [&](int i, float d) {
+		if (d <= radii[i] && (best < 0 || d < bestDist || (d == bestDist && i < best))) {
+			best = i;
+			bestDist = d;
+		}
+	});
+	if (distance) *distance = bestDist;
+	return best;
+}
+
+// squared distance from (x, z) to the nearest cell not within ring - 1
+// of (cx, cz); FLT_MAX when that covers the grid
+//
+float PadIndex::unsearchedDistance2(float x, float z, int cx, int cz, int ring) const {
+	int x0 = max(cx - ring + 1, 0), x1 = min(cx + ring - 1, nx - 1);
+	int z0 = max(cz - ring + 1, 0), z1 = min(cz + ring - 1, nz - 1);
+	float gx = max(0.0f, max(minX - x, x - (minX + nx * cellSize)));
+	float gz = max(0.0f, max(minZ - z, z - (minZ + nz * cellSize)));
+	float d2 = FLT_MAX;
+	auto strip = [&](float across, float along) {
+		across = max(across, 0.0f);
+		d2 = min(d2, across * across + along * along);
+	};
+	if (x0 > 0) strip(x - (minX + x0 * cellSize), gz);
+	if (x1 < nx - 1) strip(minX + (x1 + 1) * cellSize - x, gz);
+	if (z0 > 0) strip(z - (minZ + z0 * cellSize), gx);
+	if (z1 < nz - 1) strip(minZ + (z1 + 1) * cellSize - z, gx);
+	return d2;
+}
+
+int PadIndex::nearest(float x, float z, int k, vector<int> &padsRtn, vector<pair<float, int>> &best) const {
+	padsRtn.clear();
+	if (indices.empty() || k <= 0) return 0;
+
+	// best k so far as (distance squared, pad), kept sorted
+	//
+	best.clear();
+	int cx = cellX(x), cz = cellZ(z);
+	int maxRing = max(max(cx, nx - 1 - cx), max(cz, nz - 1 - cz));
+	for (int ring = 0; ring <= maxRing; ring++) {
+
+		// no pad in this ring or beyond is closer than the cells outside the
+		// rectangle already searched.  those are strips beyond each of its
+		// sides that hasn't reached the edge of the grid, and the point may be
+		// outside the grid too (cx, cz are clamped)
+		//
+		if (best.size() == k && ring > 0 && unsearchedDistance2(x, z, cx, cz, ring) >= best.back().first)
+			break;
+
+		for (int gz = cz - ring; gz <= cz + ring; gz++) {
+			if (gz < 0 || gz >= nz) continue;
+			bool edgeRow = gz == cz - ring || gz == cz + ring;
+			for (int gx = cx - ring; gx <= cx + ring; gx += edgeRow ? 1 : 2 * ring) {
+				if (gx >= 0 && gx < nx) {
+					int c = gz * nx + gx;
+					for (int j = cellStart[c]; j < cellStart[c + 1]; j++) {
+						int i = indices[j];
+						float dx = px[i] - x, dz = pz[i] - z;
+						pair<float, int> e(dx * dx + dz * dz, i);
+						if (best.size() < k || e < best.back()) {
+							best.insert(upper_bound(best.begin(), best.end(), e), e);
+							if (best.size() > k) best.pop_back();
+						}
+					}
+				}
+				if (ring == 0) break;
+			}
+		}
+	}
+
+	for (int i = 0; i < best.size(); i++)
+		padsRtn.push_back(best[i].second);
+	return (int)padsRtn.size();
+}
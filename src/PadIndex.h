@@ -0,0 +1,82 @@
+#pragma once
+
+//  Uniform 2D grid over the landing pads on the ground plane (x, z), for
+//  maps with thousands of pads.  Pads are binned by center into a dense grid
+//  sized for a couple of pads per cell, laid out as a counting sort: the pads
+//  of cell c are indices[cellStart[c] .. cellStart[c + 1]).  Radius queries
+//  visit only the cells the circle covers; nearest queries search rings of
+//  cells outward from the point and stop once no closer pad can remain.
+//
+#include <vector>
+#include <utility>
+#include <math.h>
+#include "vector3.h"
+
+class LandingPad {
+public:
+	LandingPad() { }
+	LandingPad(const Vector3 &p, float s, float r = 0) : position(p), score(s), radius(r) { }
+	Vector3 position;
+	float score = 0;
+	float radius = 0;               // landing radius; 0 uses LanderParams::landingAreaRadius
+};
+
+class PadIndex {
+public:
+	void build(const std::vector<LandingPad> &pads, float defaultRadius);
+	int size() const { return (int)radii.size(); }
+	float radius(int pad) const { return radii[pad]; }
+
+	// call fn(pad, distance) for every pad whose center is within r of (x, z)
+	//
+	template <typename F>
+	void forEachWithin(float x, float z, float r, F fn) const;
+
+	// pad whose landing radius contains (x, z), the nearest if several; -1 if none
+	//
+	int padAt(float x, float z, float *distance = nullptr) const;
+
+	// the k nearest pads to (x, z), nearest first; returns how many were found.
+	// best is scratch, for callers that query every tick and keep one, so
+	// the search doesn't allocate once it has grown to k
+	//
+	int nearest(float x, float z, int k, std::vector<int> &padsRtn) const {
+		std::vector<std::pair<float, int>> best;
+		return nearest(x, z, k, padsRtn, best);
+	}
+	int nearest(float x, float z, int k, std::vector<int> &padsRtn, std::vector<std::pair<float, int>> &best) const;
+
+private:
+	int cellX(float x) const { return clampCell((int)floor((x - minX) / cellSize), nx); }
+	int cellZ(float z) const { return clampCell((int)floor((z - minZ) / cellSize), nz); }
+	static int clampCell(int c, int n) { return c < 0 ? 0 : (c >= n ? n - 1 : c); }
+	float unsearchedDistance2(float x, float z, int cx, int cz, int ring) const;
+
+	std::vector<float> px, pz;      // pad centers
+	std::vector<float> radii;
+	float maxRadius = 0;
+
+	float minX = 0, minZ = 0, cellSize = 1;
+	int nx = 0, nz = 0;
+	std::vector<int> cellStart;
+	std::vector<int> indices;       // pad indices sorted by cell
+};
+
+template <typename F>
+void PadIndex::forEachWithin(float x, float z, float r, F fn) const {
+	if (indices.empty()) return;
+	int x0 = cellX(x - r), x1 = cellX(x + r);
+	int z0 = cellZ(z - r), z1 = cellZ(z + r);
+	float r2 = r * r;
+	for (int cz = z0; cz <= z1; cz++) {
+		for (int cx = x0; cx <= x1; cx++) {
+			int c = cz * nx + cx;
+			for (int j = cellStart[c]; j < cellStart[c + 1]; j++) {
+				int i = indices[j];
+				float dx = px[i] - x, dz = pz[i] - z;
+				float d2 = dx * dx + dz * dz;
+				if (d2 <= r2) fn(i, sqrt(d2));
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm>
+#include "JobGraph.h"
+
+//  Split the range [0, count) into contiguous chunks and call fn(begin, end)
+//  for each chunk, one chunk per thread of the shared JobScheduler.  The
+//  calling thread works on chunks too.  Ranges smaller than minChunk per
+//  thread run inline.
+//
+template <typename F>
+void parallelFor(int count, F fn, int minChunk = 1024) {
+	JobScheduler &scheduler = JobScheduler::shared();
+	int numChunks = std::max(1, std::min(scheduler.numThreads(), count / std::max(1, minChunk)));
+	if (numChunks <= 1) {
+		if (count > 0) fn(0, count);
+		return;
+	}
+
+	int chunk = (count + numChunks - 1) / numChunks;
+	scheduler.parallelFor(numChunks, [&](int c) {
+		int begin = c * chunk;
+		int end = std::min(count, begin + chunk);
+		if (begin < end) fn(begin, end);
+	});
+}
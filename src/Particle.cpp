@@ -14,6 +14,7 @@ Particle::Particle() {
 	radius = .1;
 	damping = .99;
 	mass = 1;
+	group = 0;
 	color = ofColor::aquamarine;
 }
 
@@ -30,22 +31,21 @@ void Particle::integrate() {
 	
 	// interval for this step
 	//
-	float dt = 1.0 / ofGetFrameRate();
+	integrate(1.0 / ofGetFrameRate());
+}
 
-	// update position based on velocity
-	//
-	position += (velocity * dt);
+void Particle::integrate(float dt) {
 
 	// update acceleration with accumulated paritcles forces
 	// remember :  (f = ma) OR (a = 1/m * f)
 	//
 	ofVec3f accel = acceleration;    // start with any acceleration already on the particle
 	accel += (forces * (1.0 / mass));
-	velocity += accel * dt;
 
-	// add a little damping for good measure
+	// update position and velocity, with a little damping for good measure
+	// (damping is per 1/60 sec)
 	//
-	velocity *= damping;
+	ParticleIntegrator::step(position, velocity, accel, damping, dt);
 
 	// clear forces on particle (they get re-added each step)
 	//
@@ -55,7 +55,11 @@ void Particle::integrate() {
 //  return age in seconds
 //
 float Particle::age() {
-	return (ofGetElapsedTimeMillis() - birthtime)/1000.0;
+	return age(ofGetElapsedTimeMillis());
+}
+
+float Particle::age(float time) const {
+	return (time - birthtime)/1000.0;
 }
 
 
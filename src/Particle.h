@@ -1,6 +1,11 @@
 #pragma once
 
 #include "ofMain.h"
+#include "Integrator.h"
+
+// integration scheme for particles (see Integrator.h)
+//
+typedef ExplicitEuler ParticleIntegrator;
 
 class ParticleForceField;
 
@@ -17,9 +22,12 @@ public:
 	float   lifespan;
 	float   radius;
 	float   birthtime;
+	int     group;        // force group (see ParticleSystem::addGroup)
 	void    integrate();
+	void    integrate(float dt);
 	void    draw();
 	float   age();        // sec
+	float   age(float time) const;  // sec, at time (ms)
 	ofColor color;
 };
 
@@ -28,6 +28,7 @@ ParticleEmitter::~ParticleEmitter() {
 }
 
 void ParticleEmitter::init() {
+	position = ofVec3f(0, 0, 0);
 	rate = 1;
 	velocity = ofVec3f(0, 20, 0);
 	lifespan = 3;
@@ -44,6 +45,9 @@ void ParticleEmitter::init() {
 	type = DirectionalEmitter;
 	groupSize = 1;
 	damping = .99;
+	bAnalytic = false;
+	group = 0;
+	rng.seed((unsigned int)ofRandom(0, 1 << 30));
 }
 
 
@@ -56,13 +60,17 @@ void ParticleEmitter::draw() {
 			break;
 		case SphereEmitter:
 		case RadialEmitter:
+		case DiskEmitter:
 			ofDrawSphere(position, radius/10);  // just draw a small sphere as a placeholder
 			break;
 		default:
 			break;
 		}
 	}
-	sys->draw();  
+	if (bAnalytic)
+		analyticSys.draw(ofGetElapsedTimeMillis(), particleRadius);
+	else
+		sys->draw();  
 }
 void ParticleEmitter::start() {
 	started = true;
@@ -77,6 +85,11 @@ void ParticleEmitter::update() {
 
 	float time = ofGetElapsedTimeMillis();
 
+	// new particles go into the front buffer, so the step in flight
+	// (threaded systems) has to finish first
+	//
+	sys->sync();
+
 	if (oneShot && started) {
 		if (!fired) {
 
@@ -101,7 +114,13 @@ void ParticleEmitter::update() {
 		lastSpawned = time;
 	}
 
-	sys->update();
+	// analytic particles are not stepped, only expired.  a shared system
+	// is updated once per frame by its owner, not by each emitter.
+	//
+	if (bAnalytic)
+		analyticSys.update(time);
+	else if (createdSys)
+		sys->update();
 }
 
 // spawn a single particle.  time is current time of birth
@@ -116,7 +135,7 @@ void ParticleEmitter::spawn(float time) {
 	switch (type) {
 	case RadialEmitter:
 	{
-		ofVec3f dir = ofVec3f(ofRandom(-1, 1), ofRandom(-1, 1), ofRandom(-1, 1));
+		ofVec3f dir = ofVec3f(random(-1, 1), random(-1, 1), random(-1, 1));
 		float speed = velocity.length();
 		particle.velocity = dir.getNormalized() * speed;
 		particle.position.set(position);
@@ -124,6 +143,18 @@ void ParticleEmitter::spawn(float time) {
 	break;
 	case SphereEmitter:
 		break;
+	case DiskEmitter:
+	{
+		// spawn inside a horizontal disk of "radius", blown outward along the
+		// ground at the emitter speed with up to velocity.y of lift
+		//
+		float angle = random(0, TWO_PI);
+		ofVec3f dir = ofVec3f(cos(angle), 0, sin(angle));
+		particle.position = position + dir * random(0, radius);
+		particle.velocity = dir * velocity.length();
+		particle.velocity.y = random(0, velocity.y);
+	}
+	break;
 	case DirectionalEmitter:
 		particle.velocity = velocity;
 		particle.position.set(position);
@@ -133,15 +164,26 @@ void ParticleEmitter::spawn(float time) {
 	// other particle attributes
 	//
 	if (randomLife) {
-		particle.lifespan = ofRandom(lifeMinMax.x, lifeMinMax.y);
+		particle.lifespan = random(lifeMinMax.x, lifeMinMax.y);
 	}
 	else particle.lifespan = lifespan;
 	particle.birthtime = time;
 	particle.radius = particleRadius;
 	particle.mass = mass;
 	particle.damping = damping;
+	particle.group = group;
 
-	// add to system
+	// add to system.  analytic particles only keep their spawn state
 	//
-	sys->add(particle);
+	if (bAnalytic)
+		analyticSys.add(particle.position, particle.velocity, particle.birthtime, particle.lifespan);
+	else
+		sys->add(particle);
+}
+
+// uniform random number in [min, max) from the emitter's generator
+//
+float ParticleEmitter::random(float min, float max) {
+	if (max < min) std::swap(min, max);
+	return std::uniform_real_distribution<float>(min, max)(rng);
 }
@@ -1,15 +1,17 @@
 #pragma once
 //  Kevin M. Smith - CS 134 SJSU
 
-#include "TransformObject.h"
 #include "ParticleSystem.h"
+#include "AnalyticParticleSystem.h"
+#include <random>
 
-typedef enum { DirectionalEmitter, RadialEmitter, SphereEmitter } EmitterType;
+typedef enum { DirectionalEmitter, RadialEmitter, SphereEmitter, DiskEmitter } EmitterType;
 
 //  General purpose Emitter class for emitting sprites
-//  This works similar to a Particle emitter
+//  This works similar to a Particle emitter.  In the scene it is placed by
+//  its entity's transform (Scene::updateEmitters)
 //
-class ParticleEmitter : public TransformObject {
+class ParticleEmitter {
 public:
 	ParticleEmitter();
 	ParticleEmitter(ParticleSystem *s);
@@ -28,10 +30,16 @@ public:
 	void setRandomLife(bool b) { randomLife = b;  }
 	void setLifespanRange(const ofVec2f &r) { lifeMinMax = r; }
 	void setMass(float m) { mass = m; }
-	void setDamping(float d) { damping = d; }
+	void setDamping(float d) { damping = d; analyticSys.setDamping(d); }
+	void setAnalytic(bool b) { bAnalytic = b; }
+	void setGroup(int g) { group = g; }
 	void update();
 	void spawn(float time);
+	float random(float min, float max);
 	ParticleSystem *sys;
+	ofVec3f position;
+	AnalyticParticleSystem analyticSys;   // used instead of sys in analytic mode
+	bool bAnalytic;
 	float rate;         // per sec
 	bool oneShot;
 	bool fired;
@@ -48,5 +56,7 @@ public:
 	bool visible;
 	int groupSize;      // number of particles to spawn in a group
 	bool createdSys;
+	int group;          // force group of the particles spawned into sys
 	EmitterType type;
+	std::mt19937 rng;   // own generator, so emitters can spawn on different threads
 };
@@ -2,13 +2,55 @@
 // Kevin M.Smith - CS 134 SJSU
 
 #include "ParticleSystem.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <random>
+
+// forces may be evaluated on a worker thread, so they draw from a
+// per-thread generator rather than the shared ofRandom() state
+//
+static float randomRange(float min, float max) {
+	thread_local std::mt19937 rng(std::random_device{}());
+	return std::uniform_real_distribution<float>(min, max)(rng);
+}
+
+ParticleSystem::ParticleSystem() {
+	groups.resize(1);
+}
+
+ParticleSystem::~ParticleSystem() {
+	sync();
+	if (worker.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bQuit = true;
+		}
+		wake.notify_all();
+		worker.join();
+	}
+}
 
 void ParticleSystem::add(const Particle &p) {
 	particles.push_back(p);
 }
 
+// add a new force group and return its id
+//
+int ParticleSystem::addGroup() {
+	groups.push_back(ParticleGroup());
+	return (int)groups.size() - 1;
+}
+
 void ParticleSystem::addForce(ParticleForce *f) {
-	forces.push_back(f);
+	addForce(f, 0);
+}
+
+void ParticleSystem::addForce(ParticleForce *f, int group) {
+	groups[group].forces.push_back(f);
+}
+
+void ParticleSystem::addNeighborForce(ParticleNeighborForce *f, int group) {
+	groups[group].neighborForces.push_back(f);
 }
 
 void ParticleSystem::remove(int i) {
@@ -22,52 +64,158 @@ void ParticleSystem::setLifespan(float l) {
 }
 
 void ParticleSystem::reset() {
+	for (int g = 0; g < groups.size(); g++) {
+		reset(g);
+	}
+}
+
+// re-arm the one shot forces of a group
+//
+void ParticleSystem::reset(int group) {
+	vector<ParticleForce *> &forces = groups[group].forces;
 	for (int i = 0; i < forces.size(); i++) {
 		forces[i]->applied = false;
 	}
 }
 
+// advance one step of the frame interval
+//
 void ParticleSystem::update() {
-	// check if empty and just return
-	if (particles.size() == 0) return;
+	update(1.0 / ofGetFrameRate(), 1);
+}
 
-	vector<Particle>::iterator p = particles.begin();
-	vector<Particle>::iterator tmp;
+// advance "steps" fixed steps of dt seconds
+//
+void ParticleSystem::update(float dt, int steps) {
 
-	// check which particles have exceed their lifespan and delete
-	// from list.  When deleting multiple objects from a vector while
-	// traversing at the same time, we need to use an iterator.
+	// the clock is sampled here on the calling thread
+	// so the worker never touches openFrameworks globals
 	//
-	while (p != particles.end()) {
-		if (p->lifespan != -1 && p->age() > p->lifespan) {
-			tmp = particles.erase(p);
-			p = tmp;
-		}
-		else p++;
+	float time = ofGetElapsedTimeMillis();
+
+	if (!bThreaded) {
+		simulate(dt, steps, time);
+		particles.swap(back);
+		return;
 	}
 
-	// update forces on all particles first 
+	// collect the previous step (if still running) and start the next one.
+	// the worker only reads the front buffer, so draw() can keep using it.
 	//
-	for (int i = 0; i < particles.size(); i++) {
-		for (int k = 0; k < forces.size(); k++) {
-			if (!forces[k]->applied)
-				forces[k]->updateForce( &particles[i] );
-		}
+	sync();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stepDt = dt;
+		stepCount = steps;
+		stepTime = time;
+		bBusy = true;
 	}
+	bStepped = true;
+	if (!worker.joinable())
+		worker = std::thread(&ParticleSystem::workerLoop, this);
+	wake.notify_all();
+}
 
-	// update all forces only applied once to "applied"
-	// so they are not applied again.
-	//
-	for (int i = 0; i < forces.size(); i++) {
-		if (forces[i]->applyOnce)
-			forces[i]->applied = true;
+// wait for the simulation step in flight and swap it to the front
+//
+void ParticleSystem::sync() {
+	if (!bStepped) return;
+	ProfileScope scope("particle sync");
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wake.wait(lock, [this] { return !bBusy; });
+	}
+	particles.swap(back);
+	bStepped = false;
+}
+
+void ParticleSystem::workerLoop() {
+	Profiler::shared().setThreadName("particles");
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this] { return bQuit || bBusy; });
+		if (bQuit) return;
+		float dt = stepDt, time = stepTime;
+		int steps = stepCount;
+		lock.unlock();
+		simulate(dt, steps, time);
+		lock.lock();
+		bBusy = false;
+		wake.notify_all();
 	}
+}
+
+// simulate: read live particles from the front buffer and write the result
+// of "steps" integration steps to the back buffer.
+//
+void ParticleSystem::simulate(float dt, int steps, float time) {
+	ProfileScope scope("particle simulate");
+	int numGroups = (int)groups.size();
 
-	// integrate all the particles in the store
+	// particles that have exceeded their lifespan are not carried over.
+	// the live ones are counted per group first so the back buffer can be
+	// laid out group by group (a counting sort, stable within each group).
 	//
-	for (int i = 0; i < particles.size(); i++)
-		particles[i].integrate();
+	groupStart.assign(numGroups + 1, 0);
+	for (int i = 0; i < particles.size(); i++) {
+		const Particle &p = particles[i];
+		if (p.lifespan != -1 && p.age(time) > p.lifespan) continue;
+		groupStart[p.group + 1]++;
+	}
+	for (int g = 0; g < numGroups; g++)
+		groupStart[g + 1] += groupStart[g];
 
+	back.resize(groupStart[numGroups]);
+	vector<int> next(groupStart.begin(), groupStart.end() - 1);
+	for (int i = 0; i < particles.size(); i++) {
+		const Particle &p = particles[i];
+		if (p.lifespan != -1 && p.age(time) > p.lifespan) continue;
+		back[next[p.group]++] = p;
+	}
+
+	for (int step = 0; step < steps; step++) {
+		// update forces on all particles first, one group (force set) at a time
+		//
+		for (int g = 0; g < numGroups; g++) {
+
+			// neighbor forces: hash the group's particles, then evaluate each
+			// particle against its neighbors in parallel.  each particle only
+			// writes its own forces, and positions are not modified here.
+			//
+			vector<ParticleNeighborForce *> &neighborForces = groups[g].neighborForces;
+			int start = groupStart[g];
+			int count = groupStart[g + 1] - start;
+			for (int k = 0; k < neighborForces.size() && count > 0; k++) {
+				ParticleNeighborForce *f = neighborForces[k];
+				grid.build(back, start, count, f->radius);
+				parallelFor(count, [&](int begin, int end) {
+					for (int i = start + begin; i < start + end; i++)
+						f->updateForce(&back[i], back, grid);
+				}, 256);
+			}
+
+			vector<ParticleForce *> &forces = groups[g].forces;
+			for (int i = groupStart[g]; i < groupStart[g + 1]; i++) {
+				for (int k = 0; k < forces.size(); k++) {
+					if (!forces[k]->applied)
+						forces[k]->updateForce( &back[i] );
+				}
+			}
+
+			// update all forces only applied once to "applied"
+			// so they are not applied again.
+			//
+			for (int k = 0; k < forces.size(); k++) {
+				if (forces[k]->applyOnce)
+					forces[k]->applied = true;
+			}
+		}
+
+		// integrate all the particles in the store
+		//
+		for (int i = 0; i < back.size(); i++)
+			back[i].integrate(dt);
+	}
 }
 
 // remove all particlies within "dist" of point (not implemented as yet)
@@ -108,9 +256,9 @@ void TurbulenceForce::updateForce(Particle * particle) {
 	// We are going to add a little "noise" to a particles
 	// forces to achieve a more natual look to the motion
 	//
-	particle->forces.x += ofRandom(tmin.x, tmax.x);
-	particle->forces.y += ofRandom(tmin.y, tmax.y);
-	particle->forces.z += ofRandom(tmin.z, tmax.z);
+	particle->forces.x += randomRange(tmin.x, tmax.x);
+	particle->forces.y += randomRange(tmin.y, tmax.y);
+	particle->forces.z += randomRange(tmin.z, tmax.z);
 }
 
 // Impulse Radial Force - this is a "one shot" force that
@@ -124,10 +272,32 @@ ImpulseRadialForce::ImpulseRadialForce(float magnitude) {
 void ImpulseRadialForce::updateForce(Particle * particle) {
 
 	// we basically create a random direction for each particle
-	// the force is only added once after it is triggered.
+	// the kick is only added once after it is triggered.  it goes straight
+	// into the velocity, as much as "magnitude" applied for one 1/60 sec
+	// frame would give, so it doesn't depend on the simulation step
 	//
-	ofVec3f dir = ofVec3f(ofRandom(-1, 1), ofRandom(-height/2.0, height/2.0), ofRandom(-1, 1));
-	particle->forces += dir.getNormalized() * magnitude;
+	ofVec3f dir = ofVec3f(randomRange(-1, 1), randomRange(-height/2.0, height/2.0), randomRange(-1, 1));
+	particle->velocity += dir.getNormalized() * (magnitude / (60 * particle->mass));
+}
+
+// Separation Force - push apart particles closer than "radius"
+//
+SeparationForce::SeparationForce(float radius, float stiffness) {
+	this->radius = radius;
+	this->stiffness = stiffness;
+}
+
+void SeparationForce::updateForce(Particle * particle, const vector<Particle> &particles, const SpatialHash &grid) {
+	ofVec3f p = particle->position;
+	ofVec3f f(0, 0, 0);
+	grid.forEachNeighbor(particles, p, radius, [&](int j) {
+		ofVec3f d = p - particles[j].position;
+		float dist = d.length();
+		if (dist < 1e-5) return;     // itself, or coincident
+		float w = 1 - dist / radius;
+		f += d * (stiffness * w * w / dist);
+	});
+	particle->forces += f;
 }
 
 CyclicForce::CyclicForce(float magnitude) {
@@ -3,6 +3,10 @@
 
 #include "ofMain.h"
 #include "Particle.h"
+#include "SpatialHash.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 //  Pure Virtual Function Class - must be subclassed to create new forces.
@@ -15,18 +19,75 @@ public:
 	virtual void updateForce(Particle *) = 0;
 };
 
+//  Base class for forces that depend on nearby particles of the same group
+//  (pressure, separation).  The system builds a spatial hash over the group
+//  with cell size "radius" before these are evaluated, in parallel.
+//
+class ParticleNeighborForce {
+public:
+	float radius = 1;
+	virtual void updateForce(Particle *, const vector<Particle> &, const SpatialHash &) = 0;
+};
+
+//  A set of forces and the particles they act on.  Emitters sharing one
+//  system tag their particles with a group id so each only gets its own forces.
+//
+class ParticleGroup {
+public:
+	vector<ParticleForce *> forces;
+	vector<ParticleNeighborForce *> neighborForces;
+	float spriteSize = 5;     // point size when the store is drawn as one vbo
+	ofFloatColor color = ofFloatColor(1, .39, .35);
+};
+
+//  Particles from any number of emitters live in one store and are updated
+//  in a single pass, grouped by force set (see ParticleGroup).
+//
+//  The system keeps two particle buffers.  "particles" is the front buffer
+//  that draw() and the vbo loaders read; each update simulates the front
+//  buffer into the back buffer and the two are swapped at the frame boundary.
+//  In threaded mode the simulation runs on a worker thread so it overlaps
+//  with rendering; call sync() before touching the front buffer or forces.
+//  The worker is started on the first threaded update and waits for the
+//  next one in between.
+//
 class ParticleSystem {
 public:
+	ParticleSystem();
+	~ParticleSystem();
 	void add(const Particle &);
+	int addGroup();
 	void addForce(ParticleForce *);
+	void addForce(ParticleForce *, int group);
+	void addNeighborForce(ParticleNeighborForce *, int group);
 	void remove(int);
 	void update();
+	void update(float dt, int steps);
+	void sync();
+	void setThreaded(bool b) { bThreaded = b; }
 	void setLifespan(float);
 	void reset();
+	void reset(int group);
 	int removeNear(const ofVec3f & point, float dist);
 	void draw();
 	vector<Particle> particles;
-	vector<ParticleForce *> forces;
+	vector<ParticleGroup> groups;     // group 0 always exists
+	bool bThreaded = false;
+private:
+	void simulate(float dt, int steps, float time);
+	void workerLoop();
+	vector<Particle> back;
+	vector<int> groupStart;
+	SpatialHash grid;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;     // a step to run, a step done, or quit
+	bool bBusy = false;               // the worker has a step to finish
+	bool bQuit = false;
+	bool bStepped = false;            // a step was started and not swapped in yet
+	float stepDt = 0, stepTime = 0;
+	int stepCount = 0;
 };
 
 
@@ -59,6 +120,17 @@ public:
 	void updateForce(Particle *);
 };
 
+//  Short range repulsion between particles of a group, a simple stand in
+//  for SPH pressure: pushes apart with strength growing as (1 - d/radius)^2.
+//
+class SeparationForce : public ParticleNeighborForce {
+	float stiffness;
+public:
+	void set(float k) { stiffness = k; }
+	SeparationForce(float radius, float stiffness);
+	void updateForce(Particle *, const vector<Particle> &, const SpatialHash &);
+};
+
 class CyclicForce : public ParticleForce {
 	float magnitude;
 public:
@@ -0,0 +1,299 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+static const char *frameName = "frame";
+
+static long long steadyNsec() {
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// gives the thread's buffer back when the thread exits, so threads that
+// come and go take turns on the buffers
+//
+class ProfileThreadSlot {
+public:
+	~ProfileThreadSlot() {
+		if (buffer) Profiler::shared().release(buffer);
+	}
+	Profiler::ThreadBuffer *buffer = nullptr;
+};
+
+static thread_local ProfileThreadSlot threadSlot;
+
+Profiler::Profiler() : origin(steadyNsec()) { }
+
+// never destroyed: worker threads still give their buffers back while
+// other statics are destroyed at exit
+//
+Profiler &Profiler::shared() {
+	static Profiler *profiler = new Profiler();
+	return *profiler;
+}
+
+long long Profiler::now() const {
+	return steadyNsec() - origin;
+}
+
+Profiler::ThreadBuffer *Profiler::buffer() {
+	if (threadSlot.buffer) return threadSlot.buffer;
+	lock_guard<mutex> lock(registry);
+	ThreadBuffer *b = nullptr;
+	for (int i = 0; i < buffers.size() && !b; i++)
+		if (buffers[i]->bFree) b = buffers[i];
+	if (!b) {
+		b = new ThreadBuffer();
+		b->ring.resize(ringSize);
+		b->tid = (int)buffers.size();
+		buffers.push_back(b);
+	}
+	lock_guard<mutex> lockBuffer(b->mutex);
+	b->bFree = false;
+	b->name = "thread " + to_string(b->tid);
+	b->depth = 0;
+	threadSlot.buffer = b;
+	return b;
+}
+
+void Profiler::release(ThreadBuffer *b) {
+	lock_guard<mutex> lock(registry);
+	lock_guard<mutex> lockBuffer(b->mutex);
+	b->bFree = true;
+}
+
+// a buffer is locked only by its thread and, briefly, by endFrame() and
+// the exports, so the lock is almost never contended
+//
+void Profiler::record(const char *name, long long start, long long end, int depth) {
+	ThreadBuffer *b = buffer();
+	lock_guard<mutex> lock(b->mutex);
+	ProfileEvent &e = b->ring[b->count % ringSize];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+	e.depth = depth;
+	b->count++;
+}
+
+void Profiler::setThreadName(const string &name) {
+	ThreadBuffer *b = buffer();
+	lock_guard<mutex> lock(b->mutex);
+	b->name = name;
+}
+
+const char *Profiler::intern(const string &name) {
+	lock_guard<mutex> lock(registry);
+	return names.insert(name).first->c_str();
+}
+
+//--------------------------------------------------------------
+// main thread
+
+Profiler::Series &Profiler::series(const char *name) {
+	auto it = seriesByPointer.find(name);
+	if (it != seriesByPointer.end()) return allSeries[it->second];
+
+	//the same name may be at different addresses (literals in different files)
+	int i;
+	auto named = seriesByName.find(name);
+	if (named != seriesByName.end()) i = named->second;
+	else {
+		i = (int)allSeries.size();
+		allSeries.emplace_back();
+		allSeries.back().name = name;
+		seriesByName[name] = i;
+	}
+	seriesByPointer[name] = i;
+	return allSeries[i];
+}
+
+// the time between two calls is recorded as a scope itself ("frame"), and
+// the scopes of every thread that ended in it count towards it
+//
+bool Profiler::endFrame() {
+	long long t = now();
+	if (!bEnabled) {
+		frameStart = -1;
+		return false;
+	}
+	if (frameStart < 0) {
+		frameStart = t;
+		return false;
+	}
+	record(frameName, frameStart, t, 0);
+	float frameMs = (t - frameStart) / 1e6f;
+	frameStart = t;
+	frames++;
+
+	{
+		lock_guard<mutex> lock(registry);
+		for (ThreadBuffer *b : buffers) {
+			lock_guard<mutex> lockBuffer(b->mutex);
+			if (b->count - b->read > ringSize)
+				b->read = b->count - ringSize;  //overwritten before they were read
+			for (; b->read < b->count; b->read++) {
+				const ProfileEvent &e = b->ring[b->read % ringSize];
+				Series &s = series(e.name);
+				s.frame += (e.end - e.start) / 1e6f;
+				s.calls++;
+			}
+		}
+	}
+
+	for (Series &s : allSeries) {
+		if (s.ms.size() < window) s.ms.push_back(s.frame);
+		else {
+			s.ms[s.next] = s.frame;
+			s.next = (s.next + 1) % window;
+		}
+		s.last = s.frame;
+		s.lastCalls = s.calls;
+		s.frame = 0;
+		s.calls = 0;
+	}
+
+	if (frameMs <= spikeMs) return false;
+
+	//what took the time, slowest first
+	vector<const Series *> slow;
+	for (const Series &s : allSeries)
+		if (s.name != frameName && s.last > 0) slow.push_back(&s);
+	sort(slow.begin(), slow.end(), [](const Series *a, const Series *b) { return a->last > b->last; });
+	printf("Profiler: frame %llu took %.1f ms:", frames, frameMs);
+	for (int i = 0; i < slow.size() && i < 6; i++)
+		printf("%s %s %.1f", i == 0 ? "" : ",", slow[i]->name.c_str(), slow[i]->last);
+	printf("\n");
+	return true;
+}
+
+static float percentile(vector<float> &v, float p) {
+	int k = min((int)v.size() - 1, (int)(p * v.size()));
+	nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+void Profiler::stats(vector<ProfileStat> &out) const {
+	out.clear();
+	for (const Series &s : allSeries) {
+		if (s.ms.empty()) continue;
+		ProfileStat stat;
+		stat.name = s.name;
+		stat.last = s.last;
+		stat.calls = s.lastCalls;
+		vector<float> v = s.ms;
+		stat.p50 = percentile(v, 0.5);
+		stat.p95 = percentile(v, 0.95);
+		stat.p99 = percentile(v, 0.99);
+		stat.max = *max_element(v.begin(), v.end());
+		out.push_back(stat);
+	}
+	sort(out.begin(), out.end(), [](const ProfileStat &a, const ProfileStat &b) { return a.p95 > b.p95; });
+}
+
+void Profiler::frameTimes(vector<float> &out) const {
+	out.clear();
+	auto it = seriesByName.find(frameName);
+	if (it == seriesByName.end()) return;
+	const Series &s = allSeries[it->second];
+	for (int i = 0; i < s.ms.size(); i++)
+		out.push_back(s.ms[(s.next + i) % s.ms.size()]);
+}
+
+//--------------------------------------------------------------
+// export
+
+void Profiler::snapshot(vector<ThreadEvents> &out) {
+	out.clear();
+	lock_guard<mutex> lock(registry);
+	for (ThreadBuffer *b : buffers) {
+		lock_guard<mutex> lockBuffer(b->mutex);
+		out.emplace_back();
+		ThreadEvents &t = out.back();
+		t.name = b->name;
+		t.tid = b->tid;
+		unsigned long long first = b->count > ringSize ? b->count - ringSize : 0;
+		for (unsigned long long i = first; i < b->count; i++)
+			t.events.push_back(b->ring[i % ringSize]);
+	}
+}
+
+static string csvString(const string &s) {
+	string out = "\"";
+	for (char c : s) {
+		if (c == '"') out += '"';
+		out += c;
+	}
+	return out + "\"";
+}
+
+static string jsonString(const string &s) {
+	string out = "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\') out += '\\';
+		if ((unsigned char)c >= ' ') out += c;
+	}
+	return out + "\"";
+}
+
+// complete ("X") events in usec, and a name for each thread
+//
+bool Profiler::exportTrace(const string &path) {
+	vector<ThreadEvents> threads;
+	snapshot(threads);
+	FILE *out = fopen(path.c_str(), "w");
+	if (!out) {
+		cout << "Profiler: can't write " << path << endl;
+		return false;
+	}
+	int n = 0;
+	fprintf(out, "{\"traceEvents\":[\n");
+	for (const ThreadEvents &t : threads) {
+		fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":%s}}",
+			n++ ? ",\n" : "", t.tid, jsonString(t.name).c_str());
+		for (const ProfileEvent &e : t.events)
+			fprintf(out, ",\n{\"name\":%s,\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				jsonString(e.name).c_str(), t.tid, e.start / 1e3, (e.end - e.start) / 1e3);
+	}
+	fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(out);
+	return true;
+}
+
+bool Profiler::exportCsv(const string &path) {
+	vector<ThreadEvents> threads;
+	snapshot(threads);
+	FILE *out = fopen(path.c_str(), "w");
+	if (!out) {
+		cout << "Profiler: can't write " << path << endl;
+		return false;
+	}
+	fprintf(out, "thread,name,depth,start_us,duration_us\n");
+	for (const ThreadEvents &t : threads)
+		for (const ProfileEvent &e : t.events)
+			fprintf(out, "%s,%s,%d,%.3f,%.3f\n", csvString(t.name).c_str(), csvString(e.name).c_str(),
+				e.depth, e.start / 1e3, (e.end - e.start) / 1e3);
+	fclose(out);
+	return true;
+}
+
+//--------------------------------------------------------------
+
+ProfileScope::ProfileScope(const char *name) : name(name), start(-1), depth(0) {
+	Profiler &p = Profiler::shared();
+	if (!p.bEnabled.load(memory_order_relaxed)) return;
+	depth = p.buffer()->depth++;
+	start = p.now();
+}
+
+void ProfileScope::end() {
+	if (start < 0) return;
+	Profiler &p = Profiler::shared();
+	long long t = p.now();
+	p.buffer()->depth--;
+	p.record(name, start, t, depth);
+	start = -1;
+}
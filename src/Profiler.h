@@ -0,0 +1,138 @@
+#pragma once
+
+//  Scoped timers for finding where frame time goes, cheap enough to leave
+//  on.  A ProfileScope records its name, start and end on the thread it
+//  runs on, into that thread's ring buffer, so the latest few seconds of
+//  every thread (main, job workers, sim, particles) are always there:
+//    - endFrame(), once per frame on the main thread, adds up each scope's
+//      time in the frame into rolling windows (stats(): percentiles), and
+//      reports a frame over spikeMs with the scopes that took the time
+//    - exportTrace() writes the buffered scopes as Chrome trace JSON (open
+//      in chrome://tracing or ui.perfetto.dev), exportCsv() as a table
+//
+//      void Terrain::draw() {
+//          ProfileScope scope("draw terrain");     // a string literal
+//          ...
+//      }
+//
+//  Nothing here depends on openFrameworks.
+//
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+
+// one finished scope.  times are nsec since the profiler started
+//
+class ProfileEvent {
+public:
+	const char *name = nullptr;
+	long long start = 0, end = 0;
+	int depth = 0;                  // scopes open on the thread around it
+};
+
+// a scope's time per frame over the window, in msec
+//
+class ProfileStat {
+public:
+	std::string name;
+	float last = 0;                 // in the latest frame
+	float p50 = 0, p95 = 0, p99 = 0, max = 0;
+	int calls = 0;                  // in the latest frame
+};
+
+class Profiler {
+public:
+	Profiler();
+	static Profiler &shared();
+	long long now() const;          // nsec since the profiler started (steady clock)
+
+	// any thread.  names are not copied (see intern())
+	//
+	void record(const char *name, long long start, long long end, int depth);
+	void setThreadName(const std::string &name);
+	const char *intern(const std::string &name);    // a stable copy, for names that are built
+
+	// main thread.  true if the frame that just ended took over spikeMs
+	//
+	bool endFrame();
+	void stats(std::vector<ProfileStat> &out) const;        // slowest (p95) first
+	void frameTimes(std::vector<float> &out) const;         // msec, oldest first
+	bool exportTrace(const std::string &path);
+	bool exportCsv(const std::string &path);
+
+	std::atomic<bool> bEnabled{true};
+	float spikeMs = 20;
+	int window = 240;               // frames in the percentiles
+
+	static const int ringSize = 1 << 14;    // events kept per thread
+
+private:
+	class ThreadBuffer {
+	public:
+		std::mutex mutex;
+		std::vector<ProfileEvent> ring;
+		unsigned long long count = 0;   // recorded, ever
+		unsigned long long read = 0;    // taken by endFrame()
+		std::string name;
+		int tid = 0;
+		int depth = 0;                  // owner thread only
+		bool bFree = false;             // its thread exited, for the next new thread
+	};
+
+	// a scope's per frame times, window of them in a ring
+	//
+	class Series {
+	public:
+		std::string name;
+		std::vector<float> ms;
+		int next = 0;
+		float frame = 0;                // accumulating this frame
+		int calls = 0;
+		float last = 0;                 // the latest frame's
+		int lastCalls = 0;
+	};
+
+	class ThreadEvents {
+	public:
+		std::string name;
+		int tid = 0;
+		std::vector<ProfileEvent> events;
+	};
+
+	friend class ProfileScope;
+	friend class ProfileThreadSlot;
+	ThreadBuffer *buffer();
+	void release(ThreadBuffer *buffer);
+	Series &series(const char *name);
+	void snapshot(std::vector<ThreadEvents> &out);
+
+	long long origin;
+	long long frameStart = -1;
+	unsigned long long frames = 0;
+
+	mutable std::mutex registry;        // buffers, names
+	std::vector<ThreadBuffer *> buffers;
+	std::set<std::string> names;
+
+	std::vector<Series> allSeries;      // main thread
+	std::unordered_map<const char *, int> seriesByPointer;
+	std::map<std::string, int> seriesByName;
+};
+
+// times the enclosing block, or up to end()
+//
+class ProfileScope {
+public:
+	ProfileScope(const char *name);
+	~ProfileScope() { end(); }
+	void end();
+
+private:
+	const char *name;
+	long long start;
+	int depth;
+};
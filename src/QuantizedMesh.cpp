@@ -0,0 +1,134 @@
+#include "QuantizedMesh.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace std;
+
+void QuantizedPositions::clear() {
+	data.clear();
+	bounds = Box();
+	center = Vector3(0, 0, 0);
+	step = Vector3(1, 1, 1);
+}
+
+void QuantizedPositions::encode(const VertexView &positions) {
+	data.resize(4 * positions.size());
+	if (positions.empty()) return;
+	Vector3 lo = positions[0], hi = positions[0];
+	for (int i = 1; i < positions.size(); i++) {
+		const float *p = positions.at(i);
+		for (int k = 0; k < 3; k++) {
+			lo[k] = min(lo[k], p[k]);
+			hi[k] = max(hi[k], p[k]);
+		}
+	}
+	bounds = Box(lo, hi);
+	center = (lo + hi) / 2;
+	for (int k = 0; k < 3; k++) {
+		float extent = hi[k] - lo[k];
+		step[k] = extent > 0 ? extent / 65534 : 1;
+	}
+
+	for (int i = 0; i < positions.size(); i++) {
+		const float *p = positions.at(i);
+		short *q = &data[4 * i];
+		for (int k = 0; k < 3; k++) {
+			float s = roundf((p[k] - center[k]) / step[k]);
+			q[k] = (short)max(-32767.0f, min(32767.0f, s));
+		}
+		q[3] = 0;
+	}
+}
+
+unsigned long long QuantizedPositions::hash() const {
+	unsigned long long h = 14695981039346656037ull;
+	auto add = [&](const void *p, size_t n) {
+		const unsigned char *b = (const unsigned char *)p;
+		for (size_t i = 0; i < n; i++)
+			h = (h ^ b[i]) * 1099511628211ull;
+	};
+	add(center.data(), 3 * sizeof(float));
+	add(step.data(), 3 * sizeof(float));
+	add(data.data(), data.size() * sizeof(short));
+	return h;
+}
+
+// octahedral mapping: project onto the octahedron |x| + |y| + |z| = 1 and
+// fold the lower half over the upper one, giving a square
+//
+static inline float signOf(float v) { return v < 0 ? -1.0f : 1.0f; }
+
+unsigned int encodeOctahedral(const Vector3 &n) {
+	float l1 = fabsf(n.x()) + fabsf(n.y()) + fabsf(n.z());
+	float u = 0, v = 0;
+	if (l1 > 0) {
+		u = n.x() / l1;
+		v = n.y() / l1;
+		if (n.z() < 0) {
+			float fu = (1 - fabsf(v)) * signOf(u);
+			float fv = (1 - fabsf(u)) * signOf(v);
+			u = fu;
+			v = fv;
+		}
+	}
+	short qu = (short)roundf(max(-1.0f, min(1.0f, u)) * 32767);
+	short qv = (short)roundf(max(-1.0f, min(1.0f, v)) * 32767);
+	return (unsigned short)qu | (unsigned int)(unsigned short)qv << 16;
+}
+
+Vector3 decodeOctahedral(unsigned int e) {
+	float u = (short)(e & 0xffff) / 32767.0f;
+	float v = (short)(e >> 16) / 32767.0f;
+	float z = 1 - fabsf(u) - fabsf(v);
+	if (z < 0) {
+		float fu = (1 - fabsf(v)) * signOf(u);
+		float fv = (1 - fabsf(u)) * signOf(v);
+		u = fu;
+		v = fv;
+	}
+	Vector3 n = Vector3(u, v, z);
+	n.normalize();
+	return n;
+}
+
+void QuantizedMesh::clear() {
+	positions.clear();
+	normals.clear();
+	indices16.clear();
+	indices32.clear();
+	bWideIndices = false;
+}
+
+void QuantizedMesh::build(const ObjMesh &mesh) {
+	clear();
+	positions.encode(mesh.vertices);
+	if (mesh.normals.size() == mesh.vertices.size())
+		setNormals(mesh.normals);
+	setIndices(mesh.indices);
+}
+
+void QuantizedMesh::setNormals(const vector<Vector3> &n) {
+	normals.resize(n.size());
+	for (int i = 0; i < n.size(); i++)
+		normals[i] = encodeOctahedral(n[i]);
+}
+
+// 16 bit indices when every vertex can be reached with them
+//
+void QuantizedMesh::setIndices(const vector<int> &indices) {
+	bWideIndices = numVertices() > 65536;
+	if (bWideIndices) {
+		indices32.assign(indices.begin(), indices.end());
+		vector<unsigned short>().swap(indices16);
+	}
+	else {
+		indices16.assign(indices.begin(), indices.end());
+		vector<unsigned int>().swap(indices32);
+	}
+}
+
+size_t QuantizedMesh::bytes() const {
+	return positions.data.size() * sizeof(short) + normals.size() * sizeof(unsigned int) +
+		indices16.size() * sizeof(unsigned short) + indices32.size() * sizeof(unsigned int);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include "vector3.h"
+#include "box.h"
+#include "ObjMesh.h"
+#include "VertexView.h"
+
+//  Compact mesh storage, for geometry that stays resident: 16 bit positions
+//  quantized to the mesh's bounds, unit normals octahedral encoded in two
+//  16 bit values, and 16 bit indices when there are few enough vertices
+//  (32 bit otherwise).  A vertex is 12 bytes instead of 24, and the same
+//  arrays serve collision (Octree) and drawing (QuantizedVbo uploads them
+//  as they are).
+//
+
+//  Positions as signed 16 bit steps from the center of their bounds, with
+//  a step per axis so each axis spans the full range.  Four shorts per
+//  vertex (the fourth is padding) to keep them aligned for GL.
+//
+class QuantizedPositions {
+public:
+	void encode(const VertexView &positions);
+	void clear();
+
+	Vector3 operator[](int i) const {
+		const short *q = &data[4 * i];
+		return Vector3(center.x() + q[0] * step.x(), center.y() + q[1] * step.y(), center.z() + q[2] * step.z());
+	}
+	int size() const { return (int)data.size() / 4; }
+	bool empty() const { return data.empty(); }
+	unsigned long long hash() const;    // of the encoded positions (FNV-1a)
+
+	Box bounds;
+	Vector3 center = Vector3(0, 0, 0);
+	Vector3 step = Vector3(1, 1, 1);    // position = center + q * step
+	std::vector<short> data;
+};
+
+// unit normal to and from two 16 bit snorm values (x in the low half)
+//
+unsigned int encodeOctahedral(const Vector3 &n);
+Vector3 decodeOctahedral(unsigned int e);
+
+class QuantizedMesh {
+public:
+	void build(const ObjMesh &mesh);
+	void setNormals(const std::vector<Vector3> &normals);
+	void setIndices(const std::vector<int> &indices);
+	void clear();
+
+	int numVertices() const { return positions.size(); }
+	int numIndices() const { return bWideIndices ? (int)indices32.size() : (int)indices16.size(); }
+	int index(int i) const { return bWideIndices ? (int)indices32[i] : (int)indices16[i]; }
+	Vector3 normal(int i) const { return decodeOctahedral(normals[i]); }
+	int indexSize() const { return bWideIndices ? 4 : 2; }
+	const void *indexData() const { return bWideIndices ? (const void *)indices32.data() : (const void *)indices16.data(); }
+	size_t bytes() const;
+
+	QuantizedPositions positions;
+	std::vector<unsigned int> normals;          // octahedral; empty if the mesh has none
+	std::vector<unsigned short> indices16;      // when there are at most 65536 vertices
+	std::vector<unsigned int> indices32;        // otherwise
+	bool bWideIndices = false;
+};
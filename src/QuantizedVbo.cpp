@@ -0,0 +1,118 @@
+#include "QuantizedVbo.h"
+
+void QuantizedVbo::upload(const QuantizedMesh &mesh) {
+	numVertices = mesh.numVertices();
+	if (numVertices == 0) return;
+	bNormals = mesh.normals.size() == numVertices;
+	const QuantizedPositions &p = mesh.positions;
+	Vector3 c = p.center, s = p.step;
+	decode = glm::scale(glm::translate(glm::mat4(1.0), glm::vec3(c.x(), c.y(), c.z())), glm::vec3(s.x(), s.y(), s.z()));
+
+	bFloat = ofIsGLProgrammableRenderer();
+	if (bFloat) {
+		vector<glm::vec3> vertexData(numVertices), normalData(bNormals ? numVertices : 0);
+		for (int i = 0; i < numVertices; i++) {
+			Vector3 v = p[i];
+			vertexData[i] = glm::vec3(v.x(), v.y(), v.z());
+		}
+		for (int i = 0; i < normalData.size(); i++) {
+			Vector3 n = mesh.normal(i);
+			normalData[i] = glm::vec3(n.x(), n.y(), n.z());
+		}
+		vector<ofIndexType> indexData(mesh.numIndices());
+		for (int i = 0; i < indexData.size(); i++)
+			indexData[i] = mesh.index(i);
+		floatVbo.setVertexData(&vertexData[0], numVertices, GL_STATIC_DRAW);
+		if (bNormals) floatVbo.setNormalData(&normalData[0], numVertices, GL_STATIC_DRAW);
+		if (!indexData.empty()) floatVbo.setIndexData(&indexData[0], (int)indexData.size(), GL_STATIC_DRAW);
+		gpuBytes = numVertices * sizeof(glm::vec3) * (bNormals ? 2 : 1) + indexData.size() * sizeof(ofIndexType);
+		return;
+	}
+
+	positions.allocate(p.data.size() * sizeof(short), p.data.data(), GL_STATIC_DRAW);
+	gpuBytes = p.data.size() * sizeof(short);
+
+	// the decode scale S acts on normals as S^-1, so send S n
+	//
+	if (bNormals) {
+		vector<signed char> normalData(4 * numVertices);
+		for (int i = 0; i < numVertices; i++) {
+			Vector3 n = mesh.normal(i);
+			n = Vector3(n.x() * s.x(), n.y() * s.y(), n.z() * s.z());
+			n.normalize();
+			for (int k = 0; k < 3; k++)
+				normalData[4 * i + k] = (signed char)roundf(n[k] * 127);
+			normalData[4 * i + 3] = 0;
+		}
+		normals.allocate(normalData.size(), normalData.data(), GL_STATIC_DRAW);
+		gpuBytes += normalData.size();
+	}
+
+	indexType = mesh.bWideIndices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+	indexSize = mesh.indexSize();
+	if (mesh.numIndices() > 0) {
+		indices.allocate((size_t)mesh.numIndices() * indexSize, mesh.indexData(), GL_STATIC_DRAW);
+		gpuBytes += (size_t)mesh.numIndices() * indexSize;
+	}
+}
+
+// GLES has only the programmable renderer, so only the float path
+//
+void QuantizedVbo::begin() {
+	if (bFloat) return;
+#ifndef TARGET_OPENGLES
+	ofPushMatrix();
+	ofMultMatrix(decode);
+	glBindBuffer(GL_ARRAY_BUFFER, positions.getId());
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_SHORT, 4 * sizeof(short), 0);
+	if (bNormals) {
+		glBindBuffer(GL_ARRAY_BUFFER, normals.getId());
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(GL_BYTE, 4, 0);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.getId());
+	bWasNormalizing = glIsEnabled(GL_NORMALIZE);
+	glEnable(GL_NORMALIZE);
+#endif
+}
+
+void QuantizedVbo::end() {
+	if (bFloat) return;
+#ifndef TARGET_OPENGLES
+	if (!bWasNormalizing) glDisable(GL_NORMALIZE);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (bNormals) glDisableClientState(GL_NORMAL_ARRAY);
+	ofPopMatrix();
+#endif
+}
+
+void QuantizedVbo::drawElements(int count, int firstIndex) {
+	if (count <= 0) return;
+	if (bFloat) floatVbo.drawElements(GL_TRIANGLES, count, firstIndex);
+	else glDrawElements(GL_TRIANGLES, count, indexType, (const void *)((size_t)firstIndex * indexSize));
+}
+
+void QuantizedVbo::multiDrawElements(const vector<GLsizei> &counts, const vector<int> &firstIndices) {
+	if (counts.empty()) return;
+#ifndef TARGET_OPENGLES
+	if (!bFloat) {
+		offsets.resize(firstIndices.size());
+		for (int i = 0; i < firstIndices.size(); i++)
+			offsets[i] = (const void *)((size_t)firstIndices[i] * indexSize);
+		glMultiDrawElements(GL_TRIANGLES, &counts[0], indexType, &offsets[0], (GLsizei)counts.size());
+		return;
+	}
+#endif
+	// no multi-draw: one draw per range
+	//
+	for (int i = 0; i < counts.size(); i++)
+		drawElements(counts[i], firstIndices[i]);
+}
+
+void QuantizedVbo::drawPoints() {
+	if (bFloat) floatVbo.draw(GL_POINTS, 0, numVertices);
+	else glDrawArrays(GL_POINTS, 0, numVertices);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+#include "QuantizedMesh.h"
+
+//  A QuantizedMesh on the GPU.  The positions and indices are uploaded as
+//  they are, 16 bit, and turned back into model space by a scale and
+//  translation pushed on the matrix stack in begin().  Normals go up as
+//  three bytes (the fixed function pipeline can't decode octahedral ones),
+//  pre-scaled so they come out right through that scale.
+//
+//  The fixed function renderer (the app's GL 2.1 window) reads the short
+//  attributes directly.  The programmable renderer's attribute setup in
+//  ofVbo is float only, so there the mesh is expanded to floats instead.
+//
+class QuantizedVbo {
+public:
+	void upload(const QuantizedMesh &mesh);
+	bool isAllocated() const { return numVertices > 0; }
+
+	// draw calls go between begin() and end().  firstIndex counts indices
+	//
+	void begin();
+	void end();
+	void drawElements(int count, int firstIndex);
+	void multiDrawElements(const std::vector<GLsizei> &counts, const std::vector<int> &firstIndices);
+	void drawPoints();
+
+	size_t bytes() const { return gpuBytes; }
+
+private:
+	int numVertices = 0;
+	bool bNormals = false;
+	glm::mat4 decode;
+	GLenum indexType = GL_UNSIGNED_SHORT;
+	int indexSize = 2;
+	size_t gpuBytes = 0;
+
+	ofBufferObject positions, normals, indices;
+	bool bWasNormalizing = false;
+	std::vector<const void *> offsets;
+
+	bool bFloat = false;                // programmable renderer
+	ofVbo floatVbo;
+};
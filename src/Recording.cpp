@@ -0,0 +1,348 @@
+#include "Recording.h"
+#include "ObjMesh.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+static const char recordingMagic[4] = { 'L', 'R', 'E', 'C' };
+static const unsigned int recordingVersion = 4;  // 2: pad radius, 3: quantized terrain heights, 4: terrain hash
+
+// sessions recorded before the terrain heights were quantized (version 3)
+// ran on slightly different ground, so they would replay as mismatches
+//
+static const unsigned int oldestReplayable = 3;
+
+void FinalState::capture(const Simulation &sim) {
+	position = sim.lander.position;
+	velocity = sim.lander.velocity;
+	rotation = sim.lander.rotation;
+	angularVelocity = sim.lander.angularVelocity;
+	fuel = sim.lander.fuel;
+	score = sim.score;
+	outcome = sim.outcome();
+	steps = sim.steps;
+}
+
+bool FinalState::operator==(const FinalState &s) const {
+	float a[10] = { position.x(), position.y(), position.z(), velocity.x(), velocity.y(), velocity.z(),
+		rotation, angularVelocity, fuel, score };
+	float b[10] = { s.position.x(), s.position.y(), s.position.z(), s.velocity.x(), s.velocity.y(), s.velocity.z(),
+		s.rotation, s.angularVelocity, s.fuel, s.score };
+	return memcmp(a, b, sizeof(a)) == 0 && outcome == s.outcome && steps == s.steps;
+}
+
+void FinalState::print() const {
+	printf("  steps %d  outcome %d  score %g  fuel %.9g\n", steps, outcome, score, fuel);
+	printf("  position (%.9g, %.9g, %.9g)  velocity (%.9g, %.9g, %.9g)\n",
+		position.x(), position.y(), position.z(), velocity.x(), velocity.y(), velocity.z());
+	printf("  rotation %.9g  angular velocity %.9g\n", rotation, angularVelocity);
+}
+
+// start recording a session from the simulation's current state, which
+// must be just after reset(): replay() only restores the pose.  the caller
+// seeds the simulation with seed.
+//
+void InputRecording::begin(const Simulation &sim, unsigned int s, float stepSize) {
+	seed = s;
+	dt = stepSize;
+	start = sim.lander.position;
+	rotation = sim.lander.rotation;
+	params = sim.params;
+	pads = sim.pads;
+	landerBounds = sim.landerBounds;
+	terrainHash = sim.terrainOctree() ? sim.terrainOctree()->hash : 0;
+	runs.clear();
+	final = FinalState();
+	bRecording = true;
+	bFinished = false;
+}
+
+// controls for the next step
+//
+void InputRecording::record(int controls) {
+	if (!bRecording) return;
+	if (runs.empty() || runs.back().controls != controls || runs.back().count == 0xffffffff) {
+		InputRun r;
+		r.controls = (unsigned char)controls;
+		runs.push_back(r);
+	}
+	runs.back().count++;
+}
+
+void InputRecording::finish(const Simulation &sim) {
+	if (!bRecording) return;
+	final.capture(sim);
+	bRecording = false;
+	bFinished = true;
+}
+
+int InputRecording::numSteps() const {
+	int n = 0;
+	for (int i = 0; i < runs.size(); i++)
+		n += runs[i].count;
+	return n;
+}
+
+// binary I/O.  floats are stored as their bit patterns so the round trip is
+// exact; counts are LEB128 varints.
+//
+static void writeU32(ofstream &out, unsigned int v) {
+	unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+	out.write((const char *)b, 4);
+}
+
+static void writeFloat(ofstream &out, float f) {
+	unsigned int v;
+	memcpy(&v, &f, 4);
+	writeU32(out, v);
+}
+
+static void writeVector(ofstream &out, const Vector3 &v) {
+	writeFloat(out, v.x());
+	writeFloat(out, v.y());
+	writeFloat(out, v.z());
+}
+
+static void writeVarint(ofstream &out, unsigned int v) {
+	while (v >= 0x80) {
+		out.put((char)(v | 0x80));
+		v >>= 7;
+	}
+	out.put((char)v);
+}
+
+static bool readU32(ifstream &in, unsigned int &v) {
+	unsigned char b[4];
+	if (!in.read((char *)b, 4)) return false;
+	v = b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+	return true;
+}
+
+static bool readFloat(ifstream &in, float &f) {
+	unsigned int v;
+	if (!readU32(in, v)) return false;
+	memcpy(&f, &v, 4);
+	return true;
+}
+
+static bool readVector(ifstream &in, Vector3 &v) {
+	float x, y, z;
+	if (!readFloat(in, x) || !readFloat(in, y) || !readFloat(in, z)) return false;
+	v = Vector3(x, y, z);
+	return true;
+}
+
+static bool readVarint(ifstream &in, unsigned int &v) {
+	v = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		int c = in.get();
+		if (c == EOF) return false;
+		v |= (unsigned int)(c & 0x7f) << shift;
+		if (!(c & 0x80)) return true;
+	}
+	return false;
+}
+
+static void writeParams(ofstream &out, const LanderParams &p) {
+	writeVector(out, p.thrustForce);
+	writeVector(out, p.downwardForce);
+	writeFloat(out, p.moveForce);
+	writeFloat(out, p.angularForces);
+	writeFloat(out, p.damping);
+	writeFloat(out, p.gravity);
+	writeFloat(out, p.crashSpeed);
+	writeFloat(out, p.fuel);
+	writeFloat(out, p.landingAreaRadius);
+	writeFloat(out, p.landerHalfLength);
+}
+
+static bool readParams(ifstream &in, LanderParams &p) {
+	return readVector(in, p.thrustForce) && readVector(in, p.downwardForce) &&
+		readFloat(in, p.moveForce) && readFloat(in, p.angularForces) &&
+		readFloat(in, p.damping) && readFloat(in, p.gravity) &&
+		readFloat(in, p.crashSpeed) && readFloat(in, p.fuel) &&
+		readFloat(in, p.landingAreaRadius) && readFloat(in, p.landerHalfLength);
+}
+
+static void writeFinal(ofstream &out, const FinalState &s) {
+	writeVector(out, s.position);
+	writeVector(out, s.velocity);
+	writeFloat(out, s.rotation);
+	writeFloat(out, s.angularVelocity);
+	writeFloat(out, s.fuel);
+	writeFloat(out, s.score);
+	writeU32(out, s.outcome);
+	writeU32(out, s.steps);
+}
+
+static bool readFinal(ifstream &in, FinalState &s) {
+	unsigned int outcome, steps;
+	if (!(readVector(in, s.position) && readVector(in, s.velocity) &&
+		readFloat(in, s.rotation) && readFloat(in, s.angularVelocity) &&
+		readFloat(in, s.fuel) && readFloat(in, s.score) &&
+		readU32(in, outcome) && readU32(in, steps)))
+		return false;
+	s.outcome = outcome;
+	s.steps = steps;
+	return true;
+}
+
+bool InputRecording::save(const string &path) const {
+	ofstream out(path, ios::binary);
+	if (!out) {
+		cout << "InputRecording: can't write " << path << endl;
+		return false;
+	}
+	out.write(recordingMagic, 4);
+	writeU32(out, recordingVersion);
+	writeU32(out, seed);
+	writeFloat(out, dt);
+	writeVector(out, start);
+	writeFloat(out, rotation);
+	writeParams(out, params);
+	writeVector(out, landerBounds.min());
+	writeVector(out, landerBounds.max());
+	writeU32(out, (unsigned int)terrainHash);
+	writeU32(out, (unsigned int)(terrainHash >> 32));
+	writeU32(out, pads.size());
+	for (int i = 0; i < pads.size(); i++) {
+		writeVector(out, pads[i].position);
+		writeFloat(out, pads[i].score);
+		writeFloat(out, pads[i].radius);
+	}
+	writeFinal(out, final);
+
+	writeU32(out, runs.size());
+	for (int i = 0; i < runs.size(); i++) {
+		out.put((char)runs[i].controls);
+		writeVarint(out, runs[i].count);
+	}
+	return (bool)out;
+}
+
+bool InputRecording::load(const string &path) {
+	ifstream in(path, ios::binary);
+	char magic[4];
+	unsigned int version, n;
+	if (!in || !in.read(magic, 4) || memcmp(magic, recordingMagic, 4) != 0 ||
+		!readU32(in, version) || version < 1 || version > recordingVersion) {
+		cout << "InputRecording: " << path << " is not a session recording" << endl;
+		return false;
+	}
+	if (version < oldestReplayable) {
+		cout << "InputRecording: " << path << " is version " << version << ", recorded before the terrain heights were "
+			"quantized; it can't replay on this terrain (version " << oldestReplayable << " or later needed)" << endl;
+		return false;
+	}
+
+	Vector3 lo, hi;
+	unsigned int hashLo = 0, hashHi = 0;
+	bool ok = readU32(in, seed) && readFloat(in, dt) && readVector(in, start) &&
+		readFloat(in, rotation) && readParams(in, params) &&
+		readVector(in, lo) && readVector(in, hi) &&
+		(version < 4 || (readU32(in, hashLo) && readU32(in, hashHi))) && readU32(in, n);
+	landerBounds = Box(lo, hi);
+	terrainHash = hashLo | ((unsigned long long)hashHi << 32);
+	pads.clear();
+	for (unsigned int i = 0; ok && i < n; i++) {
+		LandingPad pad;
+		ok = readVector(in, pad.position) && readFloat(in, pad.score) && readFloat(in, pad.radius);
+		pads.push_back(pad);
+	}
+	ok = ok && readFinal(in, final) && readU32(in, n);
+
+	runs.clear();
+	for (unsigned int i = 0; ok && i < n; i++) {
+		InputRun r;
+		int c = in.get();
+		ok = c != EOF && readVarint(in, r.count);
+		r.controls = (unsigned char)c;
+		runs.push_back(r);
+	}
+	if (!ok) {
+		cout << "InputRecording: " << path << " is truncated" << endl;
+		return false;
+	}
+	bRecording = false;
+	bFinished = true;
+	return true;
+}
+
+ReplayResult replay(const InputRecording &rec, const Octree *terrain, Simulation &sim) {
+	auto t0 = chrono::steady_clock::now();
+
+	sim.params = rec.params;
+	sim.pads = rec.pads;
+	sim.landerBounds = rec.landerBounds;
+	sim.setTerrain(terrain);
+	sim.reset(rec.start, rec.rotation);
+	sim.seed(rec.seed);
+
+	for (int i = 0; i < rec.runs.size(); i++) {
+		sim.lander.controls = rec.runs[i].controls;
+		for (unsigned int j = 0; j < rec.runs[i].count; j++)
+			sim.step(rec.dt);
+	}
+
+	ReplayResult r;
+	r.final.capture(sim);
+	r.bMatch = r.final == rec.final;
+	r.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+	return r;
+}
+
+// --replay <terrain.obj> <session> [repeat]
+//
+int runReplayMain(int argc, char *argv[]) {
+	if (argc < 4) {
+		cout << "usage: " << argv[0] << " --replay <terrain.obj> <session> [repeat]" << endl;
+		return 1;
+	}
+
+	ObjMesh terrainMesh;
+	if (!terrainMesh.load(argv[2])) return 1;
+	Octree octree;
+	octree.create(terrainMesh.vertices, 20);
+
+	InputRecording rec;
+	if (!rec.load(argv[3])) return 1;
+	if (!rec.matchesTerrain(octree)) {
+		printf("%s was recorded on other terrain than %s (terrain hash %016llx, this one is %016llx)\n",
+			argv[3], argv[2], rec.terrainHash, octree.hash);
+		return 1;
+	}
+	int repeat = argc > 4 ? max(1, atoi(argv[4])) : 1;
+
+	// repeated replays double as a benchmark; every one must match
+	//
+	Simulation sim;
+	ReplayResult r;
+	double best = 1e30, total = 0;
+	bool match = true;
+	for (int i = 0; i < repeat; i++) {
+		r = replay(rec, &octree, sim);
+		match = match && r.bMatch;
+		best = min(best, r.seconds);
+		total += r.seconds;
+	}
+
+	int steps = rec.numSteps();
+	printf("%s: %d steps (%.1fs of play), %d input runs, seed %u\n",
+		argv[3], steps, steps * rec.dt, (int)rec.runs.size(), rec.seed);
+	printf("replay x%d: best %.3f ms, avg %.3f ms (%.0f steps/s)\n",
+		repeat, best * 1000, total / repeat * 1000, steps / max(best, 1e-9));
+	if (match) {
+		printf("final state matches\n");
+		return 0;
+	}
+	printf("FINAL STATE MISMATCH\nrecorded:\n");
+	rec.final.print();
+	printf("replayed:\n");
+	r.final.print();
+	return 2;
+}
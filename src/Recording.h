@@ -0,0 +1,85 @@
+#pragma once
+
+//  Session recording and replay.  A session is everything needed to re-run
+//  a game bit for bit on the headless Simulation: the RNG seed, the step
+//  size, the start pose, the parameters, pads and lander bounds, and the
+//  controls held each step (run-length encoded).  The final state is stored
+//  too, so a replay can check that it ends in exactly the same place, and a
+//  hash of the terrain, so a replay on other ground is refused.  Only games
+//  on a single terrain octree are recorded: what streaming terrain collides
+//  with depends on when its tiles finish loading.
+//
+#include <string>
+#include <vector>
+#include "Simulation.h"
+
+// simulation state compared at the end of a replay
+//
+class FinalState {
+public:
+	void capture(const Simulation &sim);
+	bool operator==(const FinalState &s) const;     // bitwise
+	bool operator!=(const FinalState &s) const { return !(*this == s); }
+	void print() const;
+
+	Vector3 position;
+	Vector3 velocity;
+	float rotation = 0;
+	float angularVelocity = 0;
+	float fuel = 0;
+	float score = 0;
+	int outcome = SimRunning;
+	int steps = 0;
+};
+
+// controls held for count consecutive steps
+//
+class InputRun {
+public:
+	unsigned char controls = 0;
+	unsigned int count = 0;
+};
+
+class InputRecording {
+public:
+	void begin(const Simulation &sim, unsigned int seed, float dt);
+	void record(int controls);
+	void finish(const Simulation &sim);
+	void cancel() { bRecording = false; }
+	int numSteps() const;
+
+	bool save(const std::string &path) const;
+	bool load(const std::string &path);
+	bool matchesTerrain(const Octree &terrain) const { return terrainHash == 0 || terrainHash == terrain.hash; }
+
+	unsigned int seed = 0;
+	float dt = 1.0 / 240;
+	Vector3 start;
+	float rotation = 0;
+	LanderParams params;
+	std::vector<LandingPad> pads;
+	Box landerBounds;
+	unsigned long long terrainHash = 0;     // Octree::hash; 0 if unknown (version 3)
+
+	std::vector<InputRun> runs;
+	FinalState final;
+	bool bRecording = false;
+	bool bFinished = false;
+};
+
+class ReplayResult {
+public:
+	FinalState final;
+	bool bMatch = false;
+	double seconds = 0;
+};
+
+// re-simulate a recording on sim as fast as possible.  the terrain should
+// be the one it was recorded on (see matchesTerrain())
+//
+ReplayResult replay(const InputRecording &rec, const Octree *terrain, Simulation &sim);
+
+// entry point for "--replay <terrain.obj> <session> [repeat]"; returns the process exit code
+// (0 when every replay matches the recorded final state)
+//
+int runReplayMain(int argc, char *argv[]);
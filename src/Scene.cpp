@@ -0,0 +1,148 @@
+#include "Scene.h"
+
+Scene::Scene() {
+	attach(&transforms);
+	attach(&poses);
+	attach(&follows);
+	attach(&models);
+	attach(&cameras);
+	attach(&lights);
+	attach(&emitters);
+}
+
+Entity Scene::addCamera() {
+	Entity e = create();
+	transforms.add(e);
+	cameras.add(e).camera.reset(new ofEasyCam());
+	return e;
+}
+
+Entity Scene::addLight() {
+	Entity e = create();
+	transforms.add(e);
+	lights.add(e).light.reset(new ofLight());
+	return e;
+}
+
+Entity Scene::addEmitter(ParticleEmitter *emitter) {
+	Entity e = create();
+	transforms.add(e);
+	emitters.add(e).emitter.reset(emitter);
+	return e;
+}
+
+Entity Scene::addLander(ObjModel *model) {
+	Entity e = create();
+	transforms.add(e);
+	poses.add(e);
+	if (model) models.add(e).model = model;
+	return e;
+}
+
+void Scene::follow(Entity e, Entity target, const ofVec3f &offset, bool bTurn) {
+	FollowComponent &f = follows.add(e);
+	f.target = target;
+	f.offset = offset;
+	f.bTurn = bTurn;
+}
+
+void Scene::setPose(Entity e, const LanderState &s) {
+	PoseComponent *pose = poses.get(e);
+	if (pose) {
+		pose->from = s;
+		pose->to = s;
+	}
+	TransformObject *t = transforms.get(e);
+	t->position = ofVec3f(s.position.x(), s.position.y(), s.position.z());
+	t->rotation = s.rotation;
+	ModelComponent *m = models.get(e);
+	if (m) {
+		m->model->setPosition(t->position.x, t->position.y, t->position.z);
+		m->model->setRotation(0, t->rotation, 0, 1, 0);
+	}
+}
+
+//--------------------------------------------------------------
+// systems
+
+void Scene::updatePoses(float alpha) {
+	for (int i = 0; i < poses.size(); i++) {
+		const PoseComponent &p = poses[i];
+		TransformObject *t = transforms.get(poses.entity(i));
+		Vector3 position = p.from.position + (p.to.position - p.from.position) * alpha;
+		t->position = ofVec3f(position.x(), position.y(), position.z());
+		t->rotation = ofLerp(p.from.rotation, p.to.rotation, alpha);
+	}
+}
+
+void Scene::updateFollows() {
+	for (int i = 0; i < follows.size(); i++) {
+		const FollowComponent &f = follows[i];
+		const TransformObject *target = transforms.get(f.target);
+		if (!target) continue;
+		TransformObject *t = transforms.get(follows.entity(i));
+		ofVec3f offset = f.offset;
+		if (f.bTurn) {
+			float a = ofDegToRad(target->rotation);
+			offset = ofVec3f(f.offset.x * cos(a) + f.offset.z * sin(a), f.offset.y, f.offset.z * cos(a) - f.offset.x * sin(a));
+			t->rotation = target->rotation;
+		}
+		t->position = target->position + offset;
+	}
+}
+
+void Scene::updateModels() {
+	for (int i = 0; i < models.size(); i++) {
+		const TransformObject *t = transforms.get(models.entity(i));
+		ObjModel *model = models[i].model;
+		model->setPosition(t->position.x, t->position.y, t->position.z);
+		model->setRotation(0, t->rotation, 0, 1, 0);
+	}
+}
+
+void Scene::updateCameras() {
+	for (int i = 0; i < cameras.size(); i++) {
+		CameraComponent &c = cameras[i];
+		if (!c.bFollow) continue;
+		const TransformObject *t = transforms.get(cameras.entity(i));
+		if (c.bLookAt) {
+			c.camera->setTarget(t->position);
+		}
+		else {
+			c.camera->setPosition(t->position);
+			c.camera->setOrientation(ofVec3f(c.pitch, t->rotation, 0));
+		}
+	}
+}
+
+// enabling a light is a GL call, so this runs on the main thread
+//
+void Scene::updateLights() {
+	for (int i = 0; i < lights.size(); i++) {
+		LightComponent &l = lights[i];
+		if (l.bFollow) {
+			const TransformObject *t = transforms.get(lights.entity(i));
+			l.light->setPosition(t->position);
+			if (l.bTurn) {
+				l.light->rotate(t->rotation - l.heading, 0, 1, 0);
+				l.heading = t->rotation;
+			}
+		}
+		if (l.bOn != l.light->getIsEnabled()) {
+			if (l.bOn) l.light->enable();
+			else l.light->disable();
+		}
+	}
+}
+
+// emitters sharing a particle system spawn into it one after the other;
+// analytic emitters each have their own store
+//
+void Scene::updateEmitters(bool bAnalytic) {
+	for (int i = 0; i < emitters.size(); i++) {
+		ParticleEmitter *emitter = emitters[i].emitter.get();
+		if (emitter->bAnalytic != bAnalytic) continue;
+		emitter->position = transforms.get(emitters.entity(i))->position;
+		emitter->update();
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ofMain.h"
+#include <memory>
+#include "EntityStore.h"
+#include "TransformObject.h"
+#include "ParticleEmitter.h"
+#include "ObjModel.h"
+#include "Simulation.h"
+
+//  Scene objects as entities with components in dense arrays (EntityStore.h),
+//  updated by systems that each loop over one array:
+//
+//    updatePoses     simulated lander poses -> transforms (interpolated)
+//    updateFollows   transforms placed relative to another entity's
+//    updateModels    transforms -> models
+//    updateCameras   transforms -> cameras that follow
+//    updateLights    transforms -> lights that follow; on/off switches
+//    updateEmitters  transforms -> emitter positions, then spawn
+//
+//  in that order each frame.  Cameras, lights and emitters are owned by
+//  their components (oF objects hold pointers to themselves, so they are
+//  kept out of the moving arrays).
+//
+
+// the two simulated poses the transform is drawn between
+//
+class PoseComponent {
+public:
+	LanderState from, to;
+};
+
+// place the transform at target's position plus offset.  with bTurn the
+// offset turns with the target's heading (rotation about y) and the
+// heading is copied.  targets are not followers themselves
+//
+class FollowComponent {
+public:
+	Entity target = NoEntity;
+	ofVec3f offset = ofVec3f(0, 0, 0);
+	bool bTurn = false;
+};
+
+class ModelComponent {
+public:
+	ObjModel *model = nullptr;      // not owned (the model also draws)
+};
+
+// a camera that follows looks at its transform (bLookAt, for an easy cam
+// orbiting it) or sits there facing the transform's heading, pitched
+//
+class CameraComponent {
+public:
+	std::unique_ptr<ofEasyCam> camera;
+	bool bFollow = false;
+	bool bLookAt = false;
+	float pitch = 0;
+};
+
+// a light that follows moves with its transform and, with bTurn, turns
+// with the heading from the orientation it was set up with
+//
+class LightComponent {
+public:
+	std::unique_ptr<ofLight> light;
+	bool bFollow = false;
+	bool bTurn = false;
+	bool bOn = true;
+	float heading = 0;              // turned so far
+};
+
+class EmitterComponent {
+public:
+	std::unique_ptr<ParticleEmitter> emitter;
+};
+
+class Scene : public EntityStore {
+public:
+	Scene();
+
+	// an entity with a transform and the given object
+	//
+	Entity addCamera();
+	Entity addLight();
+	Entity addEmitter(ParticleEmitter *emitter);
+	Entity addLander(ObjModel *model);
+
+	ofEasyCam &camera(Entity e) { return *cameras.get(e)->camera; }
+	ofLight &light(Entity e) { return *lights.get(e)->light; }
+	ParticleEmitter &emitter(Entity e) { return *emitters.get(e)->emitter; }
+	TransformObject &transform(Entity e) { return *transforms.get(e); }
+	void follow(Entity e, Entity target, const ofVec3f &offset, bool bTurn = false);
+
+	// put a lander exactly at a simulated pose now (reset, drag)
+	//
+	void setPose(Entity e, const LanderState &s);
+
+	void updatePoses(float alpha);
+	void updateFollows();
+	void updateModels();
+	void updateCameras();
+	void updateLights();
+	void updateEmitters(bool bAnalytic);    // the analytic ones, or those of shared systems
+
+	ComponentArray<TransformObject> transforms;
+	ComponentArray<PoseComponent> poses;
+	ComponentArray<FollowComponent> follows;
+	ComponentArray<ModelComponent> models;
+	ComponentArray<CameraComponent> cameras;
+	ComponentArray<LightComponent> lights;
+	ComponentArray<EmitterComponent> emitters;
+};
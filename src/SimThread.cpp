@@ -0,0 +1,170 @@
+#include "SimThread.h"
+#include "Profiler.h"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+double SimThread::now() {
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SimThread::start() {
+	if (isRunning()) return;
+	bQuit = false;
+	worker = thread(&SimThread::run, this);
+}
+
+void SimThread::stop() {
+	if (!isRunning()) return;
+	bQuit = true;
+	worker.join();
+}
+
+void SimThread::run() {
+	Profiler::shared().setThreadName("sim");
+	while (!bQuit) {
+		pump();
+		double wait = nextTick - now();
+		if (wait > 0)
+			this_thread::sleep_for(chrono::duration<double>(wait));
+	}
+}
+
+// every tick that is due by now, but no more than maxLag worth
+//
+void SimThread::pump() {
+	double t = now();
+	if (nextTick == 0 || t - nextTick > maxLag)
+		nextTick = t - (nextTick == 0 ? 0 : maxLag);
+	while (nextTick <= t) {
+		tick(nextTick);
+		nextTick += 1.0 / rate;
+	}
+}
+
+bool SimThread::post(const SimEvent &e) {
+	if (events.push(e)) return true;
+	cout << "SimThread: event queue full, event " << e.type << " dropped" << endl;
+	return false;
+}
+
+const SimSnapshot &SimThread::snapshot() {
+	snapshots.update();
+	return snapshots.front();
+}
+
+bool SimThread::takeSession(InputRecording &rec) {
+	return sessions.pop(rec);
+}
+
+//--------------------------------------------------------------
+// sim thread
+
+int SimThread::controls() const {
+	int c = 0;
+	for (int i = 0; i < 8; i++)
+		if (held[i] > 0) c |= 1 << i;
+	return c;
+}
+
+void SimThread::apply(const SimEvent &e) {
+	switch (e.type) {
+	case SimControlDown:
+	case SimControlUp:
+		for (int i = 0; i < 8; i++) {
+			if (!(e.control & (1 << i))) continue;
+			if (e.type == SimControlDown) held[i]++;
+			else if (held[i] > 0) held[i]--;
+		}
+		break;
+	case SimStartGame:
+		//from where the lander is, with the rest of the state fresh: a game
+		//started from the end screen would otherwise begin finished, and the
+		//recording couldn't replay it (replay() starts from a reset)
+		sim.reset(sim.lander.position, sim.lander.rotation);
+		sim.seed(e.seed);
+		if (!tiles)
+			recording.begin(sim, e.seed, 1.0 / rate);
+		else
+			cout << "streaming terrain, session not recorded (it wouldn't replay the same)" << endl;
+		game = e.game;
+		bPlaying = true;
+		break;
+	case SimResetGame:
+		endSession();   //a game quit part way is still a valid session
+		sim.reset(e.position);
+		bPlaying = false;
+		break;
+	case SimHold:
+		bHeld = true;
+		break;
+	case SimRelease:
+		bHeld = false;
+		break;
+	case SimMoveTo:
+		sim.lander.position = e.position;
+		if (bPlaying && recording.bRecording) {
+			cout << "lander moved by mouse, session not recorded" << endl;
+			recording.cancel();
+		}
+		break;
+	}
+}
+
+// hand the recording of the game over to the main thread
+//
+void SimThread::endSession() {
+	if (!recording.bRecording) return;
+	recording.finish(sim);
+	if (!sessions.push(recording))
+		cout << "SimThread: session queue full, session dropped" << endl;
+}
+
+// one fixed step at the scheduled time, then publish the result
+//
+void SimThread::tick(double time) {
+	ProfileScope scope("sim tick");
+	SimEvent e;
+	while (events.pop(e))
+		apply(e);
+
+	if (tiles && state.ticks % tileTicks == 0) {
+		tiles->update(sim.lander.position);
+		if (tiles->residentVersion() != tilesVersion) {
+			tilesVersion = tiles->residentVersion();
+			state.tiles.clear();
+			for (auto &t : tiles->residentTiles())
+				if (!t.second->bEmpty) state.tiles.push_back(t.second);
+		}
+	}
+
+	state.previous = sim.lander;
+	if (bPlaying && !bHeld) {
+		sim.lander.controls = controls();
+		recording.record(sim.lander.controls);
+		sim.step(1.0 / rate);
+		if (sim.lander.thrusting) state.thrustTicks++;
+		if (sim.bContact) {
+			state.contacts++;
+			if (sim.bCrash) state.crashes++;
+		}
+		if (sim.finished()) {
+			endSession();
+			bPlaying = false;
+		}
+	}
+	state.ticks++;
+
+	state.lander = sim.lander;
+	state.time = time;
+	state.altitude = sim.altitude;
+	state.bAltitude = sim.bAltitude;
+	state.score = sim.score;
+	state.outcome = sim.outcome();
+	state.game = game;
+	state.bPlaying = bPlaying;
+	sim.padIndex.nearest(sim.lander.position.x(), sim.lander.position.z(), numGuidePads, state.guidePads, guideScratch);
+	snapshots.back() = state;
+	snapshots.publish();
+}
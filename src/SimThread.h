@@ -0,0 +1,127 @@
+#pragma once
+
+//  The Simulation on its own thread at a fixed tick, so a slow draw() or a
+//  GPU stall no longer slows the physics or delays the controls.  The main
+//  thread only talks to it through lock free handoffs:
+//    - post() queues control changes and game commands (SpscQueue)
+//    - snapshot() is the state after the latest tick (TripleBuffer): the last
+//      two lander poses for interpolation, the HUD values, and running counts
+//      of effect events so none is missed between frames
+//    - takeSession() returns recordings of finished games, for saving
+//  With streaming terrain the thread also updates the tiles around the
+//  lander (they are queried here), and the snapshot carries the resident
+//  tiles for drawing.
+//
+//  Nothing here depends on openFrameworks.
+//
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "Simulation.h"
+#include "Recording.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+enum SimEventType {
+	SimControlDown,     // control: the LanderControl bit of a key that went down
+	SimControlUp,       //          or came up
+	SimStartGame,       // seed, game: start recording and stepping
+	SimResetGame,       // position: put the lander back; ends (and hands over) the session
+	SimHold,            // stop stepping while the mouse holds the lander
+	SimRelease,
+	SimMoveTo           // position: teleport the lander (a recording can't replay this)
+};
+
+class SimEvent {
+public:
+	SimEvent() { }
+	SimEvent(int type, int control = 0) : type(type), control(control) { }
+	SimEvent(int type, const Vector3 &position) : type(type), position(position) { }
+
+	int type = SimControlDown;
+	int control = 0;
+	unsigned int seed = 0;
+	int game = 0;
+	Vector3 position = Vector3(0, 0, 0);
+};
+
+// state after a tick.  the counts only grow, so the reader compares them
+// with the previous snapshot it saw
+//
+class SimSnapshot {
+public:
+	LanderState lander;             // after the latest tick
+	LanderState previous;           // before it
+	double time = 0;                // when the latest tick was due (SimThread::now())
+	float altitude = -1;
+	bool bAltitude = false;
+	float score = 0;
+	int outcome = SimRunning;
+	int game = 0;                   // of the SimStartGame being played (0 before the first)
+	bool bPlaying = false;
+
+	long long ticks = 0;            // since the thread started, playing or not
+	long long thrustTicks = 0;      // steps with the thrust on
+	long long contacts = 0;         // new contacts with the terrain
+	long long crashes = 0;
+
+	std::vector<int> guidePads;     // nearest pads, nearest first
+
+	// resident streaming terrain tiles (SimThread::tiles), shared so an
+	// evicted tile stays alive while it is drawn
+	//
+	std::vector<std::shared_ptr<const TerrainTile>> tiles;
+};
+
+class SimThread {
+public:
+	~SimThread() { stop(); }
+
+	void start();
+	void stop();
+	bool isRunning() const { return worker.joinable(); }
+
+	// main thread side
+	//
+	bool post(const SimEvent &e);
+	const SimSnapshot &snapshot();
+	bool takeSession(InputRecording &rec);
+
+	static double now();            // seconds, steady clock
+
+	// set up before start(); after that the thread owns it
+	//
+	Simulation sim;
+	TiledTerrain *tiles = nullptr;  // streaming terrain, when sim queries it
+	float rate = 240;               // ticks per second
+	float maxLag = 0.25;            // sec; when further behind, the ticks in excess are dropped
+	int tileTicks = 8;              // ticks between updates of the streaming terrain
+	int numGuidePads = 3;
+
+private:
+	void run();
+	void pump();
+	void tick(double time);
+	void apply(const SimEvent &e);
+	void endSession();
+	int controls() const;
+
+	SpscQueue<SimEvent, 256> events;
+	TripleBuffer<SimSnapshot> snapshots;
+	SpscQueue<InputRecording, 8> sessions;
+
+	// sim thread state
+	//
+	InputRecording recording;
+	int tilesVersion = -1;
+	std::vector<std::pair<float, int>> guideScratch;    // for PadIndex::nearest
+	int held[8] = { };              // keys down for each control bit
+	bool bPlaying = false;
+	bool bHeld = false;
+	int game = 0;
+	double nextTick = 0;
+	SimSnapshot state;
+
+	std::thread worker;
+	std::atomic<bool> bQuit{false};
+};
@@ -0,0 +1,232 @@
+#include "Simulation.h"
+#include "Profiler.h"
+#include <math.h>
+
+using namespace std;
+
+static float degToRad(float d) {
+	return d * 3.14159265358979f / 180.0f;
+}
+
+Simulation::Simulation() {
+	landerBounds = Box(Vector3(-1, 0, -1), Vector3(1, 2, 1));
+	lander.fuel = params.fuel;
+}
+
+// put the lander back at the start of a new episode
+//
+void Simulation::reset(const Vector3 &start, float rotation) {
+	Vector3 p = start;              //start may be lander.position
+	lander = LanderState();
+	lander.position = p;
+	lander.rotation = rotation;
+	lander.fuel = params.fuel;
+	padIndex.build(pads, params.landingAreaRadius);
+
+	altitude = -1;
+	bAltitude = false;
+	bCollide = false;
+	clipped = false;
+	bCrash = false;
+	bLanding = false;
+	bFuelOut = false;
+	bContact = false;
+	score = 0;
+	landedPad = -1;
+	steps = 0;
+	colBoxList.clear();
+}
+
+SimOutcome Simulation::outcome() const {
+	if (bCrash) return SimCrashed;
+	if (bLanding) return SimLanded;
+	if (bCollide && bFuelOut) return SimFuelOut;
+	return SimRunning;
+}
+
+// world space bounds of the lander
+//
+Box Simulation::bounds() const {
+	return Box(landerBounds.min() + lander.position, landerBounds.max() + lander.position);
+}
+
+//return the header for forward and backward movement using trig
+Vector3 Simulation::header(float rotation) {
+	Vector3 d = Vector3(sin(degToRad(rotation + 180)), 0, cos(degToRad(rotation + 180)));
+	d.normalize();
+	return d;
+}
+
+//return the header for leftward and rightward movement using trig
+Vector3 Simulation::leftRightHeader(float rotation) {
+	Vector3 d = Vector3(sin(degToRad(rotation - 90)), 0, cos(degToRad(rotation - 90)));
+	d.normalize();
+	return d;
+}
+
+// one fixed step: controls, forces, altitude, collision, integration and fuel
+//
+void Simulation::step(float dt) {
+	if (finished()) return;
+	steps++;
+
+	//thrust only while there is fuel left
+	lander.thrusting = false;
+	if (lander.controls & ThrustUp) {
+		if (lander.fuel > 0) {
+			lander.thrusting = true;
+		}
+		else {
+			lander.fuel = 0;
+			bFuelOut = true;
+		}
+	}
+
+	//update the gravity and the turblence forces
+	lander.acceleration = Vector3(0, params.gravity, 0);
+	float tx = random(-0.13, 0.13); //drawn in a fixed order so replays match across compilers
+	float ty = random(-0.01, 0.01);
+	float tz = random(-0.13, 0.13);
+	lander.turbForce += Vector3(tx, ty, tz);
+
+	//check and update the altitude between the lander and the terrain, and
+	//check if lander collide with the terrain, then react to it
+	rayAltitudeSensor();
+	checkCollide();
+	applyCollide();
+
+	integrate(dt);
+
+	//calculating the ramaining fuel time
+	if (lander.thrusting) {
+		lander.fuel -= dt;
+	}
+}
+
+/*
+* Move and rotate the lander based on physics
+*/
+void Simulation::integrate(float dt) {
+	int c = lander.controls;
+
+	Vector3 accel = lander.acceleration;
+
+	//lander thrust up or move down
+	if (lander.thrusting)
+		accel += params.thrustForce;
+	if (c & MoveDown)
+		accel += params.downwardForce;
+
+	//lander forward, backward, left and right movement
+	if (c & MoveForward)
+		accel += header() * params.moveForce;
+	else if (c & MoveBackward)
+		accel -= header() * params.moveForce;
+	else if (c & MoveLeft)
+		accel += leftRightHeader() * params.moveForce;
+	else if (c & MoveRight)
+		accel -= leftRightHeader() * params.moveForce;
+
+	accel += lander.turbForce; //add turblence force
+
+	//lander rotation
+	float a = lander.angularAcceleration;
+	if (c & RotateLeft)
+		a += params.angularForces;
+	if (c & RotateRight)
+		a -= params.angularForces;
+
+	//damping is tuned per 1/60 sec; the integrator scales it to the step
+	LanderIntegrator::step(lander.position, lander.velocity, accel, params.damping, dt);
+	LanderIntegrator::step(lander.rotation, lander.angularVelocity, a, params.damping, dt);
+
+	lander.turbForce = Vector3(0, 0, 0);
+}
+
+/*
+* using ray detection to the the altitude of the lander
+*/
+void Simulation::rayAltitudeSensor() {
+	ProfileScope scope("octree altitude");
+	bAltitude = false;
+	if (tiles) {
+		float ground;
+		bAltitude = tiles->groundHeight(lander.position, ground);
+		if (bAltitude)
+			altitude = lander.position.y() - ground;
+		return;
+	}
+	if (!terrain) return;
+
+	TreeNode altitudeNode;
+	Ray ray = Ray(lander.position, Vector3(0, -1, 0));
+	bAltitude = terrain->intersect(ray, terrain->root, altitudeNode);
+	if (bAltitude) {
+		altitude = lander.position.y() - terrain->vertices[altitudeNode.points[0]].y();
+	}
+}
+
+/*
+* check if the lander collide with the terrain using box-box intersect method of the octree
+*/
+void Simulation::checkCollide() {
+	ProfileScope scope("octree collide");
+	colBoxList.clear();
+	if (tiles)
+		bCollide = tiles->intersect(bounds(), colBoxList);
+	else
+		bCollide = terrain && terrain->intersect(bounds(), terrain->root, colBoxList);
+}
+
+/*
+* react to the collidesion between lander and the terrain
+*/
+void Simulation::applyCollide() {
+	bContact = false;
+	if (!bCollide) {
+		clipped = false;
+		return;
+	}
+
+	if (!clipped) {
+		bContact = true;
+
+		//check if the velocity during the collision is too large
+		Vector3 v = lander.velocity;
+		if (fabs(v.x()) > params.crashSpeed || fabs(v.y()) > params.crashSpeed || fabs(v.z()) > params.crashSpeed) {
+			bCrash = true;
+			score = 0;
+		}
+
+		//reverse velocity (bounce)
+		lander.velocity = lander.velocity * -0.5;
+		lander.acceleration = lander.acceleration * -6;
+
+		//anti clipping
+		if (lander.velocity.x() <= 0) {
+			lander.velocity[0] = 0.1;
+		}
+
+		checkLanding(); //check if the lander land in one of the lander areas
+	}
+	clipped = true; //for lander to not stuck in the terrain
+}
+
+/*
+* check if lander lands in any of the landing areas (the nearest, if it is
+* inside more than one)
+*/
+void Simulation::checkLanding() {
+	if (bCrash) return;
+	float distance;
+	int i = padIndex.padAt(lander.position.x(), lander.position.z(), &distance);
+	if (i >= 0) {
+		//full score if the lander landed perfectly in the landing area, half if slightly off
+		if (distance <= padIndex.radius(i) - params.landerHalfLength)
+			score = pads[i].score;
+		else
+			score = pads[i].score / 2;
+		landedPad = i;
+		bLanding = true;
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+//  Headless lander simulation: lander state and forces, terrain collision
+//  through the octree, landing checks, fuel and scoring.  No windowing or GL
+//  dependency (only vector3.h, box.h, ray.h and Octree), so it can run in
+//  tools, tests and benchmarks as well as under ofApp, which renders it.
+//
+#include <vector>
+#include <random>
+#include "Octree.h"
+#include "Integrator.h"
+#include "PadIndex.h"
+#include "TiledTerrain.h"
+
+// integration scheme for the lander (see Integrator.h).  LanderFleet and
+// recorded sessions assume ExplicitEuler
+//
+typedef ExplicitEuler LanderIntegrator;
+
+// lander inputs, one bit each (LanderState::controls)
+//
+enum LanderControl {
+	ThrustUp     = 1 << 0,
+	MoveDown     = 1 << 1,
+	MoveForward  = 1 << 2,
+	MoveBackward = 1 << 3,
+	MoveLeft     = 1 << 4,
+	MoveRight    = 1 << 5,
+	RotateLeft   = 1 << 6,
+	RotateRight  = 1 << 7
+};
+
+enum SimOutcome { SimRunning, SimCrashed, SimLanded, SimFuelOut };
+
+class LanderParams {
+public:
+	Vector3 thrustForce = Vector3(0, 2, 0);
+	Vector3 downwardForce = Vector3(0, -2, 0);
+	float moveForce = 3;
+	float angularForces = 12;
+	float damping = .99;            // per 1/60 sec
+	float gravity = -0.3;
+	float crashSpeed = 1.8;         // per axis, at contact
+	float fuel = 120;               // sec of thrust
+	float landingAreaRadius = 2.5;  // for pads without their own radius
+	float landerHalfLength = 1;
+};
+
+class LanderState {
+public:
+	Vector3 position = Vector3(0, 0, 0);
+	Vector3 velocity = Vector3(0, 0, 0);
+	Vector3 acceleration = Vector3(0, 0, 0);
+	Vector3 turbForce = Vector3(0, 0, 0);
+	float rotation = 0;             // degrees about y
+	float angularVelocity = 0;
+	float angularAcceleration = 0;
+	float fuel = 0;
+	int controls = 0;               // LanderControl bits held this step
+	bool thrusting = false;         // thrust was applied in the last step
+};
+
+// uniform random number in [min, max) from rng; the simulation's only
+// source of randomness, so a seed reproduces a run
+//
+inline float uniformRandom(std::mt19937 &rng, float min, float max) {
+	float u = (rng() >> 8) * (1.0f / 16777216.0f);
+	return min + (max - min) * u;
+}
+
+class Simulation {
+public:
+	Simulation();
+	void setTerrain(const Octree *t) { terrain = t; tiles = nullptr; }
+	void setTerrain(const TiledTerrain *t) { tiles = t; terrain = nullptr; }
+	const Octree *terrainOctree() const { return terrain; }
+	void seed(unsigned int s) { rng.seed(s); }
+	void reset(const Vector3 &start, float rotation = 0);
+	void step(float dt);
+	SimOutcome outcome() const;
+	bool finished() const { return outcome() != SimRunning; }
+
+	Box bounds() const;
+	Vector3 header() const { return header(lander.rotation); }
+	Vector3 leftRightHeader() const { return leftRightHeader(lander.rotation); }
+	float random(float min, float max) { return uniformRandom(rng, min, max); }
+
+	static Vector3 header(float rotation);
+	static Vector3 leftRightHeader(float rotation);
+
+	LanderParams params;
+	LanderState lander;
+	std::vector<LandingPad> pads;   // indexed into padIndex by reset()
+	PadIndex padIndex;
+	Box landerBounds;               // model space bounds of the lander
+
+	// sensors and game state
+	//
+	float altitude = -1;
+	bool bAltitude = false;
+	bool bCollide = false;
+	bool clipped = false;
+	bool bCrash = false;
+	bool bLanding = false;
+	bool bFuelOut = false;
+	bool bContact = false;          // a new contact with the terrain began this step
+	float score = 0;
+	int landedPad = -1;
+	int steps = 0;
+
+	// terrain boxes hit by the last collision check (for debug drawing)
+	//
+	std::vector<Box> colBoxList;
+
+private:
+	void integrate(float dt);
+	void rayAltitudeSensor();
+	void checkCollide();
+	void applyCollide();
+	void checkLanding();
+
+	const Octree *terrain = nullptr;
+	const TiledTerrain *tiles = nullptr;    // streaming terrain instead of one octree
+	std::mt19937 rng;
+};
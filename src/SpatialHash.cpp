@@ -0,0 +1,57 @@
+#include "SpatialHash.h"
+#include "Parallel.h"
+
+// build the hash over particles [first, first + count)
+//
+void SpatialHash::build(const vector<Particle> &particles, int first, int count, float size) {
+	cellSize = size;
+
+	// table size: next power of two at least twice the particle count
+	//
+	unsigned int tableSize = 64;
+	while (tableSize < 2 * (unsigned int)count) tableSize <<= 1;
+	mask = tableSize - 1;
+
+	keys.resize(count);
+	indices.resize(count);
+	cellStart.assign(tableSize + 1, 0);
+	if (count == 0) return;
+
+	// 1) bucket of every particle and bucket counts
+	//
+	if (countsSize < tableSize) {
+		counts.reset(new std::atomic<int>[tableSize]);
+		countsSize = tableSize;
+	}
+	for (int b = 0; b < tableSize; b++) counts[b].store(0, std::memory_order_relaxed);
+	parallelFor(count, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			const ofVec3f &p = particles[first + i].position;
+			keys[i] = bucket(cell(p.x), cell(p.y), cell(p.z));
+			counts[keys[i]].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// 2) bucket offsets
+	//
+	for (int b = 0; b < tableSize; b++)
+		cellStart[b + 1] = cellStart[b] + counts[b].load(std::memory_order_relaxed);
+
+	// 3) scatter indices into their buckets
+	//
+	for (int b = 0; b < tableSize; b++) counts[b].store(cellStart[b], std::memory_order_relaxed);
+	parallelFor(count, [&](int begin, int end) {
+		for (int i = begin; i < end; i++)
+			indices[counts[keys[i]].fetch_add(1, std::memory_order_relaxed)] = first + i;
+	});
+
+	// 4) the scatter order within a bucket depends on thread timing; sort the
+	//    (small) buckets so neighbor sums come out the same every run
+	//
+	parallelFor(tableSize, [&](int begin, int end) {
+		for (int b = begin; b < end; b++) {
+			if (cellStart[b + 1] - cellStart[b] > 1)
+				std::sort(indices.begin() + cellStart[b], indices.begin() + cellStart[b + 1]);
+		}
+	}, 4096);
+}
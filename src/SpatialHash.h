@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Particle.h"
+#include <atomic>
+#include <memory>
+
+//  Uniform grid over particle positions, hashed into a table of buckets so
+//  memory does not depend on how far the particles spread.  Rebuilt every
+//  step (in parallel) from a contiguous range of particles; neighbor queries
+//  visit the 27 cells around a point.
+//
+//  Buckets are laid out as a counting sort: the particles of bucket b are
+//  indices[cellStart[b] .. cellStart[b + 1]).  The buffers are kept from one
+//  build to the next and only grow.
+//
+class SpatialHash {
+public:
+	void build(const vector<Particle> &particles, int first, int count, float cellSize);
+
+	// call fn(index) for every particle in the range within radius of p
+	// (p itself included if it is in the range).  radius <= cellSize.
+	//
+	template <typename F>
+	void forEachNeighbor(const vector<Particle> &particles, const ofVec3f &p, float radius, F fn) const;
+
+	float cellSize = 1;
+	vector<int> cellStart;
+	vector<int> indices;        // particle indices sorted by bucket
+	vector<unsigned int> keys;  // bucket of each particle in the range
+
+private:
+	unsigned int bucket(int x, int y, int z) const {
+		return ((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u) & mask;
+	}
+	int cell(float v) const { return (int)floor(v / cellSize); }
+	unsigned int mask = 0;
+
+	// bucket counts, then scatter cursors, while building
+	//
+	std::unique_ptr<std::atomic<int>[]> counts;
+	unsigned int countsSize = 0;
+};
+
+template <typename F>
+void SpatialHash::forEachNeighbor(const vector<Particle> &particles, const ofVec3f &p, float radius, F fn) const {
+	if (indices.empty()) return;
+	float r2 = radius * radius;
+	int cx = cell(p.x), cy = cell(p.y), cz = cell(p.z);
+
+	// distinct cells can hash to the same bucket; visit each bucket once
+	//
+	unsigned int visited[27];
+	int numVisited = 0;
+	for (int x = cx - 1; x <= cx + 1; x++) {
+		for (int y = cy - 1; y <= cy + 1; y++) {
+			for (int z = cz - 1; z <= cz + 1; z++) {
+				unsigned int b = bucket(x, y, z);
+				bool seen = false;
+				for (int k = 0; k < numVisited; k++) {
+					if (visited[k] == b) { seen = true; break; }
+				}
+				if (seen) continue;
+				visited[numVisited++] = b;
+
+				for (int k = cellStart[b]; k < cellStart[b + 1]; k++) {
+					int j = indices[k];
+					if (particles[j].position.squareDistance(p) <= r2) fn(j);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+//  Bounded queue between exactly two threads, without locks: one thread
+//  push()es, the other pop()s.  Each side writes only its own index; the
+//  release store of an index hands the slot over to the other side.
+//  Capacity has to be a power of two.
+//
+template <typename T, int Capacity>
+class SpscQueue {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+public:
+	// false (and nothing queued) when the queue is full
+	//
+	bool push(const T &value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+		slots[t & (Capacity - 1)] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// false when the queue is empty
+	//
+	bool pop(T &value) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		value = slots[h & (Capacity - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	alignas(64) std::atomic<size_t> head{0};    // next slot to pop (consumer)
+	alignas(64) std::atomic<size_t> tail{0};    // next slot to push (producer)
+	T slots[Capacity];
+};
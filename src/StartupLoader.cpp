@@ -0,0 +1,122 @@
+#include "StartupLoader.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+double StartupLoader::now() const {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+}
+
+int StartupLoader::add(const string &name, Task background, Task main, int after) {
+	Stage s;
+	s.name = name;
+	s.background = background;
+	s.main = main;
+	s.after = after;
+	stages.push_back(s);
+	return (int)stages.size() - 1;
+}
+
+void StartupLoader::start(int numThreads) {
+	startTime = chrono::steady_clock::now();
+	for (int i = 0; i < stages.size(); i++)
+		if (!stages[i].background) stages[i].state = StageReady;
+
+	if (numThreads <= 0) numThreads = max(1, (int)thread::hardware_concurrency() - 1);
+	for (int t = 0; t < numThreads; t++)
+		workers.emplace_back(&StartupLoader::workerThread, this);
+}
+
+// take the first queued stage whose dependency is done, until none are left
+//
+void StartupLoader::workerThread() {
+	unique_lock<mutex> lock(stageMutex);
+	while (true) {
+		int next = -1;
+		bool bQueued = false;
+		for (int i = 0; i < stages.size() && next < 0; i++) {
+			if (stages[i].state != StageQueued) continue;
+			bQueued = true;
+			int after = stages[i].after;
+			if (after < 0 || stages[after].state == StageReady) next = i;
+		}
+		if (!bQueued || bQuit) return;
+		if (next < 0) {
+			wake.wait(lock);
+			continue;
+		}
+
+		Stage &s = stages[next];
+		s.state = StageRunning;
+		s.backgroundStart = now();
+		lock.unlock();
+		s.background();
+		lock.lock();
+		s.backgroundEnd = now();
+		s.state = StageReady;
+		wake.notify_all();
+	}
+}
+
+bool StartupLoader::update(float budgetMs) {
+	double frameStart = now();
+	while (!done()) {
+		Stage &s = stages[nextMain];
+		{
+			lock_guard<mutex> lock(stageMutex);
+			if (s.state != StageReady) break;
+		}
+		s.mainStart = now();
+		if (s.main) s.main();
+		s.mainEnd = now();
+		nextMain++;
+		if (s.mainEnd - frameStart > budgetMs) break;
+	}
+	if (done() && doneTime < 0) {
+		doneTime = now();
+		stop();
+	}
+	return done();
+}
+
+// waits for running background parts; queued ones are dropped
+//
+void StartupLoader::stop() {
+	{
+		lock_guard<mutex> lock(stageMutex);
+		bQuit = true;
+	}
+	wake.notify_all();
+	for (int t = 0; t < workers.size(); t++)
+		workers[t].join();
+	workers.clear();
+}
+
+float StartupLoader::progress() const {
+	if (stages.empty()) return 1;
+	lock_guard<mutex> lock(stageMutex);
+	int ready = 0;
+	for (int i = 0; i < stages.size(); i++)
+		if (stages[i].state == StageReady) ready++;
+	return (ready + nextMain) / (2.0f * stages.size());
+}
+
+string StartupLoader::status() const {
+	return done() ? "ready" : stages[nextMain].name;
+}
+
+void StartupLoader::firstFrame() {
+	if (firstFrameTime < 0) firstFrameTime = now();
+}
+
+void StartupLoader::report() const {
+	printf("startup: first frame at %.0f ms, loaded at %.0f ms\n", firstFrameTime, doneTime);
+	printf("  %-20s %10s %10s %10s %10s\n", "stage", "started", "background", "main", "done at");
+	for (int i = 0; i < stages.size(); i++) {
+		const Stage &s = stages[i];
+		double started = s.background ? s.backgroundStart : 0;
+		double background = s.background ? s.backgroundEnd - s.backgroundStart : 0;
+		printf("  %-20s %10.1f %10.1f %10.1f %10.1f\n", s.name.c_str(), started, background, s.mainEnd - s.mainStart, s.mainEnd);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+//  Runs the app's startup in stages so the window can draw from the first
+//  frame.  A stage has a background part (reading and decoding files,
+//  building the octree; nothing that touches GL) that runs on a worker
+//  thread, and a main part (GL uploads, and anything openFrameworks wants
+//  on its own thread) that update() runs once the background part is done.
+//  Main parts run in the order the stages were added, as many per update()
+//  as fit in the frame budget, so a main part can use whatever the earlier
+//  stages set up.  A background part can wait for another stage's
+//  background part to finish (after).
+//
+//  Every stage is timed; report() prints the breakdown along with the time
+//  to the first frame and to the end of loading.
+//
+class StartupLoader {
+public:
+	typedef std::function<void()> Task;
+
+	~StartupLoader() { stop(); }
+
+	// either part can be empty.  returns the stage's id, for after
+	//
+	int add(const std::string &name, Task background, Task main = Task(), int after = -1);
+	void start(int numThreads = 0);     // 0: one per core, less the main thread
+
+	// main thread, once per frame: run the main parts that are ready.
+	// returns true when every stage is done
+	//
+	bool update(float budgetMs = 8);
+	void stop();
+
+	bool done() const { return nextMain == (int)stages.size(); }
+	float progress() const;             // 0 to 1
+	std::string status() const;         // the stage being waited for
+	void firstFrame();                  // call when drawing, for the report
+	void report() const;
+
+private:
+	enum StageState { StageQueued, StageRunning, StageReady };
+
+	class Stage {
+	public:
+		std::string name;
+		Task background, main;
+		int after = -1;
+		StageState state = StageQueued;
+		double backgroundStart = 0, backgroundEnd = 0;  // ms since start()
+		double mainStart = 0, mainEnd = 0;
+	};
+
+	void workerThread();
+	double now() const;
+
+	std::vector<Stage> stages;
+	int nextMain = 0;
+	double firstFrameTime = -1, doneTime = -1;
+	std::chrono::steady_clock::time_point startTime;
+
+	mutable std::mutex stageMutex;
+	std::condition_variable wake;
+	std::vector<std::thread> workers;
+	bool bQuit = false;
+};
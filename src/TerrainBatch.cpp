@@ -0,0 +1,159 @@
+#include "TerrainBatch.h"
+#include <cfloat>
+
+// give the nodes ids in depth first order
+//
+int TerrainBatch::numberNodes(const TreeNode &node, int parentId) {
+	int id = (int)parent.size();
+	parent.push_back(parentId);
+	subtreeNodes.push_back(1);
+	for (int i = 0; i < node.children.size(); i++)
+		subtreeNodes[id] += numberNodes(node.children[i], id);
+	return subtreeNodes[id];
+}
+
+void TerrainBatch::build(const ObjMesh &mesh, const Octree &tree, int faces) {
+	bUploaded = false;
+	octree = &tree;
+	minFaces = faces;
+	parent.clear();
+	subtreeNodes.clear();
+	numberNodes(tree.root, -1);
+	int numNodes = (int)parent.size();
+
+	// the node of each face: go down while a child's box holds the centroid.
+	// positions are the octree's quantized ones, as drawn
+	//
+	staging.clear();
+	staging.positions = tree.vertices;
+	if (mesh.normals.size() == mesh.vertices.size())
+		staging.setNormals(mesh.normals);
+	int numVertices = staging.numVertices();
+	vector<glm::vec3> v(numVertices);
+	for (int i = 0; i < numVertices; i++) {
+		Vector3 p = staging.positions[i];
+		v[i] = glm::vec3(p.x(), p.y(), p.z());
+	}
+	const vector<int> &indices = mesh.indices;
+	int numFaces = (int)indices.size() / 3;
+	vector<int> faceNode(numFaces);
+	ownFaces.assign(numNodes, 0);
+	for (int f = 0; f < numFaces; f++) {
+		glm::vec3 c = (v[indices[3 * f]] + v[indices[3 * f + 1]] + v[indices[3 * f + 2]]) / 3.0f;
+		Vector3 p = Vector3(c.x, c.y, c.z);
+		const TreeNode *node = &tree.root;
+		int id = 0;
+		bool bDown = true;
+		while (bDown) {
+			bDown = false;
+			int child = id + 1;
+			for (int i = 0; i < node->children.size(); i++) {
+				if (node->children[i].box.inside(p)) {
+					node = &node->children[i];
+					id = child;
+					bDown = true;
+					break;
+				}
+				child += subtreeNodes[child];
+			}
+		}
+		faceNode[f] = id;
+		ownFaces[id]++;
+	}
+
+	// counting sort of the faces by node.  in depth first order a subtree is
+	// a run of ids, so its faces are one range
+	//
+	first.assign(numNodes + 1, 0);
+	for (int n = 0; n < numNodes; n++)
+		first[n + 1] = first[n] + ownFaces[n];
+	totalFaces.resize(numNodes);
+	for (int n = 0; n < numNodes; n++)
+		totalFaces[n] = first[n + subtreeNodes[n]] - first[n];
+
+	vector<int> sorted(indices.size());
+	vector<int> fill(first.begin(), first.end() - 1);
+	vector<glm::vec3> lo(numNodes, glm::vec3(FLT_MAX)), hi(numNodes, glm::vec3(-FLT_MAX));
+	for (int f = 0; f < numFaces; f++) {
+		int n = faceNode[f];
+		int to = fill[n]++;
+		for (int k = 0; k < 3; k++) {
+			int i = indices[3 * f + k];
+			sorted[3 * to + k] = i;
+			lo[n] = glm::min(lo[n], v[i]);
+			hi[n] = glm::max(hi[n], v[i]);
+		}
+	}
+
+	// subtree bounds, children before parents
+	//
+	for (int n = numNodes - 1; n > 0; n--) {
+		lo[parent[n]] = glm::min(lo[parent[n]], lo[n]);
+		hi[parent[n]] = glm::max(hi[parent[n]], hi[n]);
+	}
+	bounds.resize(numNodes);
+	for (int n = 0; n < numNodes; n++)
+		bounds[n] = Box(Vector3(lo[n].x, lo[n].y, lo[n].z), Vector3(hi[n].x, hi[n].y, hi[n].z));
+	staging.setIndices(sorted);
+}
+
+void TerrainBatch::upload() {
+	if (staging.numVertices() == 0) return;
+	vbo.upload(staging);
+	staging = QuantizedMesh();
+	bUploaded = true;
+}
+
+void TerrainBatch::drawVertices() {
+	if (!bUploaded) return;
+	vbo.begin();
+	vbo.drawPoints();
+	vbo.end();
+}
+
+// add a range of faces to the draw, joined to the last one if they touch
+//
+void TerrainBatch::emit(int firstFace, int numFaces) {
+	if (numFaces == 0) return;
+	if (firstFace == lastFace) counts.back() += 3 * numFaces;
+	else {
+		counts.push_back(3 * numFaces);
+		firstIndices.push_back(3 * firstFace);
+	}
+	lastFace = firstFace + numFaces;
+}
+
+void TerrainBatch::cull(const TreeNode &node, int id) {
+	if (totalFaces[id] == 0 || !frustum.intersects(bounds[id])) return;
+	if (totalFaces[id] <= minFaces || node.children.empty() || frustum.contains(bounds[id])) {
+		emit(first[id], totalFaces[id]);
+		return;
+	}
+	emit(first[id], ownFaces[id]);
+	int child = id + 1;
+	for (int i = 0; i < node.children.size(); i++) {
+		cull(node.children[i], child);
+		child += subtreeNodes[child];
+	}
+}
+
+void TerrainBatch::draw(const ofCamera &cam, bool bWireframe) {
+	rangesDrawn = trianglesDrawn = 0;
+	if (!isBuilt()) return;
+
+	frustum.set(cam.getModelViewProjectionMatrix());
+	counts.clear();
+	firstIndices.clear();
+	lastFace = -1;
+	cull(octree->root, 0);
+	if (counts.empty()) return;
+	rangesDrawn = (int)counts.size();
+	for (int i = 0; i < counts.size(); i++)
+		trianglesDrawn += counts[i] / 3;
+
+	if (bWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	vbo.begin();
+	vbo.multiDrawElements(counts, firstIndices);
+	vbo.end();
+	if (bWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Octree.h"
+#include "ObjMesh.h"
+#include "Frustum.h"
+#include "QuantizedVbo.h"
+
+//  Terrain mesh drawn in view-culled pieces.  At load time every triangle is
+//  given to the deepest octree node whose box holds its centroid, and the
+//  index buffer is sorted by node in depth first order, so each node's
+//  triangles, and those of its whole subtree, are one contiguous index
+//  range.  Each frame the octree is walked against the camera frustum:
+//  subtrees outside are skipped, subtrees entirely inside are taken whole,
+//  and the visible ranges (merged where they touch) go to the GPU in one
+//  multi-draw call.  The buffers are the compact ones of QuantizedMesh,
+//  with the octree's own quantized positions.
+//
+class TerrainBatch {
+public:
+	// sort the mesh's faces into the octree's nodes (no GL, so it can run
+	// on a loader thread).  subtrees of at most minFaces triangles are not
+	// split further.  then upload() on the GL thread before drawing
+	//
+	void build(const ObjMesh &mesh, const Octree &octree, int minFaces = 512);
+	void upload();
+	bool isBuilt() const { return bUploaded; }
+
+	// draw what the camera sees (between its begin() and end())
+	//
+	void draw(const ofCamera &cam, bool bWireframe = false);
+	void drawVertices();
+	size_t gpuBytes() const { return vbo.bytes(); }
+
+	// stats of the last draw
+	//
+	int rangesDrawn = 0;
+	int trianglesDrawn = 0;
+
+private:
+	int numberNodes(const TreeNode &node, int parent);
+	void cull(const TreeNode &node, int id);
+	void emit(int firstFace, int numFaces);
+
+	const Octree *octree = NULL;
+	int minFaces = 512;
+	QuantizedVbo vbo;
+	bool bUploaded = false;
+
+	// built for upload()
+	//
+	QuantizedMesh staging;
+
+	// by node, in depth first order (the root is 0)
+	//
+	vector<int> parent;
+	vector<int> subtreeNodes;       // nodes in the subtree, itself included
+	vector<int> first;              // first face of the node's range
+	vector<int> ownFaces;           // faces of the node itself, at the start of its range
+	vector<int> totalFaces;         // faces of the whole subtree
+	vector<Box> bounds;             // of the subtree's triangles (they reach past the node's box)
+
+	Frustum frustum;
+	vector<GLsizei> counts;         // visible ranges, in indices
+	vector<int> firstIndices;
+	int lastFace = -1;              // end of the last range, for merging
+};
@@ -0,0 +1,318 @@
+#include "TerrainLOD.h"
+#include "Parallel.h"
+#include <cfloat>
+
+// squared distance from p to the nearest and the farthest point of a box
+//
+static float minDistance2(const Box &b, const glm::vec3 &p) {
+	Vector3 lo = b.min(), hi = b.max();
+	float d = 0;
+	for (int k = 0; k < 3; k++) {
+		float e = max(max(lo[k] - p[k], p[k] - hi[k]), 0.0f);
+		d += e * e;
+	}
+	return d;
+}
+
+static float maxDistance2(const Box &b, const glm::vec3 &p) {
+	Vector3 lo = b.min(), hi = b.max();
+	float d = 0;
+	for (int k = 0; k < 3; k++) {
+		float e = max(fabs(lo[k] - p[k]), fabs(hi[k] - p[k]));
+		d += e * e;
+	}
+	return d;
+}
+
+void TerrainLOD::clear() {
+	heights.clear();
+	normals.clear();
+	chunks.clear();
+	levelError.clear();
+	levelDiagonal.clear();
+	ranges.clear();
+	selection.clear();
+	size = 0;
+	bUploaded = false;
+}
+
+int TerrainLOD::addChunk(int x, int z, int level) {
+	int c = (int)chunks.size();
+	chunks.emplace_back();
+	chunks[c].x = x;
+	chunks[c].z = z;
+	chunks[c].level = level;
+	if (level > 0) {
+		int half = chunkQuads << (level - 1);
+		for (int q = 0; q < 4; q++) {
+			int child = addChunk(x + (q & 1) * half, z + (q >> 1) * half, level - 1);
+			chunks[c].children[q] = child;
+		}
+	}
+	return c;
+}
+
+void TerrainLOD::build(const vector<Vector3> &vertices, const vector<int> &indices, int quads, int maxQuads) {
+	clear();
+	if (vertices.empty() || indices.size() < 3) return;
+	chunkQuads = quads;
+
+	// a square grid over the mesh with about the mesh's vertex spacing, in
+	// whole chunks at the finest level
+	//
+	Vector3 lo = vertices[0], hi = vertices[0];
+	for (int i = 1; i < vertices.size(); i++) {
+		for (int k = 0; k < 3; k++) {
+			lo[k] = min(lo[k], vertices[i][k]);
+			hi[k] = max(hi[k], vertices[i][k]);
+		}
+	}
+	float w = max(hi.x() - lo.x(), 1e-3f), h = max(hi.z() - lo.z(), 1e-3f);
+	float extent = max(w, h);
+	float meshSpacing = sqrt(w * h / vertices.size());
+	int gridQuads = chunkQuads;
+	while (gridQuads < maxQuads && extent / gridQuads > meshSpacing) gridQuads *= 2;
+	int levels = 1;
+	while ((chunkQuads << (levels - 1)) < gridQuads) levels++;
+	size = gridQuads + 1;
+	spacing = extent / gridQuads;
+	originX = lo.x();
+	originZ = lo.z();
+
+	// rasterize the triangles from above, keeping the top surface.  samples
+	// no triangle covers are holes: they are set to the lowest point of the
+	// mesh and don't count toward the chunk errors
+	//
+	heights.assign(size * size, lo.y());
+	vector<char> covered(size * size, 0);
+	for (int t = 0; t + 2 < indices.size(); t += 3) {
+		const Vector3 &a = vertices[indices[t]], &b = vertices[indices[t + 1]], &c = vertices[indices[t + 2]];
+		float area = (b.x() - a.x()) * (c.z() - a.z()) - (c.x() - a.x()) * (b.z() - a.z());
+		if (fabs(area) < 1e-12) continue;
+		int x0 = max(0, (int)ceil((min(a.x(), min(b.x(), c.x())) - originX) / spacing));
+		int x1 = min(size - 1, (int)floor((max(a.x(), max(b.x(), c.x())) - originX) / spacing));
+		int z0 = max(0, (int)ceil((min(a.z(), min(b.z(), c.z())) - originZ) / spacing));
+		int z1 = min(size - 1, (int)floor((max(a.z(), max(b.z(), c.z())) - originZ) / spacing));
+		for (int gz = z0; gz <= z1; gz++) {
+			float pz = originZ + gz * spacing;
+			for (int gx = x0; gx <= x1; gx++) {
+				float px = originX + gx * spacing;
+				float u = ((c.x() - px) * (a.z() - pz) - (a.x() - px) * (c.z() - pz)) / area;
+				float v = ((a.x() - px) * (b.z() - pz) - (b.x() - px) * (a.z() - pz)) / area;
+				if (u < -1e-5 || v < -1e-5 || u + v > 1 + 1e-5) continue;
+				float y = a.y() + u * (b.y() - a.y()) + v * (c.y() - a.y());
+				int i = gz * size + gx;
+				if (!covered[i] || y > heights[i]) heights[i] = y;
+				covered[i] = 1;
+			}
+		}
+	}
+
+	normals.resize(size * size);
+	for (int gz = 0; gz < size; gz++) {
+		for (int gx = 0; gx < size; gx++) {
+			float dx = height(min(gx + 1, size - 1), gz) - height(max(gx - 1, 0), gz);
+			float dz = height(gx, min(gz + 1, size - 1)) - height(gx, max(gz - 1, 0));
+			normals[gz * size + gx] = glm::normalize(glm::vec3(-dx, 2 * spacing, -dz));
+		}
+	}
+
+	// the quadtree, then every chunk's bounds and its height error against
+	// the full grid (over its own triangles, which split each quad from
+	// corner 00 to 11)
+	//
+	int numChunks = 0;
+	for (int l = 0; l < levels; l++) numChunks += 1 << (2 * l);
+	chunks.reserve(numChunks);
+	addChunk(0, 0, levels - 1);
+
+	parallelFor((int)chunks.size(), [&](int begin, int end) {
+		for (int c = begin; c < end; c++) {
+			TerrainChunk &ch = chunks[c];
+			int s = 1 << ch.level;
+			int n = chunkQuads * s;
+			float yMin = FLT_MAX, yMax = -FLT_MAX, error = 0;
+			for (int gz = ch.z; gz <= ch.z + n; gz++) {
+				for (int gx = ch.x; gx <= ch.x + n; gx++) {
+					int i = gz * size + gx;
+					yMin = min(yMin, heights[i]);
+					yMax = max(yMax, heights[i]);
+					if (!covered[i]) continue;
+					ch.bEmpty = false;
+					if (ch.level == 0) continue;
+					int cx = ch.x + min((gx - ch.x) / s, chunkQuads - 1) * s;
+					int cz = ch.z + min((gz - ch.z) / s, chunkQuads - 1) * s;
+					float u = (gx - cx) / (float)s, v = (gz - cz) / (float)s;
+					float h00 = height(cx, cz), h11 = height(cx + s, cz + s);
+					float y = u >= v ? h00 + u * (height(cx + s, cz) - h00) + v * (h11 - height(cx + s, cz))
+						: h00 + v * (height(cx, cz + s) - h00) + u * (h11 - height(cx, cz + s));
+					error = max(error, fabs(heights[i] - y));
+				}
+			}
+			ch.error = error;
+			ch.bounds = Box(Vector3(originX + ch.x * spacing, yMin, originZ + ch.z * spacing),
+				Vector3(originX + (ch.x + n) * spacing, yMax, originZ + (ch.z + n) * spacing));
+		}
+	}, 1);
+
+	levelError.assign(levels, 0);
+	levelDiagonal.assign(levels, 0);
+	for (int c = 0; c < chunks.size(); c++) {
+		const TerrainChunk &ch = chunks[c];
+		if (ch.bEmpty) continue;
+		levelError[ch.level] = max(levelError[ch.level], ch.error);
+		levelDiagonal[ch.level] = max(levelDiagonal[ch.level], (ch.bounds.max() - ch.bounds.min()).length());
+	}
+
+	// one index list for every chunk, quadrant by quadrant so part of a
+	// chunk can be drawn where its children take over
+	//
+	int n = chunkQuads, half = chunkQuads / 2;
+	quadIndices.clear();
+	quadIndices.reserve(n * n * 6);
+	for (int q = 0; q < 4; q++) {
+		for (int b = (q >> 1) * half; b < (q >> 1) * half + half; b++) {
+			for (int a = (q & 1) * half; a < (q & 1) * half + half; a++) {
+				unsigned int v00 = b * (n + 1) + a, v10 = v00 + 1, v01 = v00 + n + 1, v11 = v01 + 1;
+				quadIndices.push_back(v00); quadIndices.push_back(v11); quadIndices.push_back(v10);
+				quadIndices.push_back(v00); quadIndices.push_back(v01); quadIndices.push_back(v11);
+			}
+		}
+	}
+	quadrantIndices = (int)quadIndices.size() / 4;
+
+	cout << "terrain lod: " << size << "x" << size << " samples, " << levels << " levels, " << chunks.size() << " chunks" << endl;
+}
+
+void TerrainLOD::upload() {
+	if (chunks.empty()) return;
+	indexBuffer.allocate(quadIndices.size() * sizeof(unsigned int), &quadIndices[0], GL_STATIC_DRAW);
+	for (int c = 0; c < chunks.size(); c++) {
+		TerrainChunk &ch = chunks[c];
+		if (ch.bEmpty) continue;
+		chunkVertices(ch, NULL, 0, 0);
+		ch.vbo.setVertexData(&vertexScratch[0], (int)vertexScratch.size(), GL_DYNAMIC_DRAW);
+		ch.vbo.setNormalData(&normalScratch[0], (int)normalScratch.size(), GL_DYNAMIC_DRAW);
+		ch.vbo.setIndexBuffer(indexBuffer);
+	}
+	vector<unsigned int>().swap(quadIndices);
+	bUploaded = true;
+}
+
+// a chunk's vertices into the scratch arrays.  with an eye, odd vertices
+// move toward their even neighbor (toward -x and -z, onto the coarser
+// level's grid) by how far the vertex is into the morph band [start, end]
+//
+void TerrainLOD::chunkVertices(const TerrainChunk &ch, const glm::vec3 *eye, float start, float end) {
+	int n = chunkQuads + 1;
+	int s = 1 << ch.level;
+	vertexScratch.resize(n * n);
+	normalScratch.resize(n * n);
+	float band = max(end - start, 1e-6f);
+	for (int b = 0; b < n; b++) {
+		for (int a = 0; a < n; a++) {
+			int gx = ch.x + a * s, gz = ch.z + b * s;
+			glm::vec3 p = position(gx, gz);
+			glm::vec3 normal = normals[gz * size + gx];
+			if (eye && ((a | b) & 1)) {
+				float m = ofClamp((glm::length(p - *eye) - start) / band, 0, 1);
+				if (m > 0) {
+					int cx = ch.x + (a & ~1) * s, cz = ch.z + (b & ~1) * s;
+					p = glm::mix(p, position(cx, cz), m);
+					normal = glm::normalize(glm::mix(normal, normals[cz * size + cx], m));
+				}
+			}
+			vertexScratch[b * n + a] = p;
+			normalScratch[b * n + a] = normal;
+		}
+	}
+}
+
+// the distance where each level gives way to the next coarser one: where
+// the coarser level's error shrinks to pixelError on screen.  the ranges at
+// least double per level and leave room for a whole chunk before the next
+// level's morph band, so neighbors differ by at most one level and a fully
+// morphed chunk meets an unmorphed coarser one, without cracks
+//
+void TerrainLOD::setRanges(const ofCamera &cam) {
+	float pixelsPerUnit = ofGetViewportHeight() / (2 * tan(ofDegToRad(cam.getFov()) / 2));
+	int levels = numLevels();
+	ranges.resize(levels);
+	for (int l = 0; l < levels; l++) {
+		if (l == levels - 1) {
+			ranges[l] = FLT_MAX;
+			break;
+		}
+		float prev = l > 0 ? ranges[l - 1] : 0;
+		float r = levelError[l + 1] * pixelsPerUnit / pixelError;
+		ranges[l] = max(r, max(2 * prev, prev + levelDiagonal[l] / morphStart));
+	}
+}
+
+// pick what to draw under chunk c.  false when c is beyond its own level's
+// range, for the parent to draw that quadrant instead
+//
+bool TerrainLOD::select(int c, const glm::vec3 &eye) {
+	const TerrainChunk &ch = chunks[c];
+	if (ch.bEmpty || !frustum.intersects(ch.bounds)) return true;
+	if (ch.level < numLevels() - 1 && minDistance2(ch.bounds, eye) > ranges[ch.level] * ranges[ch.level])
+		return false;
+
+	if (ch.level == 0 || minDistance2(ch.bounds, eye) > ranges[ch.level - 1] * ranges[ch.level - 1]) {
+		selection.push_back(make_pair(c, 15));
+		return true;
+	}
+	int mask = 0;
+	for (int q = 0; q < 4; q++)
+		if (!select(ch.children[q], eye)) mask |= 1 << q;
+	if (mask) selection.push_back(make_pair(c, mask));
+	return true;
+}
+
+void TerrainLOD::draw(const ofCamera &cam, bool bWireframe) {
+	chunksDrawn = chunksMorphed = trianglesDrawn = 0;
+	if (!bUploaded) return;
+
+	setRanges(cam);
+	frustum.set(cam.getModelViewProjectionMatrix());
+	glm::vec3 eye = cam.getPosition();
+	selection.clear();
+	select(0, eye);
+
+	if (bWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	for (int i = 0; i < selection.size(); i++) {
+		TerrainChunk &ch = chunks[selection[i].first];
+		int mask = selection[i].second;
+
+		// morph the chunks reaching into their morph band, and put back the
+		// plain vertices of the ones that left it
+		//
+		if (ch.level < numLevels() - 1) {
+			float prev = ch.level > 0 ? ranges[ch.level - 1] : 0;
+			float end = ranges[ch.level];
+			float start = prev + (end - prev) * morphStart;
+			bool morph = maxDistance2(ch.bounds, eye) > start * start;
+			if (morph || ch.bMorphed) {
+				chunkVertices(ch, morph ? &eye : NULL, start, end);
+				ch.vbo.updateVertexData(&vertexScratch[0], (int)vertexScratch.size());
+				ch.vbo.updateNormalData(&normalScratch[0], (int)normalScratch.size());
+				ch.bMorphed = morph;
+				if (morph) chunksMorphed++;
+			}
+		}
+
+		if (mask == 15) {
+			ch.vbo.drawElements(GL_TRIANGLES, 4 * quadrantIndices);
+			trianglesDrawn += 4 * quadrantIndices / 3;
+		}
+		else {
+			for (int q = 0; q < 4; q++) {
+				if (!(mask & (1 << q))) continue;
+				ch.vbo.drawElements(GL_TRIANGLES, quadrantIndices, q * quadrantIndices);
+				trianglesDrawn += quadrantIndices / 3;
+			}
+		}
+		chunksDrawn++;
+	}
+	if (bWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ofMain.h"
+#include "box.h"
+#include "Frustum.h"
+
+//  Continuous level of detail terrain (CDLOD).  The terrain mesh is resampled
+//  into a square grid of heights, and the grid is covered by a quadtree of
+//  chunks that all have the same number of quads: a chunk at level L uses
+//  every 2^L-th sample, so each level up covers four times the area at half
+//  the resolution.  Every frame the tree is walked from the root and a chunk
+//  is split while the camera is within the range of the next finer level.
+//  The ranges come from each level's height error and the error allowed on
+//  screen (pixelError), so distant terrain is a few coarse chunks and the
+//  triangle count follows what is on screen, not the size of the mesh.
+//
+//  Toward the outer end of its range a chunk's odd vertices slide onto their
+//  even neighbors (geomorphing), so at the switch to the coarser level the
+//  surface is already the coarser one and nothing pops.  The morph is done
+//  on the CPU, only for chunks in their morph band, so the terrain is still
+//  lit by the fixed function lights.
+//
+//  The mesh is treated as a height field: where it has overhangs the top
+//  surface is kept.
+//
+class TerrainChunk {
+public:
+	int x = 0, z = 0;               // first height sample
+	int level = 0;                  // uses every 2^level-th sample
+	int children[4] = { -1, -1, -1, -1 };   // quadrants (x, z): 00, 10, 01, 11
+	Box bounds;
+	float error = 0;                // largest height difference from the full grid
+	bool bEmpty = true;             // no part of the mesh under the chunk
+	bool bMorphed = false;          // vbo holds morphed vertices
+	ofVbo vbo;
+};
+
+class TerrainLOD {
+public:
+	// chunkQuads: quads per chunk side (power of two); maxQuads caps the
+	// grid, which otherwise matches the mesh's vertex density.  build() has
+	// no GL calls (it can run on a loader thread); upload() makes the
+	// chunks' vbos on the GL thread before drawing
+	//
+	void build(const vector<Vector3> &vertices, const vector<int> &indices, int chunkQuads = 32, int maxQuads = 1024);
+	void upload();
+	void clear();
+	bool isBuilt() const { return bUploaded; }
+
+	// select, morph and draw the chunks for this camera (between its begin()
+	// and end())
+	//
+	void draw(const ofCamera &cam, bool bWireframe = false);
+
+	int numLevels() const { return (int)levelError.size(); }
+	float height(int x, int z) const { return heights[z * size + x]; }
+
+	float pixelError = 2;           // allowed height error on screen
+	float morphStart = .7;          // morph from this fraction of a level's range band
+
+	// stats of the last draw
+	//
+	int chunksDrawn = 0;
+	int chunksMorphed = 0;
+	int trianglesDrawn = 0;
+
+private:
+	int addChunk(int x, int z, int level);
+	void setRanges(const ofCamera &cam);
+	bool select(int c, const glm::vec3 &eye);
+	void chunkVertices(const TerrainChunk &ch, const glm::vec3 *eye, float start, float end);
+	glm::vec3 position(int x, int z) const { return glm::vec3(originX + x * spacing, heights[z * size + x], originZ + z * spacing); }
+
+	int chunkQuads = 32;
+	int size = 0;                   // samples per side
+	float originX = 0, originZ = 0, spacing = 1;
+	vector<float> heights;
+	vector<glm::vec3> normals;
+	vector<TerrainChunk> chunks;    // chunks[0] is the root
+	vector<float> levelError;       // by level, largest chunk error
+	vector<float> levelDiagonal;    // by level, largest chunk diagonal
+	vector<float> ranges;           // by level, for the current camera
+	ofBufferObject indexBuffer;     // shared by all chunks, by quadrant
+	vector<unsigned int> quadIndices;   // for upload()
+	int quadrantIndices = 0;
+	bool bUploaded = false;
+
+	Frustum frustum;
+	vector<pair<int, int>> selection;   // chunk, mask of quadrants to draw
+	vector<glm::vec3> vertexScratch, normalScratch;
+};
@@ -0,0 +1,302 @@
+#include "TiledTerrain.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+bool TiledTerrain::open(const string &dir) {
+	ifstream manifest(dir + "/tiles.txt");
+	string tag;
+	float size = 0;
+	if (!(manifest >> tag >> size) || tag != "tileSize" || size <= 0) {
+		cout << "TiledTerrain: no tiles.txt in " << dir << endl;
+		return false;
+	}
+	open(size, [dir](int x, int z, ObjMesh &mesh) {
+		string path = dir + "/tile_" + to_string(x) + "_" + to_string(z) + ".obj";
+		if (!ifstream(path)) return false;     // a hole in the map
+		return mesh.load(path);
+	});
+	return true;
+}
+
+void TiledTerrain::open(float size, TileSource src) {
+	close();
+	tileSize = size;
+	source = src;
+	bQuit = false;
+	loader = thread(&TiledTerrain::loaderThread, this);
+}
+
+void TiledTerrain::close() {
+	if (loader.joinable()) {
+		{
+			lock_guard<mutex> lock(tileMutex);
+			bQuit = true;
+		}
+		wake.notify_all();
+		loader.join();
+	}
+	resident.clear();
+	requests.clear();
+	pending.clear();
+	finished.clear();
+	retired.clear();
+}
+
+// distance on the ground plane from p to the center of tile (x, z)
+//
+float TiledTerrain::tileDistance(int x, int z, const Vector3 &p) const {
+	float dx = (x + 0.5f) * tileSize - p.x();
+	float dz = (z + 0.5f) * tileSize - p.z();
+	return sqrt(dx * dx + dz * dz);
+}
+
+void TiledTerrain::update(const Vector3 &p) {
+	if (!source) return;
+	{
+		lock_guard<mutex> lock(tileMutex);
+
+		// take in the tiles the loader finished, unless they went out of range
+		//
+		for (int i = 0; i < finished.size(); i++) {
+			pair<int, int> key(finished[i]->x, finished[i]->z);
+			auto it = pending.find(key);
+			bool wanted = it != pending.end() && it->second;
+			if (it != pending.end()) pending.erase(it);
+			if (wanted) {
+				resident[key] = move(finished[i]);
+				version++;
+			}
+			else retired.push_back(move(finished[i]));
+		}
+		finished.clear();
+
+		// request what is within loadRadius; pending tiles stay wanted until
+		// they pass evictRadius
+		//
+		int r = (int)ceil(loadRadius / tileSize) + 1;
+		int cx = tileX(p.x()), cz = tileZ(p.z());
+		for (int z = cz - r; z <= cz + r; z++) {
+			for (int x = cx - r; x <= cx + r; x++) {
+				pair<int, int> key(x, z);
+				if (tileDistance(x, z, p) > loadRadius || resident.count(key)) continue;
+				auto it = pending.find(key);
+				if (it == pending.end()) {
+					pending[key] = true;
+					requests.push_back(key);
+				}
+				else it->second = true;
+			}
+		}
+		for (auto it = pending.begin(); it != pending.end(); ++it)
+			if (tileDistance(it->first.first, it->first.second, p) > evictRadius)
+				it->second = false;
+
+		// nearest requests first
+		//
+		sort(requests.begin(), requests.end(), [&](const pair<int, int> &a, const pair<int, int> &b) {
+			return tileDistance(a.first, a.second, p) < tileDistance(b.first, b.second, p);
+		});
+
+		// evict far tiles.  the loader frees them, so a large octree is never
+		// torn down on this thread
+		//
+		for (auto it = resident.begin(); it != resident.end();) {
+			if (tileDistance(it->first.first, it->first.second, p) > evictRadius) {
+				retired.push_back(move(it->second));
+				it = resident.erase(it);
+				version++;
+			}
+			else ++it;
+		}
+	}
+	wake.notify_one();
+}
+
+void TiledTerrain::wait(const Vector3 &p) {
+	update(p);
+	while (numPending() > 0) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+		update(p);
+	}
+}
+
+// a retired tile held only by the retired list can't be picked up again
+// by anyone, so the count can't go back up once it is 1
+//
+bool TiledTerrain::canFree() const {
+	for (int i = 0; i < retired.size(); i++)
+		if (retired[i].use_count() == 1) return true;
+	return false;
+}
+
+int TiledTerrain::numPending() const {
+	lock_guard<mutex> lock(tileMutex);
+	return (int)pending.size();
+}
+
+void TiledTerrain::loaderThread() {
+	unique_lock<mutex> lock(tileMutex);
+	while (true) {
+		wake.wait(lock, [this] { return bQuit || !requests.empty() || canFree(); });
+		if (bQuit) return;
+
+		if (canFree()) {
+			vector<shared_ptr<const TerrainTile>> trash;
+			for (auto it = retired.begin(); it != retired.end();) {
+				if (it->use_count() == 1) {
+					trash.push_back(move(*it));
+					it = retired.erase(it);
+				}
+				else ++it;
+			}
+			lock.unlock();
+			trash.clear();
+			lock.lock();
+			continue;
+		}
+
+		pair<int, int> key = requests.front();
+		requests.erase(requests.begin());
+		auto it = pending.find(key);
+		if (it == pending.end() || !it->second) {     // no longer wanted
+			if (it != pending.end()) pending.erase(it);
+			continue;
+		}
+		int serial = nextSerial++;
+
+		lock.unlock();
+		unique_ptr<TerrainTile> tile = loadTile(key.first, key.second, serial);
+		lock.lock();
+		finished.push_back(move(tile));
+	}
+}
+
+// read a tile and build everything the queries and the renderer need
+// (loader thread)
+//
+unique_ptr<TerrainTile> TiledTerrain::loadTile(int x, int z, int serial) {
+	unique_ptr<TerrainTile> tile(new TerrainTile());
+	tile->x = x;
+	tile->z = z;
+	tile->serial = serial;
+	if (!source(x, z, tile->mesh) || tile->mesh.vertices.empty()) {
+		tile->mesh.clear();
+		return tile;
+	}
+	tile->bEmpty = false;
+	tile->octree.create(tile->mesh.vertices, octreeLevels);
+	tile->mesh.computeNormals();
+	return tile;
+}
+
+const TerrainTile *TiledTerrain::tile(int x, int z) const {
+	auto it = resident.find(pair<int, int>(x, z));
+	return it == resident.end() || it->second->bEmpty ? nullptr : it->second.get();
+}
+
+// faces belong to the tile under their centroid, so vertices of a tile can
+// reach a little into its neighbors: check the tile under p first, then the
+// neighbors whose bounds cover p
+//
+bool TiledTerrain::groundHeight(const Vector3 &p, float &height) const {
+	Ray ray = Ray(p, Vector3(0, -1, 0));
+	auto hit = [&](int x, int z) {
+		const TerrainTile *t = tile(x, z);
+		if (!t) return false;
+		const Box &b = t->octree.root.box;
+		if (p.x() < b.min().x() || p.x() > b.max().x() || p.z() < b.min().z() || p.z() > b.max().z())
+			return false;
+		TreeNode node;
+		if (!t->octree.intersect(ray, t->octree.root, node)) return false;
+		height = t->octree.vertices[node.points[0]].y();
+		return true;
+	};
+
+	int cx = tileX(p.x()), cz = tileZ(p.z());
+	if (hit(cx, cz)) return true;
+	for (int dz = -1; dz <= 1; dz++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			if ((dx != 0 || dz != 0) && hit(cx + dx, cz + dz)) return true;
+		}
+	}
+	return false;
+}
+
+bool TiledTerrain::intersect(const Box &box, vector<Box> &boxListRtn) const {
+	bool hit = false;
+	int x0 = tileX(box.min().x()) - 1, x1 = tileX(box.max().x()) + 1;
+	int z0 = tileZ(box.min().z()) - 1, z1 = tileZ(box.max().z()) + 1;
+	for (int z = z0; z <= z1; z++) {
+		for (int x = x0; x <= x1; x++) {
+			const TerrainTile *t = tile(x, z);
+			if (t && t->octree.intersect(box, t->octree.root, boxListRtn))
+				hit = true;
+		}
+	}
+	return hit;
+}
+
+int splitTerrain(const ObjMesh &mesh, float tileSize, const string &dir) {
+	map<pair<int, int>, vector<int>> faces;
+	for (int f = 0; f < mesh.numFaces(); f++) {
+		Vector3 c = (mesh.vertices[mesh.indices[3 * f]] + mesh.vertices[mesh.indices[3 * f + 1]] +
+			mesh.vertices[mesh.indices[3 * f + 2]]) / 3;
+		faces[pair<int, int>((int)floor(c.x() / tileSize), (int)floor(c.z() / tileSize))].push_back(f);
+	}
+
+	for (auto it = faces.begin(); it != faces.end(); ++it) {
+		string path = dir + "/tile_" + to_string(it->first.first) + "_" + to_string(it->first.second) + ".obj";
+		ofstream out(path);
+		if (!out) {
+			cout << "splitTerrain: can't write " << path << endl;
+			return 0;
+		}
+
+		// renumber the vertices the tile uses
+		//
+		map<int, int> remap;
+		ostringstream faceLines;
+		for (int i = 0; i < it->second.size(); i++) {
+			int f = it->second[i];
+			faceLines << "f";
+			for (int k = 0; k < 3; k++) {
+				int v = mesh.indices[3 * f + k];
+				auto r = remap.find(v);
+				if (r == remap.end()) {
+					r = remap.insert(pair<int, int>(v, (int)remap.size() + 1)).first;
+					const Vector3 &p = mesh.vertices[v];
+					out << "v " << p.x() << " " << p.y() << " " << p.z() << "\n";
+				}
+				faceLines << " " << r->second;
+			}
+			faceLines << "\n";
+		}
+		out << faceLines.str();
+	}
+
+	ofstream manifest(dir + "/tiles.txt");
+	manifest << "tileSize " << tileSize << "\n";
+	return (int)faces.size();
+}
+
+// --split-terrain <in.obj> <out dir> [tile size]
+//
+int runSplitTerrainMain(int argc, char *argv[]) {
+	if (argc < 4) {
+		cout << "usage: " << argv[0] << " --split-terrain <in.obj> <out dir> [tile size]" << endl;
+		return 1;
+	}
+	ObjMesh mesh;
+	if (!mesh.load(argv[2])) return 1;
+	float size = argc > 4 ? atof(argv[4]) : 64;
+	int n = splitTerrain(mesh, size, argv[3]);
+	cout << n << " tiles of " << size << " written to " << argv[3] << endl;
+	return n > 0 ? 0 : 1;
+}
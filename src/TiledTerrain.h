@@ -0,0 +1,116 @@
+#pragma once
+
+//  Streaming terrain for maps too large to load or index at startup.  The
+//  ground plane is cut into square tiles; each tile is a mesh plus its own
+//  Octree.  update() asks a background thread for the tiles within
+//  loadRadius of the lander and evicts the ones beyond evictRadius, so
+//  memory stays bounded however large the map is.  The loader reads and
+//  indexes a tile completely before handing it over, so the thread that
+//  calls update() only swaps pointers and never waits.
+//
+//  Tiles are shared: the sim thread updates and queries the terrain, and
+//  hands the resident tiles to the renderer (SimSnapshot::tiles).  An
+//  evicted tile is freed by the loader once nobody else holds it, so a
+//  large octree is never torn down on the sim or the main thread.
+//
+//  Altitude and collision queries go to the tiles under the query; a tile
+//  that is not resident yet counts as empty.
+//
+//  Tiles come from a source function; by default tile_<x>_<z>.obj files in
+//  a directory (see splitTerrain), a missing file being a hole in the map.
+//
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "Octree.h"
+#include "ObjMesh.h"
+
+class TerrainTile {
+public:
+	int x = 0, z = 0;               // tile coordinates
+	int serial = 0;                 // unique per load, for renderer caches
+	ObjMesh mesh;                   // with normals, for drawing
+	Octree octree;
+	bool bEmpty = true;
+};
+
+class TiledTerrain {
+public:
+	typedef std::function<bool(int x, int z, ObjMesh &mesh)> TileSource;
+
+	TiledTerrain() { }
+	~TiledTerrain() { close(); }
+
+	// tiles from tile_<x>_<z>.obj files in dir; tileSize is read from
+	// dir/tiles.txt ("tileSize <size>")
+	//
+	bool open(const std::string &dir);
+	void open(float size, TileSource src);
+	void close();
+
+	// load what is near p, evict what is far, and take in finished tiles.
+	// call once per step from the thread that queries
+	//
+	void update(const Vector3 &p);
+
+	// block until every tile update() asked for is resident (startup, tools)
+	//
+	void wait(const Vector3 &p);
+
+	// ground height under p (the altitude ray of Simulation); false if there
+	// is no terrain under p in the resident tiles
+	//
+	bool groundHeight(const Vector3 &p, float &height) const;
+
+	// terrain leaf boxes overlapping box, from every tile it touches
+	//
+	bool intersect(const Box &box, std::vector<Box> &boxListRtn) const;
+
+	int tileX(float x) const { return (int)floor(x / tileSize); }
+	int tileZ(float z) const { return (int)floor(z / tileSize); }
+	const TerrainTile *tile(int x, int z) const;
+	const std::map<std::pair<int, int>, std::shared_ptr<const TerrainTile>> &residentTiles() const { return resident; }
+	int residentVersion() const { return version; }     // changes when tiles come or go
+	int numPending() const;
+
+	float tileSize = 64;
+	float loadRadius = 160;         // load tiles whose center is this close to the lander
+	float evictRadius = 240;        // and drop them past this
+	int octreeLevels = 20;
+
+private:
+	void loaderThread();
+	std::unique_ptr<TerrainTile> loadTile(int x, int z, int serial);
+	float tileDistance(int x, int z, const Vector3 &p) const;
+	bool canFree() const;
+
+	TileSource source;
+	std::map<std::pair<int, int>, std::shared_ptr<const TerrainTile>> resident;
+	int version = 0;
+	int nextSerial = 1;
+
+	// shared with the loader thread (under mutex)
+	//
+	mutable std::mutex tileMutex;
+	std::condition_variable wake;
+	std::vector<std::pair<int, int>> requests;      // wanted, not started
+	std::map<std::pair<int, int>, bool> pending;    // requested or loading -> still wanted
+	std::vector<std::unique_ptr<TerrainTile>> finished;
+	std::vector<std::shared_ptr<const TerrainTile>> retired;    // evicted, freed by the loader when no one else holds them
+	std::thread loader;
+	bool bQuit = false;
+};
+
+// cut a mesh into tile_<x>_<z>.obj files of tileSize in dir, plus tiles.txt.
+// faces go to the tile under their centroid; returns the number of tiles
+//
+int splitTerrain(const ObjMesh &mesh, float tileSize, const std::string &dir);
+
+// entry point for "--split-terrain <in.obj> <out dir> [tile size]"
+//
+int runSplitTerrainMain(int argc, char *argv[]);
@@ -1,7 +1,7 @@
 #pragma once
 #include "TransformObject.h"
 
-//  Base class for any object that needs a transform.
+//  Transform component of a scene entity (Scene.h)
 //
 TransformObject::TransformObject() {
 	position = ofVec3f(0, 0, 0);
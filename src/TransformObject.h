@@ -4,7 +4,8 @@
 //  Kevin M. Smith - CS 134 SJSU
 //
 
-//  Base class for any object that needs a transform.
+//  Transform component of a scene entity (Scene.h): position, scale and
+//  rotation in degrees about y.
 //
 class TransformObject {
 public:
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+
+//  Latest value handoff from one writer thread to one reader thread without
+//  locks or waiting.  The writer fills back() and publish()es it; the reader
+//  calls update() and reads front(), which stays untouched until its next
+//  update() however often the writer publishes.  The third buffer sits in
+//  the middle between them: publish() swaps it with the back buffer, and
+//  update() swaps it with the front buffer if it holds something newer.
+//
+template <typename T>
+class TripleBuffer {
+public:
+	// writer
+	//
+	T &back() { return slots[backIndex]; }
+	void publish() {
+		backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// reader.  true if front() changed
+	//
+	bool update() {
+		if (!(middle.load(std::memory_order_relaxed) & fresh)) return false;
+		frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+	const T &front() const { return slots[frontIndex]; }
+
+private:
+	static const int fresh = 4;         // middle holds a buffer the reader hasn't taken
+	static const int indexMask = 3;
+
+	T slots[3];
+	int backIndex = 0;                  // writer only
+	int frontIndex = 1;                 // reader only
+	std::atomic<int> middle{2};
+};
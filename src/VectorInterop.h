@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "vector3.h"
+
+//  Vector3 (the simulation's type) and glm::vec3 / ofVec3f (openFrameworks')
+//  are all three packed floats, so an array of one can be read as an array
+//  of another in place, with no per element conversion.
+//
+static_assert(sizeof(Vector3) == sizeof(glm::vec3), "Vector3 and glm::vec3 must have the same layout");
+
+inline glm::vec3 toGlm(const Vector3 &v) { return glm::vec3(v.x(), v.y(), v.z()); }
+inline Vector3 toVector3(const glm::vec3 &v) { return Vector3(v.x, v.y, v.z); }
+
+inline const glm::vec3 *asGlm(const Vector3 *v) { return reinterpret_cast<const glm::vec3 *>(v); }
+inline const Vector3 *asVector3(const glm::vec3 *v) { return reinterpret_cast<const Vector3 *>(v); }
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "vector3.h"
+
+//  Read only view of vertex positions where they already are: count
+//  positions of three floats, stride bytes apart.  Lets the Octree build
+//  over a std::vector<Vector3>, an ofMesh's vertex array
+//  (VertexView((const float *)mesh.getVerticesPointer(), mesh.getNumVertices(),
+//  sizeof(glm::vec3))) or a mapped file without copying it first.
+//
+class VertexView {
+public:
+	VertexView() { }
+	VertexView(const float *data, int count, size_t stride = 3 * sizeof(float)) :
+		bytes((const char *)data), stride(stride), count(count) { }
+	VertexView(const std::vector<Vector3> &v) :
+		bytes((const char *)v.data()), stride(sizeof(Vector3)), count((int)v.size()) { }
+
+	const float *at(int i) const { return (const float *)(bytes + i * stride); }
+	Vector3 operator[](int i) const {
+		const float *p = at(i);
+		return Vector3(p[0], p[1], p[2]);
+	}
+	int size() const { return count; }
+	bool empty() const { return count == 0; }
+
+private:
+	const char *bytes = NULL;
+	size_t stride = 0;
+	int count = 0;
+};
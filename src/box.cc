@@ -15,18 +15,38 @@
 bool Box::intersect(const Ray &r, float t0, float t1) const {
   float tmin, tmax, tymin, tymax, tzmin, tzmax;
 
+#ifdef BOX_SSE
+  // the near and far slab distances of all three axes at once: pick the
+  // corner by the sign of the inverse direction, as the scalar code does.
+  // the fourth lane is masked to 0 so nothing denormal gets multiplied
+  //
+  const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+  __m128 lo = _mm_loadu_ps(parameters[0].data()), hi = _mm_loadu_ps(parameters[1].data());
+  __m128 origin = _mm_loadu_ps(r.origin.data());
+  __m128 inv = _mm_and_ps(_mm_loadu_ps(r.inv_direction.data()), xyz);
+  __m128 neg = _mm_cmplt_ps(inv, _mm_setzero_ps());
+  __m128 nearCorner = _mm_or_ps(_mm_and_ps(neg, hi), _mm_andnot_ps(neg, lo));
+  __m128 farCorner = _mm_or_ps(_mm_and_ps(neg, lo), _mm_andnot_ps(neg, hi));
+  float tn[4], tf[4];
+  _mm_storeu_ps(tn, _mm_mul_ps(_mm_sub_ps(nearCorner, origin), inv));
+  _mm_storeu_ps(tf, _mm_mul_ps(_mm_sub_ps(farCorner, origin), inv));
+  tmin = tn[0]; tymin = tn[1]; tzmin = tn[2];
+  tmax = tf[0]; tymax = tf[1]; tzmax = tf[2];
+#else
+
   tmin = (parameters[r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
   tmax = (parameters[1-r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
   tymin = (parameters[r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
   tymax = (parameters[1-r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
+  tzmin = (parameters[r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
+  tzmax = (parameters[1-r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
+#endif
   if ( (tmin > tymax) || (tymin > tmax) ) 
     return false;
   if (tymin > tmin)
     tmin = tymin;
   if (tymax < tmax)
     tmax = tymax;
-  tzmin = (parameters[r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
-  tzmax = (parameters[1-r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
   if ( (tmin > tzmax) || (tzmin > tmax) ) 
     return false;
   if (tzmin > tmin)
@@ -5,6 +5,15 @@
 #include "vector3.h"
 #include "ray.h"
 
+// SSE for the overlap and ray tests where the compiler targets it (x64
+// always does).  the lanes do the same float operations as the scalar code,
+// in the same order, so results are bit for bit the same either way
+//
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOX_SSE 1
+#include <emmintrin.h>
+#endif
+
 /*
  * Axis-aligned bounding box class, for use with the optimized ray-box
  * intersection test described in:
@@ -26,17 +35,18 @@ class Box {
     // (t0, t1) is the interval for valid hits
     bool intersect(const Ray &, float t0, float t1) const;
 
-    // corners
+    // corners.  the pad lets max be loaded as four floats
     Vector3 parameters[2];
+    float pad = 0;
 
-	Vector3 min() { return parameters[0]; }
-	Vector3 max() { return parameters[1]; }
-	const bool inside(const Vector3 &p) {
+	Vector3 min() const { return parameters[0]; }
+	Vector3 max() const { return parameters[1]; }
+	bool inside(const Vector3 &p) const {
 		return ((p.x() >= parameters[0].x() && p.x() <= parameters[1].x()) &&
 		     	(p.y() >= parameters[0].y() && p.y() <= parameters[1].y()) &&
 			    (p.z() >= parameters[0].z() && p.z() <= parameters[1].z()));
 	}
-	const bool inside(Vector3 *points, int size) {
+	bool inside(const Vector3 *points, int size) const {
 		bool allInside = true;
 		for (int i = 0; i < size; i++) {
 			if (!inside(points[i])) allInside = false;
@@ -47,16 +57,23 @@ class Box {
 
 	// implement for Homework Project
 	//parameter[0] is min and parameter[1] is max
-	 bool overlap(const Box &box) {
+	 bool overlap(const Box &box) const {
+#ifdef BOX_SSE
+		 __m128 lo = _mm_loadu_ps(parameters[0].data()), hi = _mm_loadu_ps(parameters[1].data());
+		 __m128 boxLo = _mm_loadu_ps(box.parameters[0].data()), boxHi = _mm_loadu_ps(box.parameters[1].data());
+		 __m128 m = _mm_and_ps(_mm_cmple_ps(lo, boxHi), _mm_cmpge_ps(hi, boxLo));
+		 return (_mm_movemask_ps(m) & 7) == 7;
+#else
 		 if ((parameters[0].x() <= box.parameters[1].x() && parameters[1].x() >= box.parameters[0].x())
 			 && (parameters[0].y() <= box.parameters[1].y() && parameters[1].y() >= box.parameters[0].y())
 			 && (parameters[0].z() <= box.parameters[1].z() && parameters[1].z() >= box.parameters[0].z())) {
 			 return true;
 		 }
 		 return false;
+#endif
 	}
 
-	Vector3 center() {
+	Vector3 center() const {
 		return ((max() - min()) / 2 + min());
 	}
 };
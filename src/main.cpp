@@ -3,6 +3,10 @@
 
 //========================================================================
 int main( ){
+
+	// the headless batch modes (--montecarlo, --replay, ...) are in the
+	// landertools build (CMakeLists.txt), which needs no openFrameworks
+	//
 	ofSetupOpenGL(1280, 1024,OF_WINDOW);			// <-------- setup the GL context
 
 	// this kicks off the running of my app
@@ -7,180 +7,206 @@
 #include "ofApp.h"
 #include "Util.h"
 
-/*
-* integrate function. Move and rotation the lander based on physics
-*/
-float Lander :: integrate() {
-	float dt;
-	float framerate = ofGetFrameRate();
-	if (framerate == 0) //check if the framerate is 0
-		dt = 1;
-	else
-		dt = 1 / framerate;
-
-	//change the lander position based on the velocity
-	glm::vec3 pos = lander.getPosition();
-	pos += (velocity * dt);
-	setLanderPosition(pos.x, pos.y, pos.z);
-
-	glm::vec3 accel = acceleration;
-
-	//lander thrust up or move down
-	if (thrustUp) {
-		accel += thrustForce;
-	}
-	if (moveDown) {
-		accel += downwardForce;
-	}
-
-	//lander forward, backward, left and right movement
-	if (moveForward) {
-		glm::vec3 forces = (header() * 3);
-		accel += forces;
-	}
-	else if (moveBackward){
-		glm::vec3 forces = (header() * 3);
-		accel -= forces;
-	}
-	else if (moveLeft) {
-		glm::vec3 forces = (leftRightHeader() * 3);
-		accel += forces;
-	}
-	else if (moveRight) {
-		glm::vec3 forces = (leftRightHeader() * 3);
-		accel -= forces;
-	}
-
-	accel += turbForce; //add turblence force
-	velocity += accel * dt; //add accel to the velocity
-	velocity *= damping; //add damping
-
-	//lander rotation
-	float rot = lander.getRotationAngle(0);
-	rot += (angularVelocity * dt);
-	setLanderRotation(rot);
-
-	float a = angularAcceleration;
-	if (rotateLeft)
-		a += angularForces;
-	if (rotateRight)
-		a -= angularForces;
-
-	angularVelocity += a * dt;
-	angularVelocity *= damping;
-
-	turbForce.set(0, 0, 0); //reset turbForce
-
-	return (angularVelocity * dt); //return the angular velocity for the lighting
-}
-
-
 //--------------------------------------------------------------
 // setup scene, lighting, state and load geometry
 //
 void ofApp::setup(){
+	Profiler::shared().setThreadName("main");
 	ofSetFrameRate(60);
 	bWireframe = false;
 	bDisplayPoints = false;
 	bAltKeyDown = false;
 	bCtrlKeyDown = false;
-	bLanderLoaded = true;
+	bLanderLoaded = false;
 	bTerrainSelected = true;
 	ofSetVerticalSync(true);
 
+	//the scene: the lander, and the cameras, lights and emitters that follow it
+	setupScene();
+
 	//set up the camares
-	cam.setNearClip(.1);
-	cam.setFov(65.5);   // approx equivalent to 28mm in 35mm format
-	cam.disableMouseInput();
-	trackCam.setDistance(100);
-	trackCam.setNearClip(.1);
-	trackCam.setFov(65.5);
-	trackCam.disableMouseInput();
-	trackCam.setPosition(20, 15, 0);
-	botCam.setNearClip(.1);
-	botCam.setFov(65.5);
-	botCam.disableMouseInput();
-	frontCam.setNearClip(.1);
-	frontCam.setFov(65.5);
-	frontCam.disableMouseInput();
+	cam().setNearClip(.1);
+	cam().setFov(65.5);   // approx equivalent to 28mm in 35mm format
+	cam().disableMouseInput();
+	trackCam().setDistance(100);
+	trackCam().setNearClip(.1);
+	trackCam().setFov(65.5);
+	trackCam().disableMouseInput();
+	trackCam().setPosition(20, 15, 0);
+	botCam().setNearClip(.1);
+	botCam().setFov(65.5);
+	botCam().disableMouseInput();
+	frontCam().setNearClip(.1);
+	frontCam().setFov(65.5);
+	frontCam().disableMouseInput();
 
 	ofEnableSmoothing();
 	ofEnableDepthTest();
 
 	ofDisableArbTex();     // disable rectangular textures
 
-	// load textures
-	//
-	if (!ofLoadImage(particleTex, "images/dot.png")) {
-		cout << "Particle Texture File: images/dot.png not found" << endl;
-		ofExit();
-	}
-
-	// load background image
-	if (!backgroundImage.load("images/background.jpg")) {
-		cout << "Can't load image" << endl;
-		ofExit();
-	}
-
-	// load the shader
-	//
-	shader.load("shaders_gles/shader");
-
-	//load the sounds
-	thrustSound.load("sounds/thrustSound.mp3");
-	thrustSound.setLoop(true);
-	explodeSound.load("sounds/explosion2.mp3");
-	explodeSound.setVolume(0.5f);
-	collideSound.load("sounds/collideSound.mp3");
-	collideSound.setVolume(0.2f);
-
 	//set up the thurst emitter
 	setThurstEmitter();
 
 	//set up the explode emitter
 	setExplodeEmitter();
 
+	//set up the landing dust emitter
+	setDustEmitter();
+
 	// setup rudimentary lighting 
 	//
 	initLightingAndMaterials();
 
-	mars.loadModel("geo/terrain8.obj");
-	mars.setScaleNormalization(false);
+	//everything else loads in the background; update() finishes it
+	addLoadStages();
+	loader.start();
 
-	//creating the lander object for the lander model
-	obj = new Lander();
-	obj->lander.setScaleNormalization(false);
-	obj->setLanderPosition(37, 30, 57);
-	obj->setLanderRotation(obj->rotation);
-	obj->turbForce.set(0, 0, 0);
+	testBox = Box(Vector3(3, 3, 0), Vector3(5, 5, 2));
+}
 
-	//set the starting camera postion
-	setCameraTarget();
-	botCam.setPosition(ofVec3f(obj->lander.getPosition()));
-	botCam.setOrientation(ofVec3f(-90, 0, 0));
-	
-	ofLoadImage(particleTex, "images/dot.png");
+/*
+* the startup stages.  background parts (decoding, parsing, building the
+* octree) run on the loader's threads; main parts (GL uploads, and sounds,
+* which load through openFrameworks) run from update() in this order.  the
+* meshes are read from their binary caches after the first run
+*/
+void ofApp::addLoadStages() {
+	// load textures
+	//
+	loader.add("particle texture", [this] {
+		bParticlePixels = ofLoadImage(particlePixels, "images/dot.png");
+	}, [this] {
+		if (!bParticlePixels) {
+			cout << "Particle Texture File: images/dot.png not found" << endl;
+			ofExit();
+			return;
+		}
+		particleTex.loadData(particlePixels);
+		particlePixels.clear();
+	});
 
-	//  Create Octree for testing.
-	octree.create(mars.getMesh(0), 20);
-	
-	testBox = Box(Vector3(3, 3, 0), Vector3(5, 5, 2));
+	// load background image
+	loader.add("background image", [this] {
+		bBackgroundPixels = ofLoadImage(backgroundPixels, "images/background.jpg");
+	}, [this] {
+		if (!bBackgroundPixels) {
+			cout << "Can't load image" << endl;
+			ofExit();
+			return;
+		}
+		backgroundImage.setFromPixels(backgroundPixels);
+		backgroundPixels.clear();
+	});
+
+	// load the shader
+	//
+	loader.add("shaders", nullptr, [this] {
+		shader.load("shaders_gles/shader");
+		analyticShader.load("shaders_gles/analytic.vert", "shaders_gles/shader.frag");
+	});
 
-	landingAreas.push_back(landingArea1);
-	landingAreas.push_back(landingArea2);
-	landingAreas.push_back(landingArea3);
+	//load the sounds
+	loader.add("thrust sound", nullptr, [this] {
+		thrustSound.load("sounds/thrustSound.mp3");
+		thrustSound.setLoop(true);
+	});
+	loader.add("explosion sound", nullptr, [this] {
+		explodeSound.load("sounds/explosion2.mp3");
+		explodeSound.setVolume(0.5f);
+	});
+	loader.add("collision sound", nullptr, [this] {
+		collideSound.load("sounds/collideSound.mp3");
+		collideSound.setVolume(0.2f);
+	});
+
+	//creating the lander object for the lander model
+	loader.add("lander model", [this] {
+		shipMesh.load(ofToDataPath("geo/ship3.obj"), true);
+	}, [this] {
+		obj = new Lander(shipMesh);
+		shipMesh.clear();
+		scene.models.add(landerEntity).model = &obj->lander;
+	});
+
+	//a tiled map streams in around the lander; otherwise load the whole
+	//terrain, then build the octree and the lod grid from it in parallel,
+	//and the culled batch from the octree
+	bTiledTerrain = ofFile::doesFileExist("geo/tiles/tiles.txt");
+	if (bTiledTerrain) {
+		loader.add("terrain tiles", [this] {
+			terrainTiles.open(ofToDataPath("geo/tiles"));
+			terrainTiles.wait(toVector3(startPosition));
+		});
+	}
+	else {
+		int meshStage = loader.add("terrain mesh", [this] {
+			terrainMesh.load(ofToDataPath("geo/terrain8.obj"), true);
+			if (terrainMesh.normals.size() != terrainMesh.vertices.size())
+				terrainMesh.computeNormals();
+		}, [this] {
+			setTerrainMaterial(terrainMesh);
+		});
+		int octreeStage = loader.add("octree", [this] {
+			octree.create(terrainMesh.vertices, 20);
+		}, nullptr, meshStage);
+		loader.add("terrain lod", [this] {
+			terrainLod.build(terrainMesh.vertices, terrainMesh.indices);
+		}, [this] {
+			terrainLod.upload();
+		}, meshStage);
+		loader.add("terrain batch", [this] {
+			terrainBatch.build(terrainMesh, octree);
+		}, [this] {
+			terrainBatch.upload();
+			terrainMesh.clear();
+		}, octreeStage);
+	}
+
+	//set up the simulation: terrain, landing pads and the lander's bounds
+	loader.add("simulation", nullptr, [this] {
+		Simulation &sim = simThread.sim;
+		if (bTiledTerrain) {
+			sim.setTerrain(&terrainTiles);
+			simThread.tiles = &terrainTiles;
+		}
+		else
+			sim.setTerrain(&octree);
+		sim.pads.push_back(LandingPad(toVector3(landingArea1), score1));
+		sim.pads.push_back(LandingPad(toVector3(landingArea2), score2));
+		sim.pads.push_back(LandingPad(toVector3(landingArea3), score3));
+		sim.landerBounds = Box(toVector3(obj->lander.getSceneMin()), toVector3(obj->lander.getSceneMax()));
+		sim.seed(ofGetElapsedTimeMicros());
+		sim.reset(toVector3(startPosition));
+		scene.setPose(landerEntity, sim.lander);
+
+		//from here on the simulation, and the streaming terrain, belong to its thread
+		simThread.start();
+		bLanderLoaded = true;
+
+		//set the starting camera postion
+		setCameraTarget();
+		botCam().setPosition(ofVec3f(obj->lander.getPosition()));
+		botCam().setOrientation(ofVec3f(-90, 0, 0));
+	});
 }
 
-// load vertex buffer for thrust emitter in preparation for rendering
+// load vertex buffer for the shared particle system in preparation for rendering.
+// every emitter's particles go into the one vbo, sized by their group
 //
-void ofApp::thrustLoadVbo() {
-	if (thrustEmitter.sys->particles.size() < 1) return;
+void ofApp::particleLoadVbo() {
+	ProfileScope scope("vbo particles");
+	if (particleSystem.particles.size() < 1) return;
 
 	vector<ofVec3f> sizes;
 	vector<ofVec3f> points;
-	for (int i = 0; i < thrustEmitter.sys->particles.size(); i++) {
-		points.push_back(thrustEmitter.sys->particles[i].position);
-		sizes.push_back(ofVec3f(5));
+	vector<ofFloatColor> colors;
+	for (int i = 0; i < particleSystem.particles.size(); i++) {
+		const Particle &p = particleSystem.particles[i];
+		const ParticleGroup &group = particleSystem.groups[p.group];
+		points.push_back(p.position);
+		sizes.push_back(ofVec3f(group.spriteSize));
+		colors.push_back(group.color);
 	}
 	// upload the data to the vbo
 	//
@@ -188,143 +214,177 @@ void ofApp::thrustLoadVbo() {
 	vbo.clear();
 	vbo.setVertexData(&points[0], total, GL_STATIC_DRAW);
 	vbo.setNormalData(&sizes[0], total, GL_STATIC_DRAW);
+	vbo.setColorData(&colors[0], total, GL_STATIC_DRAW);
 }
 
-// load vertex buffer for explode emitter in preparation for rendering
+// load vertex buffer for explode emitter in preparation for rendering.
+// only the spawn state is uploaded, and only when an explosion is fired
 //
 void ofApp::explodeLoadVbo() {
-	if (explodeEmitter.sys->particles.size() < 1) return;
-
-	vector<ofVec3f> sizes;
-	vector<ofVec3f> points;
-	for (int i = 0; i < explodeEmitter.sys->particles.size(); i++) {
-		points.push_back(explodeEmitter.sys->particles[i].position);
-		sizes.push_back(ofVec3f(20));
-	}
-	// upload the data to the vbo
-	//
-	int total = (int)points.size();
-	vbo.clear();
-	vbo.setVertexData(&points[0], total, GL_STATIC_DRAW);
-	vbo.setNormalData(&sizes[0], total, GL_STATIC_DRAW);
+	ProfileScope scope("vbo explode");
+	explodeEmitter().analyticSys.loadVbo(explodeVbo);
 }
  
 //--------------------------------------------------------------
 // incrementally update scene (animation)
 //
 void ofApp::update() {
-	if (bStartGame) {
-		ofSeedRandom();
-
-		// set ship light location
-		ofVec3f landerPos = obj->lander.getPosition();
-		landerPos.y -= 5;
-		shipLight.setPosition(obj->lander.getPosition());
-		light3.setPosition(landerPos);
-
-		//update position, rotaketion or target of camares
-		trackCam.setTarget(landerPos);
-		botCam.setPosition(ofVec3f(landerPos.x, landerPos.y - 0.2, landerPos.z));
-		botCam.setOrientation(ofVec3f(-90, obj->lander.getRotationAngle(0), 0));
-		float angle = obj->lander.getRotationAngle(0);
-		frontCam.setPosition(ofVec3f(landerPos.x - 4 * sin(ofDegToRad(angle)), landerPos.y + 2, landerPos.z - 4 * cos(ofDegToRad(angle))));
-		frontCam.setOrientation(ofVec3f(0, angle, 0));
-
-		//toggle for the light pointing to the ship
-		if (bToggleShipLight) {
-			shipLight.enable();
-		}
-		else {
-			shipLight.disable();
-		}
 
-		if (keymap[' ']) { //space key to thrust upward
-			if (obj->fuelTimeLeft > 0) {
-				startThrust = 1 / ofGetFrameRate(); 
-				obj->thrustUp = true;
-				thrustEmitter.sys->reset(); //start the thrust emitter for the visual effect
-				thrustEmitter.start();
+	// a frame ends here, after the last one's draw().  one that was slow is
+	// saved while its scopes are still in the buffers, at most every 10 sec
+	//
+	if (Profiler::shared().endFrame() && bLoaded && ofGetElapsedTimef() - lastSpikeExport > 10) {
+		lastSpikeExport = ofGetElapsedTimef();
+		exportProfile("spike-");
+	}
+	ProfileScope scope("update");
+
+	// finish loading first (the start menu shows the progress)
+	//
+	if (!bLoaded) {
+		if (loader.update()) {
+			bLoaded = true;
+			loader.report();
+		}
+		return;
+	}
 
-				if (!thrustSound.isPlaying()) //play thrust sound effect
-					thrustSound.play();
+	// the frame's work as a graph of jobs.  the simulation runs on its own
+	// thread (SimThread); the frame starts from its latest state, after last
+	// frame's particle simulation is finished, since the effects of new
+	// events reset forces and restart the emitters.  the scene's transforms
+	// follow the lander, then its cameras, lights and emitters update side
+	// by side (Scene.h).  emitters of the shared particle system spawn into
+	// it in turn; analytic ones each have their own store
+	//
+	float dt = 1.0 / simThread.rate;
+	int steps = 0;
+	frameJobs.clear();
+	int sync = frameJobs.add("sync", [this] { particleSystem.sync(); });
+	int simulate = frameJobs.addMainThread("simulate", [this, &steps] {
+		long long ticks = simState.ticks;
+		applySimState();
+		steps = (int)(simState.ticks - ticks);
+		if (bTiledTerrain)
+			updateTerrainTiles();
+		if (bStartGame)
+			ofSeedRandom();
+
+		//the dust hangs at ground level under the lander
+		scene.follows.get(dustEntity)->offset = ofVec3f(0, -simState.altitude, 0);
+		scene.updateFollows();
+		scene.updateModels();
+	}, { sync });
+
+	//update position, rotation or target of cameras
+	frameJobs.add("cameras", [this] {
+		if (bStartGame)
+			scene.updateCameras();
+	}, { simulate });
+
+	//lights that follow the lander, and the light switches (a GL call)
+	frameJobs.addMainThread("lights", [this] {
+		if (bStartGame)
+			scene.updateLights();
+	}, { simulate });
+
+	//place the particle emitters and spawn. the shared system then starts
+	//next frame's simulation on a worker thread
+	int emitters = frameJobs.add("emitters", [this] {
+		//kick up dust under the lander while thrusting close to the ground
+		if (bStartGame) {
+			if (simState.lander.thrusting && simState.bAltitude && simState.altitude < dustAltitude) {
+				if (!dustEmitter().started)
+					dustEmitter().start();
 			}
-			else { //if the lander is out of fuel, lander can't move upward
-				obj->thrustUp = false;
-				obj->fuelTimeLeft = 0;
-				bFuelOut = true;
+			else {
+				dustEmitter().stop();
 			}
 		}
-		if (keymap['d'] || keymap['D']) { //d key to move downward
-			obj->moveDown = true;
-		}
-		if (keymap[OF_KEY_UP]) { //up arrow to move forward
-			obj->moveForward = true;
-		}
-		if (keymap[OF_KEY_DOWN]) { //down arrow to move backward
-			obj->moveBackward = true;
-		}
-		if (keymap[OF_KEY_LEFT]) { //left arrow to move leftward
-			obj->moveLeft = true;
-		}
-		if (keymap[OF_KEY_RIGHT]) { //right arrow to move rightward
-			obj->moveRight = true;
-		}
-		if (keymap['z'] || keymap['Z']) { //z key to rotake left
-			obj->rotateLeft = true;
-		}
-		if (keymap['x'] || keymap['X']) { //x key to rotake right
-			obj->rotateRight = true;
-		}
+		scene.updateEmitters(false);
+	}, { simulate });
+	int analytic = frameJobs.add("analytic", [this] { scene.updateEmitters(true); }, { simulate });
+	frameJobs.add("particles", [this, dt, &steps] { particleSystem.update(dt, steps); }, { emitters, analytic });
+
+	frameJobs.run();
+	if (bDumpSchedule) {
+		printf("frame %llu: ", (unsigned long long)ofGetFrameNum());
+		frameJobs.dump();
+	}
+}
 
-		//update the gravity and the turblence forces
-		obj->acceleration = glm::vec3(0, obj->gravity, 0);
-		obj->turbForce.x += ofRandom(-0.13, 0.13);
-		obj->turbForce.y += ofRandom(-0.01, 0.01);
-		obj->turbForce.z += ofRandom(-0.13, 0.13);
-
-		//check and update the altitude between the lander and the terrain
-		rayAltitudeSensor();
-		if (bAltitude) {
-			ofVec3f p = octree.mesh.getVertex(altitudeNode.points[0]);
-			altitude = obj->lander.getPosition().y - p.y;
-		}
+//--------------------------------------------------------------
+// take the simulation thread's latest state, and play the sound and
+// particle effects for what happened since the last one
+//
+void ofApp::applySimState() {
+	SimSnapshot last = simState;
+	simState = simThread.snapshot();
 
-		//check if lander collide with the terrain
-		checkCollide();
+	if (simState.thrustTicks > last.thrustTicks) {
+		particleSystem.reset(thrustGroup); //start the thrust emitter for the visual effect
+		thrustEmitter().start();
 
-		//reaction for the collidesion
-		applyCollide();
+		if (!thrustSound.isPlaying()) //play thrust sound effect
+			thrustSound.play();
+	}
 
-		//if mouse doesn't drag the lander, apply integretion
-		if (!bInDrag) {
-			float angularChange = obj->integrate();
-			shipLight.rotate(angularChange, 0, 1, 0);
+	if (simState.contacts > last.contacts) {
+		if (simState.crashes > last.crashes) {
+			explodeEmitter().start();
+			explodeSound.play();
 		}
 
-		//calculating the ramaining fuel time
-		if (obj->thrustUp) {
-			obj->fuelTimeLeft = obj->fuelTimeLeft - startThrust;
-		}
+		//play collide sound;
+		collideSound.play();
 	}
 
-	//update the position of the particle emitters
-	ofVec3f ePos = obj->lander.getPosition();
-	thrustEmitter.position = ofVec3f(ePos.x, ePos.y + 2, ePos.z);
-	explodeEmitter.position = ofVec3f(ePos.x, ePos.y + 1.5, ePos.z);
-	thrustEmitter.update();
-	explodeEmitter.update();
-
 	//go to the game end screen if the lander crash or lander on the ground and fuel is out, or lander landed in landing areas
-	 if (bCrash || (bCollide && bFuelOut) || bLanding) { 
+	if (bStartGame && simState.game == gameSerial && simState.outcome != SimRunning) {
 		bStartGame = false;
 		bEndScreen = true;
 	}
+
+	InputRecording session;
+	while (simThread.takeSession(session))
+		saveRecording(session);
+
+	//draw the lander between the last two simulated poses, one tick behind
+	//the simulation so there is always a pose on either side
+	float alpha = 1;
+	if (bStartGame && !bInDrag && simState.game == gameSerial) {
+		PoseComponent *pose = scene.poses.get(landerEntity);
+		pose->from = simState.previous;
+		pose->to = simState.lander;
+		alpha = ofClamp((SimThread::now() - simState.time) * simThread.rate, 0, 1);
+	}
+	scene.updatePoses(alpha);
+}
+
+//--------------------------------------------------------------
+// the lander control a key drives (LanderControl), 0 for none
+//
+int ofApp::controlForKey(int key) {
+	switch (key) {
+	case ' ': return ThrustUp; //space key to thrust upward
+	case 'd': case 'D': return MoveDown; //d key to move downward
+	case OF_KEY_UP: return MoveForward; //up arrow to move forward
+	case OF_KEY_DOWN: return MoveBackward; //down arrow to move backward
+	case OF_KEY_LEFT: return MoveLeft; //left arrow to move leftward
+	case OF_KEY_RIGHT: return MoveRight; //right arrow to move rightward
+	case 'z': case 'Z': return RotateLeft; //z key to rotake left
+	case 'x': case 'X': return RotateRight; //x key to rotake right
+	}
+	return 0;
 }
+
 //--------------------------------------------------------------
 void ofApp::draw() {
+	ProfileScope scope("draw");
+	loader.firstFrame();
 	//if player in game or end game screen
 	if (bStartGame || bEndScreen) {
-		thrustLoadVbo();
+		particleLoadVbo();
 		explodeLoadVbo();
 		ofBackground(ofColor::black);
 
@@ -334,28 +394,22 @@ void ofApp::draw() {
 		glDepthMask(true);
 
 		//select different camera based on the key pressed
-		if (bTrackCam) 
-			trackCam.begin();
-		else if (bBotCam)
-			botCam.begin();
-		else if (bFrontCam)
-			frontCam.begin();
-		else
-			cam.begin();
+		currentCamera().begin();
 		ofPushMatrix();
 		if (bWireframe) {                    // wireframe mode  
 			ofDisableLighting();
 			ofSetColor(ofColor::slateGray);
-			mars.drawWireframe();
+			drawTerrain();
 			if (bLanderLoaded) {
 				obj->lander.drawWireframe();
 			}
 		}
 		else {
 			ofEnableLighting();              // shaded mode
-			mars.drawFaces();
+			drawTerrain();
 			ofMesh mesh;
 			if (bLanderLoaded) {
+				ProfileScope scope("draw lander");
 				obj->lander.drawFaces();
 				if (bLanderSelected) {
 
@@ -373,7 +427,11 @@ void ofApp::draw() {
 		if (bDisplayPoints) {                // display points as an option    
 			glPointSize(3);
 			ofSetColor(ofColor::green);
-			mars.drawVertices();
+			if (bTiledTerrain) {
+				for (auto &m : tileMeshes) m.second.drawVertices();
+			}
+			else
+				terrainBatch.drawVertices();
 		}
 
 		// recursively draw octree
@@ -382,22 +440,22 @@ void ofApp::draw() {
 		int level = 0;
 
 		if (bDisplayOctree) {
+			ProfileScope scope("draw octree");
 			ofNoFill();
 			ofSetColor(ofColor::white);
-			octree.draw(numLevels, 0);
+			if (bTiledTerrain) {
+				for (auto &t : simState.tiles)
+					t->octree.draw(numLevels, 0);
+			}
+			else
+				octree.draw(numLevels, 0);
 		}
 
 		ofPopMatrix();
-		if (bTrackCam) //end the camare
-			trackCam.end();
-		else if (bBotCam)
-			botCam.end();
-		else if (bFrontCam)
-			frontCam.end();
-		else
-			cam.end();
+		currentCamera().end(); //end the camare
 
 		glDepthMask(GL_FALSE);
+		ProfileScope particleScope("draw particles");
 
 		ofSetColor(255, 100, 90);
 
@@ -409,33 +467,25 @@ void ofApp::draw() {
 		// begin drawing in the camera
 		//
 		shader.begin();
-		if (bTrackCam)
-			trackCam.begin();
-		else if (bBotCam)
-			botCam.begin();
-		else if (bFrontCam)
-			frontCam.begin();
-		else
-			cam.begin();
+		currentCamera().begin();
 
 		// draw particle emitter here..
 		//
 		particleTex.bind();
-		vbo.draw(GL_POINTS, 0, (int)thrustEmitter.sys->particles.size());
-		vbo.draw(GL_POINTS, 0, (int)explodeEmitter.sys->particles.size());
+		vbo.draw(GL_POINTS, 0, (int)particleSystem.particles.size());
+		shader.end();
+
+		// explosion particles are positioned from their age in the vertex shader
+		//
+		analyticShader.begin();
+		explodeEmitter().analyticSys.setUniforms(analyticShader, ofGetElapsedTimeMillis(), 20);
+		explodeVbo.draw(GL_POINTS, 0, explodeEmitter().analyticSys.size());
+		analyticShader.end();
 		particleTex.unbind();
 
 		//  end drawing in the camera
 		// 
-		if (bTrackCam)
-			trackCam.end();
-		else if (bBotCam)
-			botCam.end();
-		else if (bFrontCam)
-			frontCam.end();
-		else
-			cam.end();
-		shader.end();
+		currentCamera().end();
 
 		ofDisablePointSprites();
 		ofDisableBlendMode();
@@ -444,15 +494,46 @@ void ofApp::draw() {
 		// set back the depth mask
 		//
 		glDepthMask(GL_TRUE);
+		particleScope.end();
+		ProfileScope hudScope("draw hud");
 
 		//display the remaining fuel time, altitude and framerate to the screen
 		string str, altitudeStr;
-		str = "Remaining Fuel Time: " + std::to_string(obj->fuelTimeLeft) + "      Framerate: " + std::to_string(ofGetFrameRate());
-		altitudeStr = "Altitude: " + std::to_string(altitude);
+		str = "Remaining Fuel Time: " + std::to_string(simState.lander.fuel) + "      Framerate: " + std::to_string(ofGetFrameRate());
+		altitudeStr = "Altitude: " + std::to_string(simState.altitude);
 		ofSetColor(ofColor::white);
 		if (bShowAltitude)
 			ofDrawBitmapString(altitudeStr, ofGetWindowWidth() / 2 - 100, 15);
 		ofDrawBitmapString(str, ofGetWindowWidth() - 500, 15);
+		if (bTerrainLOD && terrainLod.isBuilt()) {
+			string lodStr = "Terrain: " + std::to_string(terrainLod.chunksDrawn) + " chunks (" +
+				std::to_string(terrainLod.chunksMorphed) + " morphing), " + std::to_string(terrainLod.trianglesDrawn) + " triangles";
+			ofDrawBitmapString(lodStr, ofGetWindowWidth() - 500, 30);
+		}
+		else if (terrainBatch.isBuilt()) {
+			string cullStr = "Terrain: " + std::to_string(terrainBatch.rangesDrawn) + " ranges, " +
+				std::to_string(terrainBatch.trianglesDrawn) + " triangles";
+			ofDrawBitmapString(cullStr, ofGetWindowWidth() - 500, 30);
+		}
+
+		//guidance to the nearest landing pads: distance and direction relative to the lander's heading
+		Vector3 p = simState.lander.position;
+		const vector<int> &guidePads = simState.guidePads;
+		for (int i = 0; i < guidePads.size(); i++) {
+			const LandingPad &pad = simThread.sim.pads[guidePads[i]];   //not changed after loading
+			Vector3 d = pad.position - p;
+			d[1] = 0;
+			float forward = d * Simulation::header(simState.lander.rotation);
+			float left = d * Simulation::leftRightHeader(simState.lander.rotation);
+			string guide = "Pad " + std::to_string(guidePads[i] + 1) + " (" + std::to_string((int)pad.score) + " pts): " +
+				std::to_string((int)d.length()) + "m  " +
+				std::to_string((int)fabs(forward)) + (forward >= 0 ? " ahead, " : " behind, ") +
+				std::to_string((int)fabs(left)) + (left >= 0 ? " left" : " right");
+			ofDrawBitmapString(guide, 15, 15 + 15 * i);
+		}
+
+		if (bShowProfiler)
+			drawProfiler();
 
 		if (bEndScreen) {
 			endGameMsg(); //display end game message on the screen
@@ -466,6 +547,55 @@ void ofApp::draw() {
 }
 
 
+//--------------------------------------------------------------
+// scene entities.  the lander's transform is its simulated pose, the
+// others are placed relative to it (Scene::updateFollows)
+//
+void ofApp::setupScene() {
+	landerEntity = scene.addLander(nullptr);    //the model is added when it has loaded
+
+	camEntity = scene.addCamera();
+	trackCamEntity = scene.addCamera();
+	botCamEntity = scene.addCamera();
+	frontCamEntity = scene.addCamera();
+	activeCam = camEntity;
+	scene.follow(trackCamEntity, landerEntity, ofVec3f(0, -5, 0));
+	scene.follow(botCamEntity, landerEntity, ofVec3f(0, -5.2, 0), true);
+	scene.follow(frontCamEntity, landerEntity, ofVec3f(0, -3, -4), true);
+	scene.cameras.get(trackCamEntity)->bFollow = true;
+	scene.cameras.get(trackCamEntity)->bLookAt = true;
+	scene.cameras.get(botCamEntity)->bFollow = true;
+	scene.cameras.get(botCamEntity)->pitch = -90;
+	scene.cameras.get(frontCamEntity)->bFollow = true;
+
+	shipLightEntity = scene.addLight();
+	light1Entity = scene.addLight();
+	light2Entity = scene.addLight();
+	light3Entity = scene.addLight();
+	scene.follow(shipLightEntity, landerEntity, ofVec3f(0, 0, 0), true);
+	scene.follow(light3Entity, landerEntity, ofVec3f(0, -5, 0));
+	LightComponent *l = scene.lights.get(shipLightEntity);
+	l->bFollow = true;
+	l->bTurn = true;
+	l->bOn = false;
+	scene.lights.get(light3Entity)->bFollow = true;
+
+	thrustEntity = scene.addEmitter(new ParticleEmitter(&particleSystem));
+	explodeEntity = scene.addEmitter(new ParticleEmitter(&particleSystem));
+	dustEntity = scene.addEmitter(new ParticleEmitter(&particleSystem));
+	scene.follow(thrustEntity, landerEntity, ofVec3f(0, 2, 0));
+	scene.follow(explodeEntity, landerEntity, ofVec3f(0, 1.5, 0));
+	scene.follow(dustEntity, landerEntity, ofVec3f(0, 0, 0));
+}
+
+//--------------------------------------------------------------
+// keys 5-7 and L switch lights on and off (applied by Scene::updateLights)
+//
+void ofApp::toggleLight(Entity e) {
+	LightComponent *l = scene.lights.get(e);
+	l->bOn = !l->bOn;
+}
+
 /*
 * set up all the variable for the thurst emiiter
 */
@@ -476,186 +606,106 @@ void ofApp::setThurstEmitter() {
 	gravityForce = new GravityForce(ofVec3f(0, -0.5, 0));
 	radialForce = new ImpulseRadialForce(10);
 
-	// set up the emitter
+	// set up the emitter and its force group in the shared system
 	// 
-	thrustEmitter.sys->addForce(turbForce);
-	thrustEmitter.sys->addForce(gravityForce);
-	thrustEmitter.sys->addForce(radialForce);
-
-	thrustEmitter.setVelocity(ofVec3f(0, -5, 0));
-	thrustEmitter.setOneShot(true);
-	thrustEmitter.setEmitterType(DirectionalEmitter);
-	thrustEmitter.setGroupSize(100);
-	thrustEmitter.setRandomLife(true);
-	thrustEmitter.setLifespanRange(ofVec2f(0.5, 0.7));
+	thrustGroup = particleSystem.addGroup();
+	particleSystem.groups[thrustGroup].spriteSize = 5;
+	particleSystem.addForce(turbForce, thrustGroup);
+	particleSystem.addForce(gravityForce, thrustGroup);
+	particleSystem.addForce(radialForce, thrustGroup);
+
+	particleSystem.setThreaded(true);
+	thrustEmitter().setGroup(thrustGroup);
+	thrustEmitter().setVelocity(ofVec3f(0, -5, 0));
+	thrustEmitter().setOneShot(true);
+	thrustEmitter().setEmitterType(DirectionalEmitter);
+	thrustEmitter().setGroupSize(100);
+	thrustEmitter().setRandomLife(true);
+	thrustEmitter().setLifespanRange(ofVec2f(0.5, 0.7));
 }
 
 /*
 * set up all the variable for the thurst emiiter
 */
 void ofApp::setExplodeEmitter() {
-	// Create Forces
+	// the explosion is a one shot radial impulse (150 for one 60Hz step)
+	// plus gravity and damping, so its trajectories have a closed form
 	//
-	explodeTurbForce = new TurbulenceForce(ofVec3f(-3,0,-3), ofVec3f(3,3,3));
-	explodeGravityForce = new GravityForce(ofVec3f(0, -20, 0));
-	explodeRadialForce = new ImpulseRadialForce(150);
-
-	// set up the emitter
-	// 
-	explodeEmitter.sys->addForce(explodeTurbForce);
-	explodeEmitter.sys->addForce(explodeGravityForce);
-	explodeEmitter.sys->addForce(explodeRadialForce);
-
-	explodeEmitter.setVelocity(ofVec3f(0, 10, 0));
-	explodeEmitter.setOneShot(true);
-	explodeEmitter.setEmitterType(RadialEmitter);
-	explodeEmitter.setGroupSize(900);
-	explodeEmitter.setRandomLife(true);
-	explodeEmitter.setLifespanRange(ofVec2f(1, 2));
-}
-
-/*
-* using ray detection to the the altitude of the lander
-*/
-void ofApp::rayAltitudeSensor() {
-	glm::vec3 p = obj->lander.getPosition();
-	ofVec3f rayPoint = p; //lander position as the ray point
-	ofVec3f rayDir = ofVec3f(0, -1, 0); //downward direction as the ray direction
-	Ray ray = Ray(Vector3(rayPoint.x, rayPoint.y, rayPoint.z), Vector3(rayDir.x, rayDir.y, rayDir.z)); //creat a ray
-
-	bAltitude = octree.intersect(ray, octree.root, altitudeNode); //using the ray-intersect method of the octree
-}
-
-/*
-* check if the lander collide with the terrain using box-box intersect method of the octree
-*/
-void ofApp::checkCollide() {
-	ofVec3f min = obj->lander.getSceneMin() + obj->lander.getPosition();
-	ofVec3f max = obj->lander.getSceneMax() + obj->lander.getPosition();
-
-	Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
-
-	colBoxList.clear();
-	bCollide = octree.intersect(bounds, octree.root, colBoxList);
+	explodeEmitter().setAnalytic(true);
+	explodeEmitter().analyticSys.setGravity(ofVec3f(0, -20, 0));
+	explodeEmitter().analyticSys.setImpulse(150 / 60.0);
+
+	explodeEmitter().setVelocity(ofVec3f(0, 10, 0));
+	explodeEmitter().setOneShot(true);
+	explodeEmitter().setEmitterType(RadialEmitter);
+	explodeEmitter().setGroupSize(900);
+	explodeEmitter().setRandomLife(true);
+	explodeEmitter().setLifespanRange(ofVec2f(1, 2));
 }
 
 /*
-* react to the collidesion between lander and the terrain
+* set up all the variable for the landing dust emitter
 */
-void ofApp::applyCollide() {
-	if (!bCollide) {
-		clipped = false;
-	}
-	if (bCollide) {
-
-		if (!clipped) {
-
-			//check if the velocity during the collision is too large
-			if (abs(obj->velocity.x) > 1.8 || abs(obj->velocity.y) > 1.8 || abs(obj->velocity.z) > 1.8) {
-				explodeEmitter.sys->reset();
-				explodeEmitter.start();
-				explodeSound.play();
-				bCrash = true;
-			}
-
-			//play collide sound;
-			collideSound.play();
-
-			//reverse velocity (bounce)
-			obj->velocity = -0.5 * obj->velocity;
-			obj->acceleration = -6 * obj->acceleration;
-
-			//anti clipping
-			if (obj->velocity.x <= 0) {
-				obj->velocity.x = 0.1;
-			}
-			
-			checkLanding(); //check if the lander land in one of the lander areas
-		}
-		clipped = true; //for lander to not stuck in the terrain
-	}
-}
+void ofApp::setDustEmitter() {
+	// Create Forces
+	//
+	dustGravityForce = new GravityForce(ofVec3f(0, -1, 0));
+	dustTurbForce = new TurbulenceForce(ofVec3f(-2, 0, -2), ofVec3f(2, 1, 2));
+	dustSeparationForce = new SeparationForce(0.5, 20);
 
-/*
-* check if lander lands in any of the landing areas
-*/
-void ofApp:: checkLanding() {
-	for (int i = 0; i < 3; i++)
-	{
-		float deltaX = abs(obj->lander.getPosition().x - landingAreas[i].x);
-		float deltaZ = abs(obj->lander.getPosition().z - landingAreas[i].z);
-		float distance = sqrt(deltaX * deltaX + deltaZ * deltaZ); //using the distance formula to check the distance between lander and the lander areas
-		if (distance <= landingAreaRadius) {
-			//if lander landed successfully, check the score that player got
-			if (distance <= landingAreaRadius - landerHalfLength) { //if the lander landed perfectly in the landing areas
-				if (i == 0)
-					finalScore = score1;
-				else if (i == 1)
-					finalScore = score2;
-				else
-					finalScore = score3;
-			}
-			else {  //if the lander landed slightly off the landing areas, player get half of the score of the current landing area
-				if (i == 0)
-					finalScore = score1/2;
-				else if (i == 1)
-					finalScore = score2/2;
-				else
-					finalScore = score3/2;
-			}
-			bLanding = true;
-		}
-	}
+	// set up the emitter and its force group in the shared system
+	//
+	dustGroup = particleSystem.addGroup();
+	particleSystem.groups[dustGroup].spriteSize = 10;
+	particleSystem.groups[dustGroup].color = ofFloatColor(.35, .3, .25);
+	particleSystem.addForce(dustGravityForce, dustGroup);
+	particleSystem.addForce(dustTurbForce, dustGroup);
+	particleSystem.addNeighborForce(dustSeparationForce, dustGroup);
+
+	dustEmitter().setGroup(dustGroup);
+	dustEmitter().setEmitterType(DiskEmitter);
+	dustEmitter().radius = 2;
+	dustEmitter().setVelocity(ofVec3f(0, 3, 0));
+	dustEmitter().setRate(30);
+	dustEmitter().setGroupSize(100);
+	dustEmitter().setDamping(.97);
+	dustEmitter().setRandomLife(true);
+	dustEmitter().setLifespanRange(ofVec2f(1, 2));
 }
 
 void ofApp::keyPressed(int key) {
+	bool bWasDown = keymap[key];
 	keymap[key] = true;
+	if (!bLoaded) return;
+
+	//the lander controls go to the simulation thread as they change (not on key repeat)
+	if (!bWasDown && controlForKey(key))
+		simThread.post(SimEvent(SimControlDown, controlForKey(key)));
 	if (bStartGame) {
 		if (keymap['1']) { //general interactive cam
-			bGeneralCam = true;
-			bTrackCam = false;
-			bBotCam = false;
-			bFrontCam = false;
+			activeCam = camEntity;
 		}
 		if (keymap['2']) { //tracking cam for the lander
-			bGeneralCam = false;
-			bTrackCam = true;
-			bBotCam = false;
-			bFrontCam = false;
+			activeCam = trackCamEntity;
 		}
 		if (keymap['3']) { //bottom view cam from the lander
-			bGeneralCam = false;
-			bTrackCam = false;
-			bBotCam = true;
-			bFrontCam = false;
+			activeCam = botCamEntity;
 		}
 		if (keymap['4']) { //front view cam from the lander
-			bGeneralCam = false;
-			bTrackCam = false;
-			bBotCam = false;
-			bFrontCam = true;
+			activeCam = frontCamEntity;
 		}
 		if (keymap['5']) { //enable light1
-			if (light1.getIsEnabled())
-				light1.disable();
-			else
-				light1.enable();
+			toggleLight(light1Entity);
 		}
 		if (keymap['6']) {//enable light2
-			if (light2.getIsEnabled())
-				light2.disable();
-			else
-				light2.enable();
+			toggleLight(light2Entity);
 		}
 		if (keymap['7']) {//enable light3, light to light the lander
-			if (light3.getIsEnabled())
-				light3.disable();
-			else
-				light3.enable();
+			toggleLight(light3Entity);
 		}
 		if (keymap['C'] || keymap['c']) {//enable or disable mouse input for the cam1
-			if (cam.getMouseInputEnabled()) cam.disableMouseInput();
-			else cam.enableMouseInput();
+			if (cam().getMouseInputEnabled()) cam().disableMouseInput();
+			else cam().enableMouseInput();
 		}
 		if (keymap['A'] || keymap['a']) {//show or hide the altitude sensor
 			bShowAltitude = !bShowAltitude;
@@ -664,13 +714,25 @@ void ofApp::keyPressed(int key) {
 			ofToggleFullscreen();
 		}
 		if (keymap['L'] || keymap['l']) {//enable or disable the front light of the lander
-			bToggleShipLight = !bToggleShipLight;
+			toggleLight(shipLightEntity);
+		}
+		if (keymap['G'] || keymap['g']) {//level of detail terrain or the full mesh
+			bTerrainLOD = !bTerrainLOD;
+		}
+		if (keymap['J'] || keymap['j']) {//print the frame's job schedule every frame
+			bDumpSchedule = !bDumpSchedule;
+		}
+		if (keymap['M'] || keymap['m']) {//show or hide the profiler's frame time overlay
+			bShowProfiler = !bShowProfiler;
+		}
+		if (keymap['E'] || keymap['e']) {//save the last seconds of profiled scopes
+			exportProfile("");
 		}
 		if (keymap['O'] || keymap['o']) {
 			bDisplayOctree = !bDisplayOctree;
 		}
 		if (keymap['r']) {
-			cam.reset();
+			cam().reset();
 		}
 		if (keymap['s']) {
 			savePicture();
@@ -685,7 +747,7 @@ void ofApp::keyPressed(int key) {
 			toggleWireframeMode();
 		}
 		if (keymap[OF_KEY_ALT]) {
-			cam.enableMouseInput();
+			cam().enableMouseInput();
 			bAltKeyDown = true;
 		}
 		if (keymap[OF_KEY_CONTROL]) {
@@ -715,7 +777,7 @@ void ofApp::togglePointsDisplay() {
 
 void ofApp::keyReleased(int key) {
 	if (keymap[OF_KEY_ALT]) {
-		cam.disableMouseInput();
+		cam().disableMouseInput();
 		bAltKeyDown = false;
 	}
 	if (keymap[OF_KEY_CONTROL]) {
@@ -723,31 +785,11 @@ void ofApp::keyReleased(int key) {
 	}
 
 	if (keymap[' ']) {
-		obj->thrustUp = false;
-		thrustEmitter.stop();
+		thrustEmitter().stop();
 		thrustSound.stop();
 	}
-	if (keymap['d'] || keymap['D']) {
-		obj->moveDown = false;
-	}
-	if (keymap[OF_KEY_UP]) {
-		obj->moveForward = false;
-	}
-	if (keymap[OF_KEY_DOWN]) {
-		obj->moveBackward = false;
-	}
-	if (keymap[OF_KEY_LEFT]) {
-		obj->moveLeft = false;
-	}
-	if (keymap[OF_KEY_RIGHT]) {
-		obj->moveRight = false;
-	}
-	if (keymap['z'] || keymap['Z']) {
-		obj->rotateLeft = false;
-	}
-	if (keymap['x'] || keymap['X']) {
-		obj->rotateRight = false;
-	}
+	if (bLoaded && keymap[key] && controlForKey(key))
+		simThread.post(SimEvent(SimControlUp, controlForKey(key)));
 	keymap[key] = false;
 }
 
@@ -765,17 +807,17 @@ void ofApp::mousePressed(int x, int y, int button) {
 
 	// if moving camera, don't allow mouse interaction
 	//
-	if (cam.getMouseInputEnabled()) return;
+	if (cam().getMouseInputEnabled()) return;
 
 	// if moving camera, don't allow mouse interaction
 //
-	if (cam.getMouseInputEnabled()) return;
+	if (cam().getMouseInputEnabled()) return;
 
 	// if rover is loaded, test for selection
 	//
 	if (bLanderLoaded) {
-		glm::vec3 origin = cam.getPosition();
-		glm::vec3 mouseWorld = cam.screenToWorld(glm::vec3(mouseX, mouseY, 0));
+		glm::vec3 origin = cam().getPosition();
+		glm::vec3 mouseWorld = cam().screenToWorld(glm::vec3(mouseX, mouseY, 0));
 		glm::vec3 mouseDir = glm::normalize(mouseWorld - origin);
 
 		ofVec3f min = obj->lander.getSceneMin() + obj->lander.getPosition();
@@ -785,9 +827,11 @@ void ofApp::mousePressed(int x, int y, int button) {
 		bool hit = bounds.intersect(Ray(Vector3(origin.x, origin.y, origin.z), Vector3(mouseDir.x, mouseDir.y, mouseDir.z)), 0, 10000);
 		if (hit) {
 			bLanderSelected = true;
-			mouseDownPos = getMousePointOnPlane(obj->lander.getPosition(), cam.getZAxis());
+			mouseDownPos = getMousePointOnPlane(obj->lander.getPosition(), cam().getZAxis());
 			mouseLastPos = mouseDownPos;
 			bInDrag = true;
+			dragPose = simState.lander;
+			simThread.post(SimEvent(SimHold)); //the mouse holds the lander while dragging
 		}
 		else {
 			bLanderSelected = false;
@@ -800,30 +844,26 @@ void ofApp::mouseDragged(int x, int y, int button) {
 
 	// if moving camera, don't allow mouse interaction
 	//
-	if (cam.getMouseInputEnabled()) return;
+	if (cam().getMouseInputEnabled()) return;
 
 	if (bInDrag) {
 
-		glm::vec3 landerPos = obj->lander.getPosition();
-		glm::vec3 mousePos = getMousePointOnPlane(landerPos, cam.getZAxis());
+		glm::vec3 landerPos = toGlm(dragPose.position);
+		glm::vec3 mousePos = getMousePointOnPlane(landerPos, cam().getZAxis());
 		glm::vec3 delta = mousePos - mouseLastPos;
 	
 		landerPos += delta;
-		obj->lander.setPosition(landerPos.x, landerPos.y, landerPos.z);
+		dragPose.position = toVector3(landerPos);
+		simThread.post(SimEvent(SimMoveTo, dragPose.position)); //a teleport can't be replayed from the inputs
+		scene.setPose(landerEntity, dragPose);
 		mouseLastPos = mousePos;
-
-		ofVec3f min = obj->lander.getSceneMin() + obj->lander.getPosition();
-		ofVec3f max = obj->lander.getSceneMax() + obj->lander.getPosition();
-
-		Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
-
-		colBoxList.clear();
-		octree.intersect(bounds, octree.root, colBoxList);
 	}
 }
 
 //--------------------------------------------------------------
 void ofApp::mouseReleased(int x, int y, int button) {
+	if (bInDrag)
+		simThread.post(SimEvent(SimRelease));
 	bInDrag = false;
 }
 
@@ -835,8 +875,8 @@ void ofApp::setCameraTarget() {
 	ofVec3f position = obj->lander.getPosition();
 	float angle = obj->lander.getRotationAngle(0);
 
-	cam.setPosition(position.x + 17 * sin(ofDegToRad(angle)), position.y + 4, position.z + 17 * cos(ofDegToRad(angle)));
-	cam.setOrientation(ofVec3f(-15, angle, 0));
+	cam().setPosition(position.x + 17 * sin(ofDegToRad(angle)), position.y + 4, position.z + 17 * cos(ofDegToRad(angle)));
+	cam().setOrientation(ofVec3f(-15, angle, 0));
 }
 
 
@@ -865,54 +905,54 @@ void ofApp::gotMessage(ofMessage msg){
 //
 void ofApp::initLightingAndMaterials() {
 	// setup 3 lights
-	shipLight.setup();
-	shipLight.enable();
-	shipLight.setSpotlight();
-	shipLight.setScale(.05);
-	shipLight.setSpotlightCutOff(25);
-	shipLight.setAttenuation(2, .002, .002);
-	shipLight.setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
-	shipLight.setDiffuseColor(ofFloatColor(1, 1, 1));
-	shipLight.setSpecularColor(ofFloatColor(1, 1, 1));
-	shipLight.rotate(0, ofVec3f(0, 1, 0));
-	shipLight.setPosition(-5, 5, 5);
+	shipLight().setup();
+	shipLight().enable();
+	shipLight().setSpotlight();
+	shipLight().setScale(.05);
+	shipLight().setSpotlightCutOff(25);
+	shipLight().setAttenuation(2, .002, .002);
+	shipLight().setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
+	shipLight().setDiffuseColor(ofFloatColor(1, 1, 1));
+	shipLight().setSpecularColor(ofFloatColor(1, 1, 1));
+	shipLight().rotate(0, ofVec3f(0, 1, 0));
+	shipLight().setPosition(-5, 5, 5);
 
 	//ambient light
-	light1.setup();
-	light1.enable();
-	light1.setAreaLight(1, 1);
-	light1.setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
-	light1.setDiffuseColor(ofFloatColor(1, 1, 1));
-	light1.setSpecularColor(ofFloatColor(1, 1, 1));
-	light1.rotate(45, ofVec3f(0, 1, 0));
-	light1.rotate(-45, ofVec3f(1, 0, 0));
-	light1.setPosition(15, 90, -195);
+	light1().setup();
+	light1().enable();
+	light1().setAreaLight(1, 1);
+	light1().setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
+	light1().setDiffuseColor(ofFloatColor(1, 1, 1));
+	light1().setSpecularColor(ofFloatColor(1, 1, 1));
+	light1().rotate(45, ofVec3f(0, 1, 0));
+	light1().rotate(-45, ofVec3f(1, 0, 0));
+	light1().setPosition(15, 90, -195);
 
 	// cloud light
-	light2.setup();
-	light2.enable();
-	light2.setSpotlight();
-	light2.setScale(.45);
-	light2.setSpotlightCutOff(60);
-	light2.setAttenuation(29, .001, .001);
-	light2.setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
-	light2.setDiffuseColor(ofFloatColor(1, 2, 2));
-	light2.setSpecularColor(ofFloatColor(1, 1, 1));
-	light2.rotate(270, ofVec3f(1, 0, 0));
-	light2.setPosition(10, 60, 35);
+	light2().setup();
+	light2().enable();
+	light2().setSpotlight();
+	light2().setScale(.45);
+	light2().setSpotlightCutOff(60);
+	light2().setAttenuation(29, .001, .001);
+	light2().setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
+	light2().setDiffuseColor(ofFloatColor(1, 2, 2));
+	light2().setSpecularColor(ofFloatColor(1, 1, 1));
+	light2().rotate(270, ofVec3f(1, 0, 0));
+	light2().setPosition(10, 60, 35);
 
 	// light up ship
-	light3.setup();
-	light3.enable();
-	light3.setSpotlight();
-	light3.setScale(.05);
-	light3.setSpotlightCutOff(25);
-	light3.setAttenuation(1, .002, .002);
-	light3.setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
-	light3.setDiffuseColor(ofFloatColor(1, 1, 1));
-	light3.setSpecularColor(ofFloatColor(1, 1, 1));
-	light3.rotate(90, ofVec3f(1, 0, 0));
-	light3.setPosition(-5, 5, 5);
+	light3().setup();
+	light3().enable();
+	light3().setSpotlight();
+	light3().setScale(.05);
+	light3().setSpotlightCutOff(25);
+	light3().setAttenuation(1, .002, .002);
+	light3().setAmbientColor(ofFloatColor(0.1, 0.1, 0.1));
+	light3().setDiffuseColor(ofFloatColor(1, 1, 1));
+	light3().setSpecularColor(ofFloatColor(1, 1, 1));
+	light3().rotate(90, ofVec3f(1, 0, 0));
+	light3().setPosition(-5, 5, 5);
 
 	static float ambient[] =
 	{ .5f, .5f, .5, 1.0f };
@@ -959,8 +999,8 @@ void ofApp::dragEvent2(ofDragInfo dragInfo) {
 
 bool ofApp::mouseIntersectPlane(ofVec3f planePoint, ofVec3f planeNorm, ofVec3f &point) {
 	ofVec2f mouse(mouseX, mouseY);
-	ofVec3f rayPoint = cam.screenToWorld(glm::vec3(mouseX, mouseY, 0));
-	ofVec3f rayDir = rayPoint - cam.getPosition();
+	ofVec3f rayPoint = cam().screenToWorld(glm::vec3(mouseX, mouseY, 0));
+	ofVec3f rayDir = rayPoint - cam().getPosition();
 	rayDir.normalize();
 	return (rayIntersectPlane(rayPoint, rayDir, planePoint, planeNorm, point));
 }
@@ -974,9 +1014,9 @@ void ofApp::dragEvent(ofDragInfo dragInfo) {
 glm::vec3 ofApp::getMousePointOnPlane(glm::vec3 planePt, glm::vec3 planeNorm) {
 	// Setup our rays
 	//
-	glm::vec3 origin = cam.getPosition();
-	glm::vec3 camAxis = cam.getZAxis();
-	glm::vec3 mouseWorld = cam.screenToWorld(glm::vec3(mouseX, mouseY, 0));
+	glm::vec3 origin = cam().getPosition();
+	glm::vec3 camAxis = cam().getZAxis();
+	glm::vec3 mouseWorld = cam().screenToWorld(glm::vec3(mouseX, mouseY, 0));
 	glm::vec3 mouseDir = glm::normalize(mouseWorld - origin);
 	float distance;
 
@@ -999,35 +1039,177 @@ glm::vec3 ofApp::getMousePointOnPlane(glm::vec3 planePt, glm::vec3 planeNorm) {
 //--------------------------------------------------------------
 //reset all the variables for the new game
 void ofApp::reset() {
+	//the simulation thread hands over the session of a game quit part way too
 	bEndScreen = false;
 	bStartGame = false;
-	obj->setLanderPosition(37, 30, 57);
-	obj->setLanderRotation(0);
-	obj->velocity = ofVec3f(0, 0, 0);
-	obj->acceleration = ofVec3f(0, 0, 0);
-	obj->angularVelocity = 0;
-	obj->angularAcceleration = 0;
-	obj->fuelTimeLeft = 120;
-
-	botCam.setPosition(ofVec3f(obj->lander.getPosition()));
-	botCam.setOrientation(ofVec3f(-90, 0, 0));
-	bGeneralCam = true;
-	bTrackCam = false;
-	bBotCam = false;
-	bFrontCam = false;
+	simThread.post(SimEvent(SimResetGame, toVector3(startPosition)));
+	LanderState start;
+	start.position = toVector3(startPosition);
+	scene.setPose(landerEntity, start);
+
+	botCam().setPosition(ofVec3f(obj->lander.getPosition()));
+	botCam().setOrientation(ofVec3f(-90, 0, 0));
+	activeCam = camEntity;
 	setCameraTarget();
 	
-	bCollide = false;
-	bToggleShipLight = false;
-	clipped = false;
-	bCrash = false;
+	scene.lights.get(shipLightEntity)->bOn = false;
 	bShowAltitude = true;
-	bLanding = false;
-	bFuelOut = false;
 }
 
 void ofApp::gameStart() {
 	bStartGame = true;
+
+	//a fresh seed per game; the recording keeps it for replay
+	SimEvent e(SimStartGame);
+	e.seed = (unsigned int)ofGetElapsedTimeMicros();
+	e.game = ++gameSerial;
+	simThread.post(e);
+}
+
+//--------------------------------------------------------------
+// save a finished game's session to data/sessions
+//
+void ofApp::saveRecording(const InputRecording &recording) {
+	ofDirectory::createDirectory("sessions", true, true);
+	string path = ofToDataPath("sessions/" + ofGetTimestampString() + ".lrec");
+	if (recording.save(path))
+		cout << "session saved to " << path << " (" << recording.numSteps() << " steps)" << endl;
+}
+
+//--------------------------------------------------------------
+// the profiled scopes still buffered (the last few seconds of every
+// thread), as a Chrome trace and as a table
+//
+void ofApp::exportProfile(const string &prefix) {
+	ofDirectory::createDirectory("profiles", true, true);
+	string path = ofToDataPath("profiles/" + prefix + ofGetTimestampString());
+	if (Profiler::shared().exportTrace(path + ".json") && Profiler::shared().exportCsv(path + ".csv"))
+		cout << "profile saved to " << path << ".json and .csv" << endl;
+}
+
+//--------------------------------------------------------------
+// frame times of the last Profiler::window frames as bars, with the spike
+// threshold, and each scope's time per frame over them, slowest first.
+// the times are cpu time: draw calls return before the gpu has drawn
+//
+void ofApp::drawProfiler() {
+	Profiler &profiler = Profiler::shared();
+	vector<float> frames;
+	vector<ProfileStat> stats;
+	profiler.frameTimes(frames);
+	profiler.stats(stats);
+
+	float x = 15, y = 80, scale = 2;    //pixels per msec
+	float height = 2 * profiler.spikeMs * scale;
+	ofFill();
+	ofSetColor(0, 0, 0, 160);
+	ofDrawRectangle(x - 5, y - 5, 470, height + 30 + 15 * min((int)stats.size(), 16));
+	for (int i = 0; i < frames.size(); i++) {
+		float h = min(frames[i] * scale, height);
+		ofSetColor(frames[i] > profiler.spikeMs ? ofColor::red : ofColor::green);
+		ofDrawRectangle(x + i, y + height - h, 1, h);
+	}
+	ofSetColor(ofColor::yellow);
+	ofDrawLine(x, y + height - profiler.spikeMs * scale, x + profiler.window, y + height - profiler.spikeMs * scale);
+
+	y += height + 20;
+	ofSetColor(ofColor::white);
+	char line[128];
+	snprintf(line, sizeof(line), "%-20s %6s %6s %6s %6s %6s  ms", "scope", "last", "p50", "p95", "p99", "max");
+	ofDrawBitmapString(line, x, y);
+	for (int i = 0; i < stats.size() && i < 15; i++) {
+		const ProfileStat &s = stats[i];
+		snprintf(line, sizeof(line), "%-20.20s %6.2f %6.2f %6.2f %6.2f %6.2f", s.name.c_str(), s.last, s.p50, s.p95, s.p99, s.max);
+		ofDrawBitmapString(line, x, y + 15 * (i + 1));
+	}
+}
+
+//--------------------------------------------------------------
+// keep a gpu mesh for each resident terrain tile (the sim thread streams
+// them in around the lander).  at most one mesh is built per frame so
+// crossing into new tiles doesn't stall a frame
+//
+void ofApp::updateTerrainTiles() {
+	ProfileScope scope("terrain tiles");
+	const vector<shared_ptr<const TerrainTile>> &tiles = simState.tiles;
+
+	//drop meshes of evicted tiles
+	vector<int> live;
+	for (auto &t : tiles) live.push_back(t->serial);
+	sort(live.begin(), live.end());
+	for (auto it = tileMeshes.begin(); it != tileMeshes.end();) {
+		if (binary_search(live.begin(), live.end(), it->first)) ++it;
+		else it = tileMeshes.erase(it);
+	}
+
+	//build one new mesh, nearest tile first
+	const TerrainTile *next = NULL;
+	float nextDist = 0;
+	for (auto &t : tiles) {
+		const TerrainTile *tile = t.get();
+		if (tileMeshes.count(tile->serial)) continue;
+		Vector3 c = tile->octree.root.box.center() - simState.lander.position;
+		float d = c.x() * c.x() + c.z() * c.z();
+		if (!next || d < nextDist) {
+			next = tile;
+			nextDist = d;
+		}
+	}
+	if (next) {
+		ofVboMesh &mesh = tileMeshes[next->serial];
+		mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+		const ObjMesh &m = next->mesh;
+		mesh.addVertices(asGlm(m.vertices.data()), m.vertices.size());
+		mesh.addNormals(asGlm(m.normals.data()), m.normals.size());
+		static_assert(sizeof(int) == sizeof(ofIndexType), "tile indices are copied as ofIndexType");
+		mesh.addIndices((const ofIndexType *)m.indices.data(), m.indices.size());
+	}
+}
+
+//--------------------------------------------------------------
+// the camera selected with keys 1-4
+//
+ofCamera &ofApp::currentCamera() {
+	return scene.camera(activeCam);
+}
+
+//--------------------------------------------------------------
+// the terrain is drawn with one material: the one most of its triangles use
+//
+void ofApp::setTerrainMaterial(const ObjMesh &mesh) {
+	const ObjMaterialRange *largest = NULL;
+	for (int i = 0; i < mesh.ranges.size(); i++)
+		if (mesh.ranges[i].material >= 0 && (!largest || mesh.ranges[i].numIndices > largest->numIndices))
+			largest = &mesh.ranges[i];
+	if (!largest) {
+		terrainMaterial.setDiffuseColor(ofFloatColor(0.62, 0.62, 0.62));
+		return;
+	}
+	const ObjMaterial &m = mesh.materials[largest->material];
+	terrainMaterial.setDiffuseColor(ofFloatColor(m.diffuse.x(), m.diffuse.y(), m.diffuse.z()));
+	terrainMaterial.setAmbientColor(ofFloatColor(m.ambient.x(), m.ambient.y(), m.ambient.z()));
+	terrainMaterial.setSpecularColor(ofFloatColor(m.specular.x(), m.specular.y(), m.specular.z()));
+	terrainMaterial.setShininess(m.shininess);
+}
+
+//--------------------------------------------------------------
+// draw the terrain in the current mode (faces or wireframe)
+//
+void ofApp::drawTerrain() {
+	ProfileScope scope("draw terrain");
+	if (!bTiledTerrain) {
+		if (!bWireframe) terrainMaterial.begin();
+		if (bTerrainLOD && terrainLod.isBuilt())
+			terrainLod.draw(currentCamera(), bWireframe);
+		else
+			terrainBatch.draw(currentCamera(), bWireframe);
+		if (!bWireframe) terrainMaterial.end();
+		return;
+	}
+	for (auto &m : tileMeshes) {
+		if (bWireframe) m.second.drawWireframe();
+		else m.second.drawFaces();
+	}
 }
 
 /*
@@ -1037,22 +1219,21 @@ void ofApp::endGameMsg() {
 	string endStr, endStr2, endStr3;
 
 	//display end game message based the end condition
-	if (bCrash) {
-		finalScore = 0;
+	SimOutcome outcome = (SimOutcome)simState.outcome;
+	if (outcome == SimCrashed) {
 		endStr = "Game Over...";
 		endStr2 = "The AstroBoy has Crashed";
-		endStr3 = "Your Score: " + std::to_string(finalScore);
+		endStr3 = "Your Score: " + std::to_string(0.0f);
 	}
-	else if (bCollide && bFuelOut && !bLanding) {
-		finalScore = 0;
+	else if (outcome == SimFuelOut) {
 		endStr = "Game Over...";
 		endStr2 = "The AstroBoy has Run Out of Fuel";
-		endStr3 = "Your Score: " + std::to_string(finalScore);
+		endStr3 = "Your Score: " + std::to_string(0.0f);
 	}
-	else if (bLanding) {
+	else if (outcome == SimLanded) {
 		endStr = "CONGRATULATIONS!";
 		endStr2 = "You have Successfully Landed!";
-		endStr3 = "Your Score: " + std::to_string(finalScore);
+		endStr3 = "Your Score: " + std::to_string(simState.score);
 	}
 	string endStr4 = "Press the 'p' key to return to start screen.";
 	ofSetColor(ofColor::white);
@@ -1068,11 +1249,14 @@ void ofApp::endGameMsg() {
 void ofApp::startMenu() {
 	glDepthMask(false);
 	ofSetColor(ofColor::white);
-	backgroundImage.draw(0, 0, ofGetScreenWidth(), ofGetScreenHeight());
+	if (backgroundImage.isAllocated())
+		backgroundImage.draw(0, 0, ofGetScreenWidth(), ofGetScreenHeight());
 	glDepthMask(true);
 
 	string title = "Astroboy Lander";
 	string start = "Press any key to start game";
+	if (!bLoaded)
+		start = "Loading " + loader.status() + "... " + std::to_string((int)(100 * loader.progress())) + "%";
 	string instructions = "Land the spacecraft gently in any of the landing pads before your fuel runs out!";
 	string instructions2 = "Accurate landing and landing in the mountain pads rewards more points.";
 
@@ -1090,6 +1274,7 @@ void ofApp::startMenu() {
 	string hotkey4 = "C - Toggle Freecam Interaction";
 	string hotkey5 = "A - Toggle Altitude";
 	string hotkey6 = "L - Toggle Spacecraft Light";
+	string hotkey7 = "G - Toggle Terrain Level of Detail";
 
 	ofSetColor(ofColor::white);
 	ofDrawBitmapString(title, ofGetWindowWidth() - 820, 140);
@@ -1109,4 +1294,5 @@ void ofApp::startMenu() {
 	ofDrawBitmapString(hotkey4, ofGetWindowWidth() - 820, 520);
 	ofDrawBitmapString(hotkey5, ofGetWindowWidth() - 820, 540);
 	ofDrawBitmapString(hotkey6, ofGetWindowWidth() - 820, 560);
+	ofDrawBitmapString(hotkey7, ofGetWindowWidth() - 820, 580);
 }
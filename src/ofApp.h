@@ -2,82 +2,35 @@
 
 #include "ofMain.h"
 #include "ofxGui.h"
-#include  "ofxAssimpModelLoader.h"
 #include "Octree.h"
+#include "Simulation.h"
+#include "Recording.h"
+#include "SimThread.h"
+#include "JobGraph.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "TerrainLOD.h"
+#include "TerrainBatch.h"
+#include "StartupLoader.h"
+#include "ObjModel.h"
+#include "VectorInterop.h"
 #include <glm/gtx/intersect.hpp>
 #include "Particle.h"
 #include "ParticleEmitter.h"
 
 /*
-* A class for the lander object
+* A class for the lander object. Only the ship model; it is placed by the
+* lander's scene entity (Scene.h) and the physics lives in the headless
+* Simulation (Simulation.h)
 */
 class Lander {
 public:
-	Lander() { //load and set up the model
-		lander.loadModel("geo/ship3.obj");
+	Lander(const ObjMesh &mesh) { //set up the model from the loaded ship mesh
+		lander.setMesh(mesh);
 		lander.setScale(1.3, 1.3, 1.3);
-		lander.setScaleNormalization(false);
-
-	}
-
-	//set the position of the lander
-	void setLanderPosition(float x, float y, float z) {
-		lander.setPosition(x, y, z);
-	}
-
-	//set the rotation of the lander
-	void setLanderRotation(float angle) {
-		lander.setRotation(0, angle, 0, 1, 0);
-	}
-
-	//return the header for forward and backward movement using trig
-	glm::vec3 header()
-	{
-		glm::vec3 d = glm::vec3(sin(ofDegToRad(lander.getRotationAngle(0) + 180)), 0, cos(ofDegToRad(lander.getRotationAngle(0) + 180)));
-		return glm::normalize(d);
-	}
-
-	//return the header for leftward and rightward movement using trig
-	glm::vec3 leftRightHeader() {
-		glm::vec3 d = glm::vec3(sin(ofDegToRad(lander.getRotationAngle(0) - 90)), 0, cos(ofDegToRad(lander.getRotationAngle(0) - 90)));
-		return glm::normalize(d);
 	}
 
-	/*
-	* integrate function. Move and ratation the lander based on phyics
-	*/
-	float integrate();
-
-	ofxAssimpModelLoader lander;
-	float rotation = 0;
-
-	//physic varibles
-	glm::vec3 velocity = glm::vec3(0,0,0);
-
-	glm::vec3 thrustForce = glm::vec3(0, 2, 0);
-	glm::vec3 downwardForce = glm::vec3(0, -2, 0);
-
-	//angular varible 
-	float angularVelocity = 0;
-	float angularAcceleration = 0;
-	ofVec3f acceleration = glm::vec3(0, 0, 0);
-	float angularForces = 12;
-	ofVec3f turbForce;
-
-	float damping = .99;
-	float gravity = -0.3;
-
-	//movement boolean variables
-	bool moveForward = false;
-	bool moveBackward = false;
-	bool moveLeft = false;
-	bool moveRight = false;
-	bool thrustUp = false;
-	bool moveDown = false;
-	bool rotateLeft = false;
-	bool rotateRight = false;
-
-	float fuelTimeLeft = 120;
+	ObjModel lander;
 };
 
 class ofApp : public ofBaseApp{
@@ -100,42 +53,80 @@ class ofApp : public ofBaseApp{
 		void dragEvent(ofDragInfo dragInfo);
 		void gotMessage(ofMessage msg);
 		void initLightingAndMaterials();
+		void setupScene();
+		void toggleLight(Entity e);
 		void savePicture();
+		void drawProfiler();
+		void exportProfile(const string &prefix);
 		void toggleWireframeMode();
 		void togglePointsDisplay();
 		void toggleSelectTerrain();
 		void setCameraTarget();
 		bool mouseIntersectPlane(ofVec3f planePoint, ofVec3f planeNorm, ofVec3f &point);
-		void rayAltitudeSensor();
-		void checkCollide();
-		void applyCollide();
-		void checkLanding();
-		void thrustLoadVbo();
+		void applySimState();
+		int controlForKey(int key);
+		void particleLoadVbo();
 		void explodeLoadVbo();
 		void setThurstEmitter();
 		void setExplodeEmitter();
+		void setDustEmitter();
 		void gameStart();
+		void saveRecording(const InputRecording &recording);
+		void updateTerrainTiles();
+		void drawTerrain();
+		void setTerrainMaterial(const ObjMesh &mesh);
+		ofCamera &currentCamera();
 		void reset();
 		void endGameMsg();
 		void startMenu();
+		void addLoadStages();
 		glm::vec3 ofApp::getMousePointOnPlane(glm::vec3 p , glm::vec3 n);
 
-		//camera
-		ofEasyCam cam;
-		ofEasyCam trackCam;
-		ofEasyCam botCam;
-		ofEasyCam frontCam;
+		//the scene objects (Scene.h) and the entities ofApp works with.
+		//the accessors return the object of an entity
+		Scene scene;
+		Entity landerEntity;
+		Entity camEntity, trackCamEntity, botCamEntity, frontCamEntity;
+		Entity activeCam;
+		Entity light1Entity, light2Entity, light3Entity, shipLightEntity;
+		Entity thrustEntity, explodeEntity, dustEntity;
+
+		ofEasyCam &cam() { return scene.camera(camEntity); }
+		ofEasyCam &trackCam() { return scene.camera(trackCamEntity); }
+		ofEasyCam &botCam() { return scene.camera(botCamEntity); }
+		ofEasyCam &frontCam() { return scene.camera(frontCamEntity); }
+		ofLight &light1() { return scene.light(light1Entity); }
+		ofLight &light2() { return scene.light(light2Entity); }
+		ofLight &light3() { return scene.light(light3Entity); }
+		ofLight &shipLight() { return scene.light(shipLightEntity); }
+		ParticleEmitter &thrustEmitter() { return scene.emitter(thrustEntity); }
+		ParticleEmitter &explodeEmitter() { return scene.emitter(explodeEntity); }
+		ParticleEmitter &dustEmitter() { return scene.emitter(dustEntity); }
 
 		//lander and bounding box varibles
-		ofxAssimpModelLoader mars;
+		ObjMesh terrainMesh;        // while loading; freed when done
+		ObjMesh shipMesh;
+
+		//streaming terrain, used instead of terrain8 when data/geo/tiles exists
+		//(made with --split-terrain); the sim thread streams it. tileMeshes
+		//are the resident tiles' gpu meshes, by TerrainTile::serial
+		TiledTerrain terrainTiles;
+		bool bTiledTerrain = false;
+		map<int, ofVboMesh> tileMeshes;
+
+		//level of detail renderer for the terrain (G toggles it)
+		TerrainLOD terrainLod;
+		bool bTerrainLOD = true;
+
+		//the full terrain mesh, drawn in octree node pieces culled to the camera
+		TerrainBatch terrainBatch;
+		ofMaterial terrainMaterial;
 		ofLight light;
 		Box boundingBox, landerBounds;
 		Box testBox;
-		vector<Box> colBoxList;
 		bool bLanderSelected = false;
 		Octree octree;
 		TreeNode selectedNode;
-		TreeNode altitudeNode;
 		glm::vec3 mouseDownPos, mouseLastPos;
 		bool bInDrag = false;
 
@@ -148,18 +139,7 @@ class ofApp : public ofBaseApp{
 		bool bDisplayPoints;
 		bool bDisplayOctree = false;
 		bool bDisplayBBoxes = false;
-		bool bAltitude = false;
-		bool bCollide = false;
-		bool bToggleShipLight = false;
-		bool clipped = false;
-		bool bCrash = false;
-		bool bGeneralCam = true;
-		bool bTrackCam = false;
-		bool bBotCam = false;
-		bool bFrontCam = false;
 		bool bShowAltitude = true;
-		bool bLanding = false;
-		bool bFuelOut = false;
 		
 		bool bLanderLoaded;
 		bool bTerrainSelected;
@@ -175,29 +155,46 @@ class ofApp : public ofBaseApp{
 
 		const float selectionRange = 4.0;
 
+		//the lander model that renders the simulation (simThread)
 		Lander *obj = NULL;
 		map<int, bool> keymap;
+		glm::vec3 startPosition = glm::vec3(37, 30, 57);
+
+		//the work of a frame as a job graph (JobGraph.h)
+		JobGraph frameJobs;
+		bool bDumpSchedule = false;
 
-		float startThrust = 0;
-		float altitude = -1;
+		//profiler overlay (M), and when a slow frame was last saved
+		bool bShowProfiler = false;
+		float lastSpikeExport = -1e9;
+
+		// particle store shared by the thrust and dust emitters (scene entities).
+		// it is simulated once per frame for all of them and drawn with a single vbo
+		//
+		ParticleSystem particleSystem;
 
 		// thrust Emitter and some forces;
 		//
-		ParticleEmitter thrustEmitter;
+		int thrustGroup;
 
 		TurbulenceForce* turbForce;
 		GravityForce* gravityForce;
 		ImpulseRadialForce* radialForce;
 		CyclicForce* cyclicForce;
 
-		// Explodsion Emitter and some forces;
+		// landing dust kicked up under the lander when thrusting near the ground.
+		// the particles push each other apart (neighbor search in the system)
 		//
-		ParticleEmitter explodeEmitter;
+		int dustGroup;
+		float dustAltitude = 6;
 
-		TurbulenceForce* explodeTurbForce;
-		GravityForce* explodeGravityForce;
-		ImpulseRadialForce* explodeRadialForce;
-		CyclicForce* explodeCyclicForce;
+		GravityForce* dustGravityForce;
+		TurbulenceForce* dustTurbForce;
+		SeparationForce* dustSeparationForce;
+
+		// Explodsion Emitter (explodeEntity). its particles are ballistic, so they
+		// are positioned analytically in the vertex shader instead of simulated
+		//
 
 		// textures
 		//
@@ -206,10 +203,11 @@ class ofApp : public ofBaseApp{
 		// shaders
 		//
 		ofVbo vbo;
+		ofVbo explodeVbo;
 		ofShader shader;
+		ofShader analyticShader;
 
 		// lights
-		ofLight light1, light2, light3, shipLight;
 		ofImage backgroundImage;
 
 		//sound
@@ -217,17 +215,33 @@ class ofApp : public ofBaseApp{
 		ofSoundPlayer explodeSound;
 		ofSoundPlayer collideSound;
 
-		//coordinates of the landing areas
+		//coordinates of the landing areas (simThread.sim.pads)
 		glm::vec3 landingArea1 = glm::vec3(0.129794, 0, 17.3758);
 		glm::vec3 landingArea2 = glm::vec3(2.80003, 0, -76.8603);
 		glm::vec3 landingArea3 = glm::vec3(-43.1438, 0, 96.1508);
-		vector<glm::vec3> landingAreas;
-		float landingAreaRadius = 2.5;
-		float landerHalfLength = 1;
 
 		//different scores
 		float score1 = 100;
 		float score2 = 200;
 		float score3 = 300;
-		float finalScore = 0;;
+
+
+		//the simulation at a fixed tick on its own thread, fed the controls
+		//and game commands, and the latest state it published (read by update
+		//and draw). every game on a single terrain octree is recorded (seed
+		//and per step controls) and saved to data/sessions when it ends, for
+		//replay with --replay.
+		//declared after the terrain it queries, so it stops first
+		SimThread simThread;
+		SimSnapshot simState;
+		int gameSerial = 0;
+		LanderState dragPose;
+
+		//assets are decoded and the octree built on worker threads while the
+		//start menu shows the progress; the game can start once bLoaded.
+		//declared last so it is destroyed (and its workers joined) first
+		ofPixels particlePixels, backgroundPixels;
+		bool bParticlePixels = false, bBackgroundPixels = false;
+		StartupLoader loader;
+		bool bLoaded = false;
 };
@@ -7,14 +7,14 @@ class Vector3 {
   public:
     Vector3() { };
     Vector3(float x, float y, float z) { d[0] = x; d[1] = y; d[2] = z; }
-    Vector3(const Vector3 &v)
-      { d[0] = v.d[0]; d[1] = v.d[1]; d[2] = v.d[2]; }
 
     float x() const { return d[0]; }
     float y() const { return d[1]; }
     float z() const { return d[2]; }
 
     float operator[](int i) const { return d[i]; }
+    const float *data() const { return d; }
+    float &operator[](int i) { return d[i]; }
     
     float length() const
       { return sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]); }
@@ -50,6 +50,16 @@ class Vector3 {
       d[1] *= s;
       d[2] *= s;
     }
+    void operator+=(const Vector3 &op2) {
+      d[0] += op2.d[0];
+      d[1] += op2.d[1];
+      d[2] += op2.d[2];
+    }
+    void operator-=(const Vector3 &op2) {
+      d[0] -= op2.d[0];
+      d[1] -= op2.d[1];
+      d[2] -= op2.d[2];
+    }
     Vector3 operator/(float s) const {            // scalar division
       return Vector3(d[0] / s, d[1] / s, d[2] / s);
     }
@@ -74,7 +84,7 @@ class Vector3 {
     }
   
   private:
-    float d[3];
+    float d[3];     // packed, the layout of glm::vec3 and ofVec3f (see VectorInterop.h)
 };
 
 #endif // _VECTOR3_H_
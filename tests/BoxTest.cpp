@@ -0,0 +1,69 @@
+//  Box::intersect(Ray) and Box::overlap, which run on SSE where the compiler
+//  targets it, against the scalar tests written out here.  Corners and ray
+//  origins are on a whole number grid, so rays graze faces and edges, and
+//  some rays are axis aligned with a -0 component.
+//
+#include "box.h"
+#include <cstdio>
+#include <random>
+#include <math.h>
+
+using namespace std;
+
+static bool intersectScalar(const Box &box, const Ray &r, float t0, float t1) {
+	const Vector3 *p = box.parameters;
+	float tmin = (p[r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
+	float tmax = (p[1 - r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
+	float tymin = (p[r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
+	float tymax = (p[1 - r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
+	if (tmin > tymax || tymin > tmax) return false;
+	if (tymin > tmin) tmin = tymin;
+	if (tymax < tmax) tmax = tymax;
+	float tzmin = (p[r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
+	float tzmax = (p[1 - r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
+	if (tmin > tzmax || tzmin > tmax) return false;
+	if (tzmin > tmin) tmin = tzmin;
+	if (tzmax < tmax) tmax = tzmax;
+	return tmin < t1 && tmax > t0;
+}
+
+static bool overlapScalar(const Box &a, const Box &b) {
+	return a.min().x() <= b.max().x() && a.max().x() >= b.min().x() &&
+		a.min().y() <= b.max().y() && a.max().y() >= b.min().y() &&
+		a.min().z() <= b.max().z() && a.max().z() >= b.min().z();
+}
+
+int main() {
+	mt19937 rng(9);
+	uniform_real_distribution<float> u(-10, 10);
+	uniform_int_distribution<int> k(0, 5);
+	auto gridPoint = [&]() { return Vector3(roundf(u(rng)), roundf(u(rng)), roundf(u(rng))); };
+	auto size = [&]() { return Vector3(k(rng), k(rng), k(rng)); };
+
+	int cases = 2000000, bad = 0, hits = 0, overlaps = 0;
+	for (int i = 0; i < cases; i++) {
+		Vector3 lo = gridPoint();
+		Box box(lo, lo + size());
+
+		Vector3 d;
+		switch (k(rng)) {
+		case 0: d = Vector3(0, -1, 0); break;
+		case 1: d = Vector3(-0.0f, -1, 0); break;
+		case 2: d = Vector3(1, 0, 0); break;
+		default: d = Vector3(u(rng), u(rng), u(rng));
+		}
+		Vector3 o(roundf(u(rng)), u(rng), roundf(u(rng)));
+		Ray ray(o, d);
+		bool hit = box.intersect(ray, 0, 1000000);
+		if (hit != intersectScalar(box, ray, 0, 1000000)) bad++;
+		hits += hit;
+
+		Vector3 lo2 = gridPoint();
+		Box other(lo2, lo2 + size());
+		bool overlap = box.overlap(other);
+		if (overlap != overlapScalar(box, other)) bad++;
+		overlaps += overlap;
+	}
+	printf("BoxTest: %d cases, %d hits, %d overlaps, %d mismatches\n", cases, hits, overlaps, bad);
+	return bad == 0 ? 0 : 1;
+}
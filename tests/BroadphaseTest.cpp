@@ -0,0 +1,55 @@
+//  Broadphase::findPairs against every pair of boxes, over ticks of moving
+//  boxes with proxies removed and ids reused.
+//
+#include "Broadphase.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+
+using namespace std;
+
+int main() {
+	mt19937 rng(3);
+	uniform_real_distribution<float> u(0, 100);
+	const int n = 2000, removed = 77;
+
+	Broadphase broadphase;
+	vector<Box> boxes;
+	vector<int> ids;
+	for (int i = 0; i < n; i++) {
+		Vector3 p(u(rng), u(rng) * 0.1f, u(rng));
+		boxes.push_back(Box(p, p + Vector3(2, 2, 2)));
+		ids.push_back(broadphase.add(boxes[i], i));
+	}
+	broadphase.remove(ids[5]);
+	broadphase.remove(ids[removed]);
+	ids[5] = broadphase.add(boxes[5], 5);
+
+	for (int tick = 0; tick < 50; tick++) {
+		for (int i = 0; i < n; i++) {
+			if (i == removed) continue;
+			float dx = (u(rng) - 50) * 0.01f;
+			Vector3 move(dx, 0, dx);
+			boxes[i] = Box(boxes[i].min() + move, boxes[i].max() + move);
+			broadphase.update(ids[i], boxes[i]);
+		}
+		broadphase.findPairs();
+
+		set<pair<int, int>> found, expected;
+		for (const BroadphasePair &p : broadphase.pairs()) {
+			int a = broadphase.userData(p.a), b = broadphase.userData(p.b);
+			found.insert(make_pair(min(a, b), max(a, b)));
+		}
+		for (int i = 0; i < n; i++)
+			for (int j = i + 1; j < n; j++)
+				if (i != removed && j != removed && boxes[i].overlap(boxes[j]))
+					expected.insert(make_pair(i, j));
+		if (found != expected) {
+			printf("BroadphaseTest: tick %d found %d pairs, expected %d\n", tick, (int)found.size(), (int)expected.size());
+			return 1;
+		}
+		if (tick == 49) printf("BroadphaseTest: %d pairs\n", (int)found.size());
+	}
+	return 0;
+}
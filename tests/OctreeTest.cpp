@@ -0,0 +1,83 @@
+//  The Octree built over a strided view of interleaved vertex data (position
+//  and normal, as in a GL vertex buffer) is the same tree as the one built
+//  over a std::vector<Vector3>, the points of each node are inside its box,
+//  and the batched ray and box queries match the single ones.
+//
+#include "Octree.h"
+#include <cstdio>
+#include <random>
+
+using namespace std;
+
+static bool sameTree(const TreeNode &a, const TreeNode &b) {
+	if (a.points != b.points || a.children.size() != b.children.size()) return false;
+	for (int i = 0; i < 2; i++)
+		for (int j = 0; j < 3; j++)
+			if (a.box.parameters[i][j] != b.box.parameters[i][j]) return false;
+	for (int i = 0; i < a.children.size(); i++)
+		if (!sameTree(a.children[i], b.children[i])) return false;
+	return true;
+}
+
+// every point of a node is inside its box
+//
+static int checkNode(const TreeNode &node, const vector<Vector3> &verts) {
+	int bad = 0;
+	for (int p : node.points)
+		if (!node.box.inside(verts[p])) bad++;
+	for (const TreeNode &child : node.children)
+		bad += checkNode(child, verts);
+	return bad;
+}
+
+int main() {
+	mt19937 rng(5);
+	uniform_real_distribution<float> u(-200, 200);
+	const int n = 20000, levels = 8;
+	vector<Vector3> verts(n);
+	vector<float> interleaved(n * 6);
+	for (int i = 0; i < n; i++) {
+		verts[i] = Vector3(u(rng), u(rng) * 0.1f, u(rng));
+		if (i < 100) verts[i] = Vector3(0, 0, 0);      // duplicates, on the split planes
+		for (int j = 0; j < 3; j++) {
+			interleaved[i * 6 + j] = verts[i][j];
+			interleaved[i * 6 + 3 + j] = -1;
+		}
+	}
+
+	Octree octree, strided;
+	octree.create(verts, levels);
+	strided.create(VertexView(interleaved.data(), n, 6 * sizeof(float)), levels);
+	int bad = 0;
+	if (!sameTree(octree.root, strided.root)) {
+		printf("OctreeTest: the strided tree differs\n");
+		bad++;
+	}
+	bad += checkNode(octree.root, verts);
+
+	vector<Ray> rays;
+	vector<Box> boxes;
+	for (int i = 0; i < 2000; i++) {
+		rays.push_back(Ray(Vector3(u(rng), 100, u(rng)), Vector3(u(rng) * 0.01f, -1, u(rng) * 0.01f)));
+		Vector3 p(u(rng), u(rng) * 0.1f, u(rng));
+		boxes.push_back(Box(p, p + Vector3(1, 1, 1)));
+	}
+	vector<const TreeNode *> nodes;
+	vector<unsigned char> boxHits;
+	octree.intersect(rays, nodes);
+	octree.intersect(boxes, boxHits);
+	int rayHits = 0, overlaps = 0;
+	for (int i = 0; i < rays.size(); i++) {
+		TreeNode node;
+		bool hit = octree.intersect(rays[i], octree.root, node);
+		if (hit != (nodes[i] != NULL) || (hit && node.points != nodes[i]->points)) bad++;
+		rayHits += hit;
+
+		vector<Box> leaves;
+		bool overlap = octree.intersect(boxes[i], octree.root, leaves);
+		if (overlap != (boxHits[i] != 0)) bad++;
+		overlaps += overlap;
+	}
+	printf("OctreeTest: %d ray hits, %d box overlaps, %d mismatches\n", rayHits, overlaps, bad);
+	return bad == 0 ? 0 : 1;
+}
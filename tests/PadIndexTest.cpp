@@ -0,0 +1,52 @@
+//  PadIndex::nearest and padAt against every pad, for points inside and
+//  far outside the pads' grid, including grids squashed to a line.  The
+//  nearest search reuses one scratch list across queries, as the sim does.
+//
+#include "PadIndex.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+using namespace std;
+
+int main() {
+	mt19937 rng(3);
+	uniform_real_distribution<float> u(-500, 500), far(-3000, 3000);
+	const float radius = 3;
+	int queries = 0, bad = 0;
+	for (int trial = 0; trial < 40; trial++) {
+		int n = 1 + rng() % 3000;
+		vector<LandingPad> pads;
+		for (int i = 0; i < n; i++)
+			pads.push_back(LandingPad(Vector3(u(rng), 0, u(rng) * (trial % 3 ? 1 : 0.01f)), 100, radius));
+		PadIndex index;
+		index.build(pads, radius);
+
+		vector<int> got;
+		vector<pair<float, int>> all, scratch;
+		for (int q = 0; q < 300; q++, queries++) {
+			float x = q % 2 ? far(rng) : u(rng), z = q % 3 ? far(rng) : u(rng);
+			int k = 1 + rng() % 5;
+			index.nearest(x, z, k, got, scratch);
+
+			all.clear();
+			for (int i = 0; i < n; i++) {
+				float dx = pads[i].position.x() - x, dz = pads[i].position.z() - z;
+				all.push_back(make_pair(dx * dx + dz * dz, i));
+			}
+			sort(all.begin(), all.end());
+			for (int i = 0; i < min(k, n); i++) {
+				if (i >= got.size() || got[i] != all[i].second) {
+					bad++;
+					break;
+				}
+			}
+
+			int at = index.padAt(x, z);
+			int expected = all[0].first <= radius * radius ? all[0].second : -1;
+			if (at != expected) bad++;
+		}
+	}
+	printf("PadIndexTest: %d queries, %d mismatches\n", queries, bad);
+	return bad == 0 ? 0 : 1;
+}
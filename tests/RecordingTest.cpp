@@ -0,0 +1,85 @@
+//  Games played on the SimThread replay to the same final state, including
+//  a game started from the end screen of the one before (without a reset in
+//  between, as ofApp does when a key is pressed there).  A session keeps
+//  the hash of its terrain through save() and load(), and other terrain
+//  doesn't match it.
+//
+#include "SimThread.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace std;
+
+// wait until game has been played to the end
+//
+static bool waitForEnd(SimThread &simThread, int game) {
+	for (int i = 0; i < 1000; i++) {
+		const SimSnapshot &s = simThread.snapshot();
+		if (s.game == game && !s.bPlaying) return true;
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+	return false;
+}
+
+int main() {
+	// flat ground with a pad in the middle
+	//
+	vector<Vector3> ground;
+	for (int z = -20; z <= 20; z++)
+		for (int x = -20; x <= 20; x++)
+			ground.push_back(Vector3(x, 0, z));
+	Octree octree;
+	octree.create(ground, 20);
+	ground[0][1] = 1;
+	Octree raised;
+	raised.create(ground, 20);
+
+	SimThread simThread;
+	simThread.sim.params.gravity = -20;     // down in a fraction of a second
+	simThread.sim.pads.push_back(LandingPad(Vector3(0, 0, 0), 100));
+	simThread.sim.setTerrain(&octree);
+	simThread.sim.reset(Vector3(0.3f, 5, 0.2f));
+	simThread.start();
+
+	int bad = 0;
+	for (int game = 1; game <= 2; game++) {
+		SimEvent e(SimStartGame);
+		e.seed = 1234 + game;
+		e.game = game;
+		simThread.post(e);
+		if (!waitForEnd(simThread, game)) {
+			printf("RecordingTest: game %d didn't end\n", game);
+			return 1;
+		}
+	}
+	simThread.stop();
+
+	InputRecording rec;
+	int sessions = 0;
+	while (simThread.takeSession(rec)) {
+		sessions++;
+		if (!rec.save("RecordingTest.lrec") || !rec.load("RecordingTest.lrec") || !rec.matchesTerrain(octree)) {
+			printf("RecordingTest: session %d doesn't match its terrain after save and load\n", sessions);
+			bad++;
+		}
+		if (rec.matchesTerrain(raised)) {
+			printf("RecordingTest: session %d matches other terrain\n", sessions);
+			bad++;
+		}
+		Simulation sim;
+		ReplayResult r = replay(rec, &octree, sim);
+		printf("RecordingTest: session %d, %d steps, outcome %d, %s\n", sessions, rec.numSteps(),
+			rec.final.outcome, r.bMatch ? "replay matches" : "REPLAY MISMATCH");
+		if (!r.bMatch) {
+			rec.final.print();
+			r.final.print();
+			bad++;
+		}
+	}
+	if (sessions != 2) {
+		printf("RecordingTest: %d sessions recorded, expected 2\n", sessions);
+		bad++;
+	}
+	return bad == 0 ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+#include "MonteCarlo.h"
+#include "Recording.h"
+#include "LanderFleet.h"
+#include "Integrator.h"
+#include "TiledTerrain.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//  The headless batch modes, on the simulation alone (no window or GL):
+//
+//    landertools --montecarlo <terrain.obj> [episodes] [seed] [extra pads] [--gravity g] [--thrust up] [--radius r] [--fuel sec]
+//    landertools --replay <terrain.obj> <session> [repeat]
+//    landertools --fleet <terrain.obj> [landers] [seconds] [rate]
+//    landertools --bench-integrators
+//    landertools --split-terrain <in.obj> <out dir> [tile size]
+//
+int main(int argc, char *argv[]) {
+	string mode = argc > 1 ? argv[1] : "";
+	if (mode == "--montecarlo")
+		return runMonteCarloMain(argc, argv);
+	if (mode == "--replay")
+		return runReplayMain(argc, argv);
+	if (mode == "--fleet")
+		return runFleetMain(argc, argv);
+	if (mode == "--bench-integrators")
+		return runIntegratorBenchMain(argc, argv);
+	if (mode == "--split-terrain")
+		return runSplitTerrainMain(argc, argv);
+
+	cout << "usage: " << argv[0] << " --montecarlo | --replay | --fleet | --bench-integrators | --split-terrain ..." << endl;
+	return 1;
+}